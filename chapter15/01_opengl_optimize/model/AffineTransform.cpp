@@ -0,0 +1,30 @@
+#include "AffineTransform.h"
+
+glm::mat4x3 AffineTransform::fromTRS(const glm::vec3 &translation, const glm::quat &rotation,
+    const glm::vec3 &scale) {
+  float xx = rotation.x * rotation.x;
+  float yy = rotation.y * rotation.y;
+  float zz = rotation.z * rotation.z;
+  float xy = rotation.x * rotation.y;
+  float xz = rotation.x * rotation.z;
+  float yz = rotation.y * rotation.z;
+  float wx = rotation.w * rotation.x;
+  float wy = rotation.w * rotation.y;
+  float wz = rotation.w * rotation.z;
+
+  /* same as glm::mat4_cast(), every column multiplied by its scale */
+  return glm::mat4x3(
+    glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy)) * scale.x,
+    glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx)) * scale.y,
+    glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)) * scale.z,
+    translation);
+}
+
+glm::mat4x3 AffineTransform::multiply(const glm::mat4x3 &a, const glm::mat4x3 &b) {
+  /* the missing row of b adds the translation of a only once */
+  return glm::mat4x3(
+    a[0] * b[0].x + a[1] * b[0].y + a[2] * b[0].z,
+    a[0] * b[1].x + a[1] * b[1].y + a[2] * b[1].z,
+    a[0] * b[2].x + a[1] * b[2].y + a[2] * b[2].z,
+    a[0] * b[3].x + a[1] * b[3].y + a[2] * b[3].z + a[3]);
+}
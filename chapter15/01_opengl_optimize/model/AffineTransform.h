@@ -0,0 +1,14 @@
+/* affine transforms as 3x4 matrices, the last row (0, 0, 0, 1) is not stored.
+ * glm::mat4x3 has four columns with three rows, the same layout as PoseKernels::composeTRS() */
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+class AffineTransform {
+  public:
+    /* T * R * S without building the three 4x4 matrices */
+    static glm::mat4x3 fromTRS(const glm::vec3 &translation, const glm::quat &rotation,
+      const glm::vec3 &scale);
+    /* a * b, same result as the 4x4 product with the last row added */
+    static glm::mat4x3 multiply(const glm::mat4x3 &a, const glm::mat4x3 &b);
+};
@@ -0,0 +1,89 @@
+/* evaluates the poses of all instances replaying the same clip in a single run */
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "GltfInstance.h"
+#include "GltfAnimationClip.h"
+#include "ThreadPool.h"
+#include "TaskGraph.h"
+
+/* node animated by the clip, -1 for properties without a track */
+struct BatchNode {
+  int nodeNum = -1;
+  int translationTrack = -1;
+  int rotationTrack = -1;
+  int scaleTrack = -1;
+  /* used for the properties without a track */
+  glm::vec3 restTranslation = glm::vec3(0.0f);
+  glm::quat restRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  glm::vec3 restScale = glm::vec3(1.0f);
+};
+
+/* one lane per instance, all buffers use the structure of arrays layout of PoseKernels */
+struct BatchGroup {
+  std::shared_ptr<GltfAnimationClip> clip = nullptr;
+  /* only the nodes of the skeleton LOD level are animated */
+  int skeletonLod = 0;
+  std::vector<bool> nodeMask{};
+  int trackMask = GltfAnimationClip::mAllTracks;
+  std::vector<BatchNode> nodes{};
+
+  std::vector<GltfInstance*> instances{};
+  std::vector<float> times{};
+  std::vector<std::vector<unsigned int> *> keyCursors{};
+
+  int laneStride = 0;
+  std::vector<float> trackValues{};
+  std::vector<float> restValues{};
+  /* 12 components per node, see PoseKernels::composeTRS() */
+  std::vector<float> localMatrices{};
+};
+
+class AnimationBatch {
+  public:
+    /* updates all instances, the ones not replaying a single clip use updateAnimation() */
+    void updateAnimations(std::vector<GltfInstance*> &instances);
+    void updateAnimations(std::vector<GltfInstance*> &instances,
+      const std::vector<float> &times);
+    /* adds a sampling task per group and a task for the node and joint matrices of every
+     * instance to the graph. poseTasks gets the task creating the pose of every instance,
+     * instances and times must be valid until the graph is done */
+    void addTasks(TaskGraph &graph, std::vector<GltfInstance*> &instances,
+      const std::vector<float> &times, std::vector<int> &poseTasks);
+    void addTasks(TaskGraph &graph, std::vector<GltfInstance*> &instances,
+      std::vector<int> &poseTasks);
+    int getBatchedInstanceCount();
+    /* updateAnimations() runs the tasks in parallel if set */
+    void setThreadPool(ThreadPool *threadPool);
+
+    /* rest values and skeleton LOD level are taken from restInstance if set */
+    static void initGroup(BatchGroup &group, std::shared_ptr<GltfAnimationClip> clip,
+      GltfInstance *restInstance);
+    /* samples the clip and calculates the local matrices for times and keyCursors */
+    static void evaluateGroup(BatchGroup &group);
+
+    static glm::vec3 getTranslation(BatchGroup &group, int nodeIndex, int lane);
+    static glm::quat getRotation(BatchGroup &group, int nodeIndex, int lane);
+    static glm::vec3 getScale(BatchGroup &group, int nodeIndex, int lane);
+    static glm::mat4x3 getLocalMatrix(BatchGroup &group, int nodeIndex, int lane);
+
+  private:
+    static const float *getTrackValues(BatchGroup &group, int nodeIndex, int track,
+      int restOffset);
+    void setInstancePose(BatchGroup &group, int lane);
+
+    std::vector<BatchGroup> mGroups{};
+    /* group and lane of every instance, -1 for the instances not replaying a single clip
+     * and the instances keeping their pose */
+    std::vector<std::pair<int, int>> mInstanceLanes{};
+    std::vector<int> mGroupTasks{};
+    std::vector<float> mTimes{};
+    int mBatchedInstanceCount = 0;
+
+    ThreadPool *mThreadPool = nullptr;
+    TaskGraph mTaskGraph{};
+    std::vector<int> mPoseTasks{};
+};
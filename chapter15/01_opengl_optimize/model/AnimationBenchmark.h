@@ -0,0 +1,58 @@
+/* microbenchmarks for the animation code paths, results go to the log */
+#pragma once
+#include <vector>
+#include <memory>
+
+#include "GltfSkeleton.h"
+#include "GltfAnimationClip.h"
+#include "GltfModel.h"
+
+class AnimationBenchmark {
+  public:
+    static void runAll(std::shared_ptr<GltfModel> model);
+
+    /* binary search for every sample vs. keyframe cursor */
+    static void runKeyframeSearch(std::shared_ptr<GltfModel> model);
+    /* per channel sampling with search vs. clip resampled at a fixed rate */
+    static void runResampledSampling(std::shared_ptr<GltfModel> model);
+    /* one instance after the other vs. all instances of a clip in SIMD lanes */
+    static void runBatchEvaluation(std::vector<std::shared_ptr<GltfAnimationClip>> animClips);
+    /* node and joint matrices as 4x4 matrices vs. affine 3x4 transforms */
+    static void runNodeMatrices(std::vector<std::shared_ptr<GltfAnimationClip>> animClips,
+      GltfSkeleton skeleton);
+    /* 1 to 8 layers blended in a single run over the nodes, the cost per layer and node
+     * must stay the same */
+    static void runLayeredBlend(std::vector<std::shared_ptr<GltfAnimationClip>> animClips,
+      GltfSkeleton skeleton);
+    /* sampling with the track lists of the full skeleton, the skeleton LOD levels and the
+     * split masks already in use, the time per track must not depend on the mask */
+    static void runTrackMasks(std::shared_ptr<GltfModel> model);
+    /* animation and CCD inverse kinematics of all instances with 1, 2, 4 and 8 threads */
+    static void runThreadScaling(std::shared_ptr<GltfModel> model);
+    /* fixed step replay with 1 thread and the frame times vs. all threads and the real
+     * frame times, the palettes of both runs must be bit-identical */
+    static void runDeterministicReplay(std::shared_ptr<GltfModel> model);
+
+  private:
+    /* simulated replay at 60 frames per second */
+    static const int mNumFrames = 10000;
+    static constexpr float mFrameStep = 1.0f / 60.0f;
+
+    /* same number of instances as the renderer, each with its own time offset */
+    static const int mBatchInstances = 1000;
+    static const int mBatchFrames = 100;
+    static constexpr float mBatchTimeOffset = 0.0137f;
+
+    /* sampled poses per clip, every pose is used in all runs */
+    static const int mMatrixFrames = 1000;
+    static const int mMatrixRuns = 10;
+
+    static const int mLayerFrames = 10000;
+
+    /* uses mBatchInstances instances */
+    static const int mScalingFrames = 100;
+    static const int mReplayFrames = 300;
+
+    static unsigned long long replayPalettes(std::shared_ptr<GltfModel> model,
+      int threadCount, bool realFrameTime);
+};
@@ -0,0 +1,50 @@
+#include "AnimationClock.h"
+
+void AnimationClock::tick(double frameTime) {
+  double step = mFixedStep > 0.0f ? mFixedStep : frameTime;
+  mDeltaTime = mPaused ? 0.0f : static_cast<float>(step * mTimeScale);
+  mTime += mDeltaTime;
+  ++mTickCount;
+}
+
+void AnimationClock::reset() {
+  mDeltaTime = 0.0f;
+  mTime = 0.0;
+  mTickCount = 0;
+}
+
+void AnimationClock::setPaused(bool paused) {
+  mPaused = paused;
+}
+
+bool AnimationClock::isPaused() {
+  return mPaused;
+}
+
+void AnimationClock::setTimeScale(float timeScale) {
+  mTimeScale = timeScale;
+}
+
+float AnimationClock::getTimeScale() {
+  return mTimeScale;
+}
+
+void AnimationClock::setFixedStep(float fixedStep) {
+  mFixedStep = fixedStep;
+}
+
+float AnimationClock::getFixedStep() {
+  return mFixedStep;
+}
+
+float AnimationClock::getDeltaTime() {
+  return mDeltaTime;
+}
+
+double AnimationClock::getTime() {
+  return mTime;
+}
+
+unsigned long AnimationClock::getTickCount() {
+  return mTickCount;
+}
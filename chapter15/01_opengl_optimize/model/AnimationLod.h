@@ -0,0 +1,27 @@
+/* distance based update rate of the instance animations */
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "GltfInstance.h"
+#include "InstanceManager.h"
+
+class AnimationLod {
+  public:
+    /* instances beyond bandDistances.x, .y and .z are updated every 2nd, 4th and 8th
+     * frame, the others keep their last joint matrices. the frame of an instance is
+     * staggered by its handle in instanceManager */
+    void selectInstances(InstanceManager &instanceManager,
+      std::vector<GltfInstance*> &instances, glm::vec3 cameraPos, glm::vec3 bandDistances,
+      std::vector<GltfInstance*> &updateInstances);
+
+    /* instances per band in the last call */
+    int getBandInstanceCount(int band);
+
+    static const int mBandCount = 4;
+
+  private:
+    unsigned int mFrameNum = 0;
+    int mBandInstances[mBandCount] = { 0 };
+};
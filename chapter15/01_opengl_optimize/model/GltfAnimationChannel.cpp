@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "GltfAnimationChannel.h"
 
 void GltfAnimationChannel::loadChannelData(std::shared_ptr<tinygltf::Model> model, tinygltf::Animation anim, tinygltf::AnimationChannel channel) {
@@ -74,21 +76,35 @@ ETargetPath GltfAnimationChannel::getTargetPath() {
   return mTargetPath;
 }
 
-glm::vec3 GltfAnimationChannel::getScaling(float time) {
-  if (mScaling.size() == 0) {
-    return glm::vec3(1.0f);
-  }
+EInterpolationType GltfAnimationChannel::getInterpolationType() {
+  return mInterType;
+}
 
-  if (time < mTimings.at(0)) {
-    return mScaling.at(0);
-  }
-  if (time > mTimings.at(mTimings.size() - 1)) {
-    return mScaling.at(mScaling.size() - 1);
+std::vector<float> GltfAnimationChannel::getTimings() {
+  return mTimings;
+}
+
+std::vector<glm::vec3> GltfAnimationChannel::getScalings() {
+  return mScaling;
+}
+
+std::vector<glm::vec3> GltfAnimationChannel::getTranslations() {
+  return mTranslations;
+}
+
+std::vector<glm::quat> GltfAnimationChannel::getRotations() {
+  return mRotations;
+}
+
+/* do a simple binary search in O(log n) instead of a array walk in O(n),
+ * returns the index of the last key with a timing not greater than 'time' */
+unsigned int GltfAnimationChannel::searchKeyIndex(float time) {
+  if (time <= mTimings.at(0)) {
+    return 0;
   }
 
-  /* do a simple binary search in O(log n) instead of a array walk in O(n) */
   int prevTimeIndex = 0;
-  int nextTimeIndex = mScaling.size() - 1;
+  int nextTimeIndex = mTimings.size() - 1;
   int midIndex = 0;
   while (prevTimeIndex <= nextTimeIndex) {
     midIndex = (prevTimeIndex + nextTimeIndex) / 2;
@@ -97,13 +113,93 @@ glm::vec3 GltfAnimationChannel::getScaling(float time) {
     } else if (time < mTimings.at(midIndex)) {
       nextTimeIndex = midIndex - 1;
     } else {
-      break;
+      return midIndex;
     }
   }
 
-  if (prevTimeIndex == nextTimeIndex) {
-    return mScaling.at(prevTimeIndex);
+  /* no exact match, the loop stops with the indices swapped around 'time' */
+  return nextTimeIndex;
+}
+
+/* the playback time moves forward a little bit on most frames, so the key
+ * found in the last call, or the key after it, is almost always the right one */
+unsigned int GltfAnimationChannel::findKeyIndex(float time, unsigned int &keyCursor) {
+  unsigned int lastKeyIndex = mTimings.size() - 1;
+  unsigned int keyIndex = keyCursor;
+
+  if (keyIndex < lastKeyIndex && time >= mTimings.at(keyIndex)) {
+    if (time < mTimings.at(keyIndex + 1)) {
+      return keyIndex;
+    }
+    if (keyIndex + 1 == lastKeyIndex || time < mTimings.at(keyIndex + 2)) {
+      keyCursor = keyIndex + 1;
+      return keyCursor;
+    }
+  }
+
+  /* stay on the last key, i.e. while paused after the end of the clip */
+  if (keyIndex == lastKeyIndex && time >= mTimings.at(lastKeyIndex)) {
+    return keyIndex;
+  }
+
+  /* the time jumped (loop wrap, scrubbing, backward replay), search again */
+  keyCursor = searchKeyIndex(time);
+  return keyCursor;
+}
+
+glm::vec3 GltfAnimationChannel::getScaling(float time) {
+  if (mScaling.size() == 0) {
+    return glm::vec3(1.0f);
+  }
+  return interpolateScaling(searchKeyIndex(time), time);
+}
+
+glm::vec3 GltfAnimationChannel::getScaling(float time, unsigned int &keyCursor) {
+  if (mScaling.size() == 0) {
+    return glm::vec3(1.0f);
+  }
+  return interpolateScaling(findKeyIndex(time, keyCursor), time);
+}
+
+glm::vec3 GltfAnimationChannel::getTranslation(float time) {
+  if (mTranslations.size() == 0) {
+    return glm::vec3(0.0f);
+  }
+  return interpolateTranslation(searchKeyIndex(time), time);
+}
+
+glm::vec3 GltfAnimationChannel::getTranslation(float time, unsigned int &keyCursor) {
+  if (mTranslations.size() == 0) {
+    return glm::vec3(0.0f);
   }
+  return interpolateTranslation(findKeyIndex(time, keyCursor), time);
+}
+
+glm::quat GltfAnimationChannel::getRotation(float time) {
+  if (mRotations.size() == 0) {
+    return glm::identity<glm::quat>();
+  }
+  return interpolateRotation(searchKeyIndex(time), time);
+}
+
+glm::quat GltfAnimationChannel::getRotation(float time, unsigned int &keyCursor) {
+  if (mRotations.size() == 0) {
+    return glm::identity<glm::quat>();
+  }
+  return interpolateRotation(findKeyIndex(time, keyCursor), time);
+}
+
+/* cubic spline channels store in-tangent, value, and out-tangent for every key */
+glm::vec3 GltfAnimationChannel::interpolateScaling(unsigned int keyIndex, float time) {
+  bool isCubicSpline = mInterType == EInterpolationType::CUBICSPLINE;
+
+  /* before the first or after the last key, or exact hit */
+  if (keyIndex == mTimings.size() - 1 || time <= mTimings.at(keyIndex)) {
+    return isCubicSpline ? mScaling.at(keyIndex * 3 + 1) : mScaling.at(keyIndex);
+  }
+
+  int prevTimeIndex = keyIndex;
+  int nextTimeIndex = keyIndex + 1;
 
   glm::vec3 finalScale = glm::vec3(1.0f);
   switch(mInterType) {
@@ -148,35 +244,15 @@ glm::vec3 GltfAnimationChannel::getScaling(float time) {
   return finalScale;
 }
 
-glm::vec3 GltfAnimationChannel::getTranslation(float time) {
-  if (mTranslations.size() == 0) {
-    return glm::vec3(0.0f);
-  }
+glm::vec3 GltfAnimationChannel::interpolateTranslation(unsigned int keyIndex, float time) {
+  bool isCubicSpline = mInterType == EInterpolationType::CUBICSPLINE;
 
-  if (time < mTimings.at(0)) {
-    return mTranslations.at(0);
-  }
-  if (time > mTimings.at(mTimings.size() - 1)) {
-    return mTranslations.at(mTranslations.size() - 1);
+  if (keyIndex == mTimings.size() - 1 || time <= mTimings.at(keyIndex)) {
+    return isCubicSpline ? mTranslations.at(keyIndex * 3 + 1) : mTranslations.at(keyIndex);
   }
 
-  int prevTimeIndex = 0;
-  int nextTimeIndex = mTranslations.size() - 1;
-  int midIndex = 0;
-  while (prevTimeIndex <= nextTimeIndex) {
-    midIndex = (prevTimeIndex + nextTimeIndex) / 2;
-    if (time > mTimings.at(midIndex)) {
-      prevTimeIndex = midIndex + 1;
-    } else if (time < mTimings.at(midIndex)) {
-      nextTimeIndex = midIndex - 1;
-    } else {
-      break;
-    }
-  }
-
-  if (prevTimeIndex == nextTimeIndex) {
-    return mTranslations.at(prevTimeIndex);
-  }
+  int prevTimeIndex = keyIndex;
+  int nextTimeIndex = keyIndex + 1;
 
   glm::vec3 finalTranslate = glm::vec3(0.0f);
   switch(mInterType) {
@@ -223,35 +299,15 @@ glm::vec3 GltfAnimationChannel::getTranslation(float time) {
   return finalTranslate;
 }
 
-glm::quat GltfAnimationChannel::getRotation(float time) {
-  if (mRotations.size() == 0) {
-    return glm::identity<glm::quat>();
-  }
+glm::quat GltfAnimationChannel::interpolateRotation(unsigned int keyIndex, float time) {
+  bool isCubicSpline = mInterType == EInterpolationType::CUBICSPLINE;
 
-  if (time < mTimings.at(0)) {
-    return mRotations.at(0);
-  }
-  if (time > mTimings.at(mTimings.size() - 1)) {
-    return mRotations.at(mRotations.size() - 1);
-  }
-
-  int prevTimeIndex = 0;
-  int nextTimeIndex = mRotations.size() - 1;
-  int midIndex = 0;
-  while (prevTimeIndex <= nextTimeIndex) {
-    midIndex = (prevTimeIndex + nextTimeIndex) / 2;
-    if (time > mTimings.at(midIndex)) {
-      prevTimeIndex = midIndex + 1;
-    } else if (time < mTimings.at(midIndex)) {
-      nextTimeIndex = midIndex - 1;
-    } else {
-      break;
-    }
+  if (keyIndex == mTimings.size() - 1 || time <= mTimings.at(keyIndex)) {
+    return isCubicSpline ? mRotations.at(keyIndex * 3 + 1) : mRotations.at(keyIndex);
   }
 
-  if (prevTimeIndex == nextTimeIndex) {
-    return mRotations.at(prevTimeIndex);
-  }
+  int prevTimeIndex = keyIndex;
+  int nextTimeIndex = keyIndex + 1;
 
   glm::quat finalRotate = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
   switch(mInterType) {
@@ -289,6 +345,7 @@ glm::quat GltfAnimationChannel::getRotation(float time) {
           (interpolatedTimeCub - 2 * interpolatedTimeSq + interpolatedTime) * prevTangent +
           (-2 * interpolatedTimeCub + 3 * interpolatedTimeSq) * nextPoint +
           (interpolatedTimeCub - interpolatedTimeSq) * nextTangent;
+        finalRotate = glm::normalize(finalRotate);
       }
       break;
   }
@@ -299,3 +356,87 @@ glm::quat GltfAnimationChannel::getRotation(float time) {
 float GltfAnimationChannel::getMaxTime() {
   return mTimings.at(mTimings.size() - 1);
 }
+
+int GltfAnimationChannel::reduceKeyframes(float maxPositionError, float maxAngleError,
+    float maxScaleError) {
+  /* STEP and CUBICSPLINE keys are kept, removing them changes the curve */
+  if (mInterType != EInterpolationType::LINEAR || mTimings.size() < 3) {
+    return 0;
+  }
+
+  /* extend the segment from the last kept key as long as all keys inside can be interpolated */
+  std::vector<unsigned int> keptKeys = { 0 };
+  unsigned int startKeyIndex = 0;
+  for (unsigned int endKeyIndex = 2; endKeyIndex < mTimings.size(); ++endKeyIndex) {
+    for (unsigned int i = startKeyIndex + 1; i < endKeyIndex; ++i) {
+      if (!isKeyRedundant(startKeyIndex, endKeyIndex, i, maxPositionError, maxAngleError,
+          maxScaleError)) {
+        startKeyIndex = endKeyIndex - 1;
+        keptKeys.push_back(startKeyIndex);
+        break;
+      }
+    }
+  }
+  keptKeys.push_back(mTimings.size() - 1);
+
+  std::vector<float> timings;
+  std::vector<glm::vec3> scalings;
+  std::vector<glm::vec3> translations;
+  std::vector<glm::quat> rotations;
+  for (const auto keyIndex : keptKeys) {
+    timings.push_back(mTimings.at(keyIndex));
+    switch(mTargetPath) {
+      case ETargetPath::ROTATION:
+        rotations.push_back(mRotations.at(keyIndex));
+        break;
+      case ETargetPath::TRANSLATION:
+        translations.push_back(mTranslations.at(keyIndex));
+        break;
+      case ETargetPath::SCALE:
+        scalings.push_back(mScaling.at(keyIndex));
+        break;
+    }
+  }
+
+  int removedKeys = mTimings.size() - timings.size();
+  setTimings(timings);
+  setScalings(scalings);
+  setTranslations(translations);
+  setRotations(rotations);
+
+  return removedKeys;
+}
+
+bool GltfAnimationChannel::isKeyRedundant(unsigned int startKeyIndex,
+    unsigned int endKeyIndex, unsigned int keyIndex, float maxPositionError,
+    float maxAngleError, float maxScaleError) {
+  float interpolatedTime = (mTimings.at(keyIndex) - mTimings.at(startKeyIndex)) /
+    (mTimings.at(endKeyIndex) - mTimings.at(startKeyIndex));
+
+  switch(mTargetPath) {
+    case ETargetPath::ROTATION:
+      {
+        glm::quat interpolatedRotate = glm::slerp(mRotations.at(startKeyIndex),
+          mRotations.at(endKeyIndex), interpolatedTime);
+        glm::quat diff = glm::conjugate(glm::normalize(mRotations.at(keyIndex))) *
+          glm::normalize(interpolatedRotate);
+        float angle = 2.0f * std::atan2(glm::length(glm::vec3(diff.x, diff.y, diff.z)),
+          std::fabs(diff.w));
+        return angle <= maxAngleError;
+      }
+    case ETargetPath::TRANSLATION:
+      {
+        glm::vec3 interpolatedTranslate = mTranslations.at(startKeyIndex) + interpolatedTime *
+          (mTranslations.at(endKeyIndex) - mTranslations.at(startKeyIndex));
+        return glm::length(interpolatedTranslate - mTranslations.at(keyIndex)) <=
+          maxPositionError;
+      }
+    case ETargetPath::SCALE:
+      {
+        glm::vec3 interpolatedScale = mScaling.at(startKeyIndex) + interpolatedTime *
+          (mScaling.at(endKeyIndex) - mScaling.at(startKeyIndex));
+        return glm::length(interpolatedScale - mScaling.at(keyIndex)) <= maxScaleError;
+      }
+  }
+  return false;
+}
@@ -25,12 +25,27 @@ class GltfAnimationChannel {
 
     int getTargetNode();
     ETargetPath getTargetPath();
+    EInterpolationType getInterpolationType();
+
+    std::vector<float> getTimings();
+    std::vector<glm::vec3> getScalings();
+    std::vector<glm::vec3> getTranslations();
+    std::vector<glm::quat> getRotations();
 
     glm::vec3 getScaling(float time);
     glm::vec3 getTranslation(float time);
     glm::quat getRotation(float time);
+
+    /* start the keyframe search at the cursor position, the cursor is updated */
+    glm::vec3 getScaling(float time, unsigned int &keyCursor);
+    glm::vec3 getTranslation(float time, unsigned int &keyCursor);
+    glm::quat getRotation(float time, unsigned int &keyCursor);
+
     float getMaxTime();
 
+    /* LINEAR channels only, returns the number of removed keys */
+    int reduceKeyframes(float maxPositionError, float maxAngleError, float maxScaleError);
+
   private:
     int mTargetNode = -1;
     ETargetPath mTargetPath = ETargetPath::ROTATION;
@@ -45,4 +60,14 @@ class GltfAnimationChannel {
     void setScalings(std::vector<glm::vec3> scalings);
     void setTranslations(std::vector<glm::vec3> tranlations);
     void setRotations(std::vector<glm::quat> rotations);
+
+    bool isKeyRedundant(unsigned int startKeyIndex, unsigned int endKeyIndex,
+      unsigned int keyIndex, float maxPositionError, float maxAngleError, float maxScaleError);
+
+    unsigned int searchKeyIndex(float time);
+    unsigned int findKeyIndex(float time, unsigned int &keyCursor);
+
+    glm::vec3 interpolateScaling(unsigned int keyIndex, float time);
+    glm::vec3 interpolateTranslation(unsigned int keyIndex, float time);
+    glm::quat interpolateRotation(unsigned int keyIndex, float time);
 };
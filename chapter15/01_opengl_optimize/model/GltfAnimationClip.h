@@ -3,27 +3,126 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include <tiny_gltf.h>
 
-#include "GltfNode.h"
+#include "GltfSkeleton.h"
+#include "PoseBuffer.h"
 #include "GltfAnimationChannel.h"
+#include "ModelLoadSettings.h"
+
+/* keyframe times, shared by all tracks using the same times */
+struct PackedTimeTrack {
+  unsigned int dataOffset = 0;
+  unsigned int keyCount = 0;
+  /* quantized times are startTime + value * timeScale */
+  bool quantized = false;
+  float startTime = 0.0f;
+  float timeScale = 0.0f;
+};
+
+/* single animated node property, one value per key of the time track */
+struct PackedTrack {
+  int targetNode = -1;
+  ETargetPath targetPath = ETargetPath::ROTATION;
+  EInterpolationType interType = EInterpolationType::LINEAR;
+  unsigned int timeTrack = 0;
+  unsigned int dataOffset = 0;
+  /* quantized rotations use "smallest three", other values are rangeMin + value * rangeScale */
+  bool quantized = false;
+  glm::vec3 rangeMin = glm::vec3(0.0f);
+  glm::vec3 rangeScale = glm::vec3(0.0f);
+};
 
 class GltfAnimationClip {
   public:
     GltfAnimationClip(std::string name);
     void addChannel(std::shared_ptr<tinygltf::Model> model, tinygltf::Animation anim,
       tinygltf::AnimationChannel channel);
+    void addChannel(std::shared_ptr<GltfAnimationChannel> channel);
+    /* must be called after all channels were added */
+    void reduceKeyframes(ModelLoadSettings loadSettings);
+    void packChannels(ModelLoadSettings loadSettings);
+
+    /* stores the tracks of the nodes in nodeMask and returns the number of the list. the
+     * lists are built when a mask changes, the sampling only walks the tracks of a list.
+     * not thread safe, GltfModel::getTrackMask() keeps the numbers equal for all clips */
+    int addTrackMask(const std::vector<bool> &nodeMask);
+    int getTrackMaskCount();
+    /* number of tracks sampled with the mask */
+    int getMaskedTrackCount(int trackMask);
+
+    /* keyCursors must hold one entry per time track, owned by the caller */
+    void setAnimationFrame(GltfSkeleton &skeleton, int trackMask, float time,
+      std::vector<unsigned int> &keyCursors);
+    /* writes the tracks of the mask to pose and marks them as written, the other nodes
+     * are not changed. blending is done between poses, see LayeredBlend */
+    void samplePose(PoseBuffer &pose, int trackMask, float time,
+      std::vector<unsigned int> &keyCursors);
+
+    /* samples the tracks of the mask for a group of instances, one SIMD lane per instance.
+     * the values of track i start at i * 4 * laneStride, as structure of arrays
+     * (see PoseKernels) */
+    void sampleBatch(const std::vector<float> &times,
+      std::vector<std::vector<unsigned int> *> &keyCursors, int laneStride, int trackMask,
+      std::vector<float> &trackValues);
+    std::vector<PackedTrack> getTracks();
 
-    void setAnimationFrame(std::vector<std::shared_ptr<GltfNode>> nodes,
-      std::vector<bool> additiveMask, float time);
-    void blendAnimationFrame(std::vector<std::shared_ptr<GltfNode>> nodes,
-      std::vector<bool> additiveMask, float time, float blendFactor);
+    /* always available, contains every track of the clip */
+    static constexpr int mAllTracks = 0;
 
     float getClipEndTime();
     std::string getClipName();
+    bool isResampled();
+    int getTimeTrackCount();
 
   private:
+    /* source data, released by packChannels() */
     std::vector<std::shared_ptr<GltfAnimationChannel>> mAnimationChannels{};
 
+    /* all key times and values of the clip, float and quantized */
+    std::vector<float> mPackedData{};
+    std::vector<uint16_t> mQuantizedData{};
+    std::vector<PackedTimeTrack> mTimeTracks{};
+    /* sorted by target node */
+    std::vector<PackedTrack> mTracks{};
+    /* track numbers per mask, see addTrackMask() */
+    std::vector<std::vector<unsigned int>> mTrackMasks{};
+    float mClipEndTime = 0.0f;
+
+    /* resampled clips store the values of all tracks per frame, no time tracks */
+    bool mResampled = false;
+    float mSampleRate = 0.0f;
+    unsigned int mFrameCount = 0;
+    unsigned int mFrameSize = 0;
+
     std::string mClipName;
+
+    void resampleTracks(float sampleRate);
+    void compressTracks(ModelLoadSettings loadSettings);
+    uint16_t quantizeValue(float value, float rangeMin, float rangeScale);
+    void encodeQuat(glm::quat rotation, uint16_t *data);
+    glm::quat decodeQuat(const uint16_t *data);
+
+    void updateKeyCursors(float time, std::vector<unsigned int> &keyCursors);
+    unsigned int searchKeyIndex(const PackedTimeTrack &timeTrack, float time);
+
+    /* cubic spline tracks store in-tangent, value, and out-tangent for every key */
+    float getKeyTime(const PackedTimeTrack &timeTrack, unsigned int keyIndex);
+    glm::vec3 getVec3(const PackedTrack &track, unsigned int valueIndex);
+    glm::quat getQuat(const PackedTrack &track, unsigned int valueIndex);
+
+    glm::vec3 sampleVec3(const PackedTrack &track, unsigned int keyIndex, float time);
+    glm::quat sampleQuat(const PackedTrack &track, unsigned int keyIndex, float time);
+
+    void getResampledFrames(float time, unsigned int &prevFrameOffset,
+      unsigned int &nextFrameOffset, float &interpolatedTime);
+    glm::vec3 getResampledVec3(unsigned int prevOffset, unsigned int nextOffset,
+      float interpolatedTime);
+    glm::quat getResampledQuat(unsigned int prevOffset, unsigned int nextOffset,
+      float interpolatedTime);
+    void setResampledFrame(GltfSkeleton &skeleton, const std::vector<unsigned int> &tracks,
+      float time);
+    void sampleResampledPose(PoseBuffer &pose, const std::vector<unsigned int> &tracks,
+      float time);
 };
@@ -1,11 +1,12 @@
-#include <chrono>
+#include <algorithm>
+#include <cmath>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/dual_quaternion.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
 
 #include <cstdlib> // rand
 
 #include "GltfInstance.h"
+#include "PoseArena.h"
 #include "Logger.h"
 
 GltfInstance::~GltfInstance() {
@@ -26,45 +27,26 @@ GltfInstance::GltfInstance(std::shared_ptr<GltfModel> model, glm::vec2 worldPos,
   mModelSettings.msWorldPosition = worldPos;
   mNodeCount = mGltfModel->getNodeCount();
 
-  mInverseBindMatrices = mGltfModel->getInverseBindMatrices();
-  mNodeToJoint = mGltfModel->getNodeToJoint();
-
-  mJointMatrices.resize(mInverseBindMatrices.size());
-  mJointDualQuats.resize(mInverseBindMatrices.size());
-
   mAdditiveAnimationMask.resize(mNodeCount);
-  mInvertedAdditiveAnimationMask.resize(mNodeCount);
-
   std::fill(mAdditiveAnimationMask.begin(), mAdditiveAnimationMask.end(), true);
-  mInvertedAdditiveAnimationMask = mAdditiveAnimationMask;
-  mInvertedAdditiveAnimationMask.flip();
 
-  GltfNodeData nodeData;
-  nodeData = mGltfModel->getGltfNodes();
-  mRootNode = nodeData.rootNode;
-  mRootNode->setWorldPosition(glm::vec3(mModelSettings.msWorldPosition.x, 0.0f,
-    mModelSettings.msWorldPosition.y));
+  mSkeletonSplitNode = mNodeCount - 1;
+  mSkeletonLodMask = mGltfModel->getSkeletonLodMask(mSkeletonLod);
+  mSkeletonLodTrackMask = mGltfModel->getSkeletonLodTrackMask(mSkeletonLod);
 
-  mNodeList = nodeData.nodeList;
+  mSkeleton = mGltfModel->getGltfSkeleton();
+  mJointMatrices.resize(mSkeleton.getJointCount());
+  mJointDualQuats.resize(mSkeleton.getJointCount());
+
+  mSkeleton.setWorldPosition(glm::vec3(mModelSettings.msWorldPosition.x, 0.0f,
+    mModelSettings.msWorldPosition.y));
 
   /* reset skeleton split */
   mModelSettings.msSkelSplitNode = mNodeCount - 1;
 
-  for (const auto &node : mNodeList) {
-    if (node) {
-      mModelSettings.msSkelNodeNames.push_back(node->getNodeName());
-    } else {
-      mModelSettings.msSkelNodeNames.push_back("(invalid)");
-    }
-  }
-
-  updateNodeMatrices(mRootNode);
-
-  // mRootNode->printTree();
-
   mAnimClips = mGltfModel->getAnimClips();
   for (const auto &clip : mAnimClips) {
-    mModelSettings.msClipNames.push_back(clip->getClipName());
+    mAnimKeyCursors.emplace_back(std::vector<unsigned int>(clip->getTimeTrackCount(), 0));
   }
   unsigned int animClipSize = mAnimClips.size();
 
@@ -77,11 +59,12 @@ GltfInstance::GltfInstance(std::shared_ptr<GltfModel> model, glm::vec2 worldPos,
     mModelSettings.msAnimClip = animClip;
     mModelSettings.msAnimSpeed = animClipSpeed;
     mModelSettings.msWorldRotation = glm::vec3(0.0f, initRotation, 0.0f);
-    mRootNode->setWorldRotation(mModelSettings.msWorldRotation);
+    mSkeleton.setWorldRotation(mModelSettings.msWorldRotation);
   }
 
-  /* update initial clips etc */
-  checkForUpdates();
+  updateNodeMatrices();
+
+  // mSkeleton.printTree();
 
   /* get Skeleton data */
   mSkeletonMesh = std::make_shared<OGLMesh>();
@@ -96,83 +79,119 @@ GltfInstance::GltfInstance(std::shared_ptr<GltfModel> model, glm::vec2 worldPos,
 
   mModelSettings.msIkTargetWorldPos = getWorldRotation() *
     mModelSettings.msIkTargetPos + glm::vec3(worldPos.x, 0.0f, worldPos.y);
+
+  /* the initial settings are already applied */
+  saveAppliedSettings();
 }
 
 void GltfInstance::resetNodeData() {
-  mGltfModel->resetNodeData(mRootNode);
-  updateNodeMatrices(mRootNode);
+  mSkeleton.resetPose();
+  updateNodeMatrices();
+  mPoseValid = false;
 }
 
 std::shared_ptr<OGLMesh> GltfInstance::getSkeleton() {
   mSkeletonMesh->vertices.clear();
 
   /* start from Armature child */
-  getSkeletonPerNode(mRootNode->getChilds().at(0));
-  return mSkeletonMesh;
-}
-
-void GltfInstance::getSkeletonPerNode(std::shared_ptr<GltfNode> treeNode) {
-  glm::vec3 parentPos = glm::vec3(0.0f);
-  parentPos = glm::vec3(treeNode->getNodeMatrix() * glm::vec4(1.0f));
+  int startNodeNum = mSkeleton.getChildNodeNums(mSkeleton.getRootNodeNum()).at(0);
+  const std::vector<int> &nodeOrder = mSkeleton.getNodeOrder();
+  int first = mSkeleton.getOrderIndex(startNodeNum);
+  int last = first + mSkeleton.getSubtreeSize(startNodeNum);
 
-  OGLVertex parentVertex;
-  parentVertex.position = parentPos;
-  parentVertex.color = glm::vec3(0.0f, 1.0f, 1.0f);
+  /* one line from the parent to every node below the start node */
+  for (int i = first + 1; i < last; ++i) {
+    int nodeNum = nodeOrder.at(i);
+    int parentNodeNum = mSkeleton.getParentNodeNum(nodeNum);
 
-  for (const auto &childNode : treeNode->getChilds()) {
-    glm::vec3 childPos = glm::vec3(0.0f);
-    childPos = glm::vec3(childNode->getNodeMatrix() * glm::vec4(1.0f));
+    OGLVertex parentVertex;
+    parentVertex.position = glm::vec3(mSkeleton.getNodeMatrix(parentNodeNum) * glm::vec4(1.0f));
+    parentVertex.color = glm::vec3(0.0f, 1.0f, 1.0f);
 
     OGLVertex childVertex;
-    childVertex.position = childPos;
+    childVertex.position = glm::vec3(mSkeleton.getNodeMatrix(nodeNum) * glm::vec4(1.0f));
     childVertex.color = glm::vec3(0.0f, 0.0f, 1.0f);
     mSkeletonMesh->vertices.emplace_back(parentVertex);
     mSkeletonMesh->vertices.emplace_back(childVertex);
-
-    getSkeletonPerNode(childNode);
   }
+  return mSkeletonMesh;
 }
 
-void GltfInstance::updateNodeMatrices(std::shared_ptr<GltfNode> treeNode) {
-  treeNode->calculateNodeMatrix();
-
-  if (mModelSettings.msVertexSkinningMode == skinningMode::linear) {
-    updateJointMatrices(treeNode);
-  } else {
-    updateJointDualQuats(treeNode);
-  }
-
-  for (auto& childNode : treeNode->getChilds()) {
-    updateNodeMatrices(childNode);
-  }
+void GltfInstance::updateNodeMatrices() {
+  /* dual quaternion skinning composes the joints from node rotations and translations */
+  mSkeleton.setDualQuatTransforms(
+    mModelSettings.msVertexSkinningMode == skinningMode::dualQuat);
+  mSkeleton.updateNodeMatrices(mSkeletonLodMask);
+  updateJointMatrices(mSkeleton.getRootNodeNum());
 }
 
-void GltfInstance::updateJointMatrices(std::shared_ptr<GltfNode> treeNode) {
-  int nodeNum = treeNode->getNodeNum();
-  mJointMatrices.at(mNodeToJoint.at(nodeNum)) =
-    treeNode->getNodeMatrix() * mInverseBindMatrices.at(mNodeToJoint.at(nodeNum));
-}
+void GltfInstance::updateJointMatrices(int startNodeNum) {
+  const std::vector<int> &nodeOrder = mSkeleton.getNodeOrder();
+  const std::vector<glm::mat4x3> &nodeMatrices = mSkeleton.getNodeMatrices();
+  const std::vector<int> &nodeToJoint = mSkeleton.getNodeToJoint();
+  const std::vector<glm::mat4x3> &inverseBindMatrices = mSkeleton.getInverseBindMatrices();
+  const std::vector<unsigned int> &nodeMatrixUpdates = mSkeleton.getNodeMatrixUpdates();
+  bool dualQuat = mModelSettings.msVertexSkinningMode == skinningMode::dualQuat;
+  const std::vector<glm::quat> &nodeRotations = mSkeleton.getNodeRotations();
+  const std::vector<glm::vec3> &nodeTranslations = mSkeleton.getNodeTranslations();
+  const std::vector<float> &nodeScales = mSkeleton.getNodeScales();
+  const std::vector<glm::quat> &inverseBindRotations = mSkeleton.getInverseBindRotations();
+  const std::vector<glm::vec3> &inverseBindTranslations =
+    mSkeleton.getInverseBindTranslations();
+
+  /* a new skinning mode needs all joints in the new format */
+  bool updateAllJoints = mUpdateAllJoints ||
+    mModelSettings.msVertexSkinningMode != mJointSkinningMode;
+
+  int first = mSkeleton.getOrderIndex(startNodeNum);
+  int last = first + mSkeleton.getSubtreeSize(startNodeNum);
+  for (int i = first; i < last; ++i) {
+    int nodeNum = nodeOrder[i];
+    int jointNum = nodeToJoint[nodeNum];
+    if (jointNum < 0) {
+      continue;
+    }
 
-void GltfInstance::updateJointDualQuats(std::shared_ptr<GltfNode> treeNode) {
-  int nodeNum = treeNode->getNodeNum();
+    /* node matrix unchanged since the last update of all joints */
+    if (!updateAllJoints && nodeMatrixUpdates[nodeNum] <= mJointUpdateNumber) {
+      continue;
+    }
+    ++mUpdatedJointCount;
+
+    /* a joint rigidly attached to the nearest joint above in bind pose has the same skinning
+     * transform, the node matrices of pruned nodes are not updated. the joint above was
+     * already written, the node order has the parents first */
+    if (!mSkeletonLodMask[nodeNum]) {
+      int ancestorNodeNum = mSkeleton.getParentNodeNum(nodeNum);
+      while (ancestorNodeNum >= 0 && nodeToJoint[ancestorNodeNum] < 0) {
+        ancestorNodeNum = mSkeleton.getParentNodeNum(ancestorNodeNum);
+      }
+      /* GltfModel::pruneSkeletonLod() keeps joints without a joint above */
+      if (ancestorNodeNum >= 0) {
+        int ancestorJointNum = nodeToJoint[ancestorNodeNum];
+        mJointMatrices[jointNum] = mJointMatrices[ancestorJointNum];
+        mJointDualQuats[jointNum] = mJointDualQuats[ancestorJointNum];
+        continue;
+      }
+    }
 
-  glm::quat orientation;
-  glm::vec3 scale;
-  glm::vec3 translation;
-  glm::vec3 skew;
-  glm::vec4 perspective;
-  glm::dualquat dq;
+    /* matrix is kept to move the pose for other instances */
+    mJointMatrices[jointNum] = glm::mat4(AffineTransform::multiply(nodeMatrices[nodeNum],
+      inverseBindMatrices[jointNum]));
+    if (dualQuat) {
+      /* same rotation and translation as in the joint matrix, the scale is dropped */
+      glm::quat nodeRotation = nodeRotations[nodeNum];
+      mJointDualQuats[jointNum] = glm::mat2x4_cast(glm::dualquat(
+        nodeRotation * inverseBindRotations[jointNum],
+        nodeTranslations[nodeNum] +
+          nodeScales[nodeNum] * (nodeRotation * inverseBindTranslations[jointNum])));
+    }
+  }
 
-  /* extract components from updated node matrix and create dual quaternion */
-  glm::mat4 nodeJointMat = treeNode->getNodeMatrix() *
-    mInverseBindMatrices.at(mNodeToJoint.at(nodeNum));
-  if (glm::decompose(nodeJointMat, scale, orientation, translation, skew, perspective)) {
-    dq[0] = orientation;
-    dq[1] = glm::quat(0.0, translation.x, translation.y, translation.z) * orientation * 0.5f;
-    mJointDualQuats.at(mNodeToJoint.at(nodeNum)) = glm::mat2x4_cast(dq);
-  } else {
-    Logger::log(1, "%s error: could not decompose matrix for node %i\n", __FUNCTION__,
-      nodeNum);
+  if (startNodeNum == mSkeleton.getRootNodeNum()) {
+    mJointUpdateNumber = mSkeleton.getUpdateNumber();
+    mJointSkinningMode = mModelSettings.msVertexSkinningMode;
+    mUpdateAllJoints = false;
   }
 }
 
@@ -180,7 +199,7 @@ int GltfInstance::getJointMatrixSize() {
   return mJointMatrices.size();
 }
 
-std::vector<glm::mat4> GltfInstance::getJointMatrices() {
+const std::vector<glm::mat4> &GltfInstance::getJointMatrices() {
   return mJointMatrices;
 }
 
@@ -188,101 +207,233 @@ int GltfInstance::getJointDualQuatsSize() {
   return mJointDualQuats.size();
 }
 
-std::vector<glm::mat2x4> GltfInstance::getJointDualQuats() {
+const std::vector<glm::mat2x4> &GltfInstance::getJointDualQuats() {
   return mJointDualQuats;
 }
 
 void GltfInstance::checkForUpdates() {
-  static blendMode lastBlendMode = mModelSettings.msBlendingMode;
-  static int skelSplitNode = mModelSettings.msSkelSplitNode;
-  static glm::vec2 worldPos = mModelSettings.msWorldPosition;
-  static glm::vec3 worldRot = mModelSettings.msWorldRotation;
-  static glm::vec3 ikTargetPos = mModelSettings.msIkTargetPos;
-  static ikMode lastIkMode = mModelSettings.msIkMode;
-  static int numIKIterations = mModelSettings.msIkIterations;
-  static int ikEffectorNode = mModelSettings.msIkEffectorNode;
-  static int ikRootNode = mModelSettings.msIkRootNode;
-
-  if (skelSplitNode != mModelSettings.msSkelSplitNode) {
+  if (mLastSkelSplitNode != mModelSettings.msSkelSplitNode) {
     setSkeletonSplitNode(mModelSettings.msSkelSplitNode);
-    skelSplitNode = mModelSettings.msSkelSplitNode;
+    mLastSkelSplitNode = mModelSettings.msSkelSplitNode;
     resetNodeData();
   }
 
-  if (lastBlendMode != mModelSettings.msBlendingMode) {
-    lastBlendMode = mModelSettings.msBlendingMode;
+  if (mLastBlendMode != mModelSettings.msBlendingMode) {
+    mLastBlendMode = mModelSettings.msBlendingMode;
     if (mModelSettings.msBlendingMode != blendMode::additive) {
       mModelSettings.msSkelSplitNode = mNodeCount - 1;
     }
     resetNodeData();
   }
 
-  if (worldPos != mModelSettings.msWorldPosition) {
-    mRootNode->setWorldPosition(glm::vec3(mModelSettings.msWorldPosition.x, 0.0f,
+  if (mLastWorldPosition != mModelSettings.msWorldPosition) {
+    mSkeleton.setWorldPosition(glm::vec3(mModelSettings.msWorldPosition.x, 0.0f,
       mModelSettings.msWorldPosition.y));
-    worldPos = mModelSettings.msWorldPosition;
-    mModelSettings.msIkTargetWorldPos = getWorldRotation() *
-      mModelSettings.msIkTargetPos + glm::vec3(worldPos.x, 0.0f, worldPos.y);
+    mLastWorldPosition = mModelSettings.msWorldPosition;
+    mModelSettings.msIkTargetWorldPos = getWorldRotation() * mModelSettings.msIkTargetPos +
+      glm::vec3(mLastWorldPosition.x, 0.0f, mLastWorldPosition.y);
   }
 
-  if (worldRot != mModelSettings.msWorldRotation) {
-    mRootNode->setWorldRotation(mModelSettings.msWorldRotation);
-    worldRot = mModelSettings.msWorldRotation;
-    mModelSettings.msIkTargetWorldPos = getWorldRotation() *
-      mModelSettings.msIkTargetPos + glm::vec3(worldPos.x, 0.0f, worldPos.y);
+  if (mLastWorldRotation != mModelSettings.msWorldRotation) {
+    mSkeleton.setWorldRotation(mModelSettings.msWorldRotation);
+    mLastWorldRotation = mModelSettings.msWorldRotation;
+    mModelSettings.msIkTargetWorldPos = getWorldRotation() * mModelSettings.msIkTargetPos +
+      glm::vec3(mLastWorldPosition.x, 0.0f, mLastWorldPosition.y);
   }
 
-  if (ikTargetPos != mModelSettings.msIkTargetPos) {
-    ikTargetPos = mModelSettings.msIkTargetPos;
-    mModelSettings.msIkTargetWorldPos = getWorldRotation() *
-      mModelSettings.msIkTargetPos + glm::vec3(worldPos.x, 0.0f, worldPos.y);
+  if (mLastIkTargetPos != mModelSettings.msIkTargetPos) {
+    mLastIkTargetPos = mModelSettings.msIkTargetPos;
+    mModelSettings.msIkTargetWorldPos = getWorldRotation() * mModelSettings.msIkTargetPos +
+      glm::vec3(mLastWorldPosition.x, 0.0f, mLastWorldPosition.y);
   }
 
-  if (lastIkMode != mModelSettings.msIkMode) {
+  if (mLastIkMode != mModelSettings.msIkMode) {
     resetNodeData();
-    lastIkMode = mModelSettings.msIkMode;
+    mLastIkMode = mModelSettings.msIkMode;
   }
 
-  if (numIKIterations != mModelSettings.msIkIterations) {
+  if (mLastIkIterations != mModelSettings.msIkIterations) {
     setNumIKIterations(mModelSettings.msIkIterations);
     resetNodeData();
-    numIKIterations = mModelSettings.msIkIterations;
+    mLastIkIterations = mModelSettings.msIkIterations;
   }
 
-  if (ikEffectorNode != mModelSettings.msIkEffectorNode ||
-      ikRootNode != mModelSettings.msIkRootNode) {
+  if (mLastIkEffectorNode != mModelSettings.msIkEffectorNode ||
+      mLastIkRootNode != mModelSettings.msIkRootNode) {
     setInverseKinematicsNodes(mModelSettings.msIkEffectorNode, mModelSettings.msIkRootNode);
     resetNodeData();
-    ikEffectorNode = mModelSettings.msIkEffectorNode;
-    ikRootNode = mModelSettings.msIkRootNode;
+    mLastIkEffectorNode = mModelSettings.msIkEffectorNode;
+    mLastIkRootNode = mModelSettings.msIkRootNode;
   }
 }
 
+void GltfInstance::saveAppliedSettings() {
+  mLastBlendMode = mModelSettings.msBlendingMode;
+  mLastSkelSplitNode = mModelSettings.msSkelSplitNode;
+  mLastWorldPosition = mModelSettings.msWorldPosition;
+  mLastWorldRotation = mModelSettings.msWorldRotation;
+  mLastIkTargetPos = mModelSettings.msIkTargetPos;
+  mLastIkMode = mModelSettings.msIkMode;
+  mLastIkIterations = mModelSettings.msIkIterations;
+  mLastIkEffectorNode = mModelSettings.msIkEffectorNode;
+  mLastIkRootNode = mModelSettings.msIkRootNode;
+}
+
 void GltfInstance::updateAnimation() {
+  updateAnimation(getAnimationTime());
+}
+
+void GltfInstance::updateAnimation(float time) {
+  if (isPoseValid(time)) {
+    keepPose();
+    return;
+  }
+
+  if (mModelSettings.msBlendingMode == blendMode::crossfade ||
+      mModelSettings.msBlendingMode == blendMode::additive) {
+    crossBlendAnimationFrame(mModelSettings.msAnimClip,
+      mModelSettings.msCrossBlendDestAnimClip, time,
+      mModelSettings.msAnimCrossBlendFactor);
+  } else {
+    blendAnimationFrame(mModelSettings.msAnimClip, time, mModelSettings.msAnimBlendFactor);
+  }
+  mPoseValid = true;
+  mPoseTime = time;
+  mPoseCopied = false;
+}
+
+bool GltfInstance::isPoseValid(float time) {
+  /* a paused instance keeps its pose, inverse kinematics changes the pose every frame */
+  return mPoseValid && time == mPoseTime && mModelSettings.msIkMode == ikMode::off;
+}
+
+void GltfInstance::keepPose() {
+  /* the node matrices do not belong to a copied pose */
+  if (!mPoseCopied) {
+    updateNodeMatrices();
+  }
+}
+
+void GltfInstance::advanceAnimationTime(float deltaTime) {
+  if (!mModelSettings.msPlayAnimation) {
+    return;
+  }
+  float endTime = getAnimationEndTime(mModelSettings.msAnimClip);
+  if (endTime > 0.0f) {
+    mAnimationTime = std::fmod(mAnimationTime + deltaTime * mModelSettings.msAnimSpeed, endTime);
+  }
+}
+
+void GltfInstance::resetAnimationTime() {
+  mAnimationTime = 0.0f;
+}
+
+float GltfInstance::getAnimationTime() {
   if (mModelSettings.msPlayAnimation) {
-    if (mModelSettings.msBlendingMode == blendMode::crossfade ||
-        mModelSettings.msBlendingMode == blendMode::additive) {
-      playAnimation(mModelSettings.msAnimClip,
-        mModelSettings.msCrossBlendDestAnimClip, mModelSettings.msAnimSpeed,
-        mModelSettings.msAnimCrossBlendFactor,
-        mModelSettings.msAnimationPlayDirection);
-    } else {
-      playAnimation(mModelSettings.msAnimClip, mModelSettings.msAnimSpeed,
-        mModelSettings.msAnimBlendFactor,
-        mModelSettings.msAnimationPlayDirection);
+    /* the clip may have changed after the last advance */
+    float endTime = getAnimationEndTime(mModelSettings.msAnimClip);
+    float time = mAnimationTime;
+    if (time >= endTime && endTime > 0.0f) {
+      time = std::fmod(time, endTime);
     }
+    if (mModelSettings.msAnimationPlayDirection == replayDirection::backward) {
+      return endTime - time;
+    }
+    return time;
+  }
+  mModelSettings.msAnimEndTime = getAnimationEndTime(mModelSettings.msAnimClip);
+  return mModelSettings.msAnimTimePosition;
+}
+
+bool GltfInstance::getBatchAnimationClip(int &animNum) {
+  /* a blend factor of 1.0 replaces all node values, same as a plain clip replay */
+  if (mModelSettings.msBlendingMode != blendMode::fadeinout ||
+      mModelSettings.msAnimBlendFactor < 1.0f) {
+    return false;
+  }
+  animNum = mModelSettings.msAnimClip;
+  return true;
+}
+
+std::shared_ptr<GltfAnimationClip> GltfInstance::getAnimClip(int animNum) {
+  return mAnimClips.at(animNum);
+}
+
+std::vector<unsigned int> &GltfInstance::getAnimKeyCursors(int animNum) {
+  return mAnimKeyCursors.at(animNum);
+}
+
+void GltfInstance::getNodeTRS(int nodeNum, glm::vec3 &translation, glm::quat &rotation,
+    glm::vec3 &scale) {
+  translation = mSkeleton.getLocalTranslation(nodeNum);
+  rotation = mSkeleton.getLocalRotation(nodeNum);
+  scale = mSkeleton.getLocalScale(nodeNum);
+}
+
+void GltfInstance::setNodeTRS(int nodeNum, glm::vec3 translation, glm::quat rotation,
+    glm::vec3 scale, const glm::mat4x3 &trsMatrix) {
+  /* do not change if masked out */
+  if (mAdditiveAnimationMask.at(nodeNum)) {
+    mSkeleton.setLocalTRS(nodeNum, translation, rotation, scale, trsMatrix);
+  }
+}
+
+void GltfInstance::updatePose(float time) {
+  updateNodeMatrices();
+  mPoseValid = true;
+  mPoseTime = time;
+  mPoseCopied = false;
+}
+
+bool GltfInstance::getPoseKey(float timeStep, PoseKey &key, float &time) {
+  time = getAnimationTime();
+
+  /* inverse kinematics and the skeleton need the node matrices of this instance */
+  if (timeStep <= 0.0f || mModelSettings.msIkMode != ikMode::off ||
+      mModelSettings.msDrawSkeleton) {
+    return false;
+  }
+
+  key = PoseKey{};
+  key.clip = mAnimClips.at(mModelSettings.msAnimClip).get();
+  key.timeIndex = std::lround(time / timeStep);
+  key.blending = mModelSettings.msBlendingMode;
+  key.skinning = mModelSettings.msVertexSkinningMode;
+  if (mModelSettings.msBlendingMode == blendMode::fadeinout) {
+    key.blendFactor = mModelSettings.msAnimBlendFactor;
   } else {
-    mModelSettings.msAnimEndTime = getAnimationEndTime(mModelSettings.msAnimClip);
-    if (mModelSettings.msBlendingMode == blendMode::crossfade ||
-        mModelSettings.msBlendingMode == blendMode::additive) {
-      crossBlendAnimationFrame(mModelSettings.msAnimClip,
-        mModelSettings.msCrossBlendDestAnimClip, mModelSettings.msAnimTimePosition,
-        mModelSettings.msAnimCrossBlendFactor);
-    } else {
-      blendAnimationFrame(mModelSettings.msAnimClip, mModelSettings.msAnimTimePosition,
-        mModelSettings.msAnimBlendFactor);
+    key.destClip = mAnimClips.at(mModelSettings.msCrossBlendDestAnimClip).get();
+    key.blendFactor = mModelSettings.msAnimCrossBlendFactor;
+    key.splitNode = mModelSettings.msSkelSplitNode;
+  }
+  key.skeletonLod = mSkeletonLod;
+
+  time = key.timeIndex * timeStep;
+  return true;
+}
+
+void GltfInstance::copyPose(GltfInstance *source) {
+  glm::mat4 relativeTransform = mSkeleton.getWorldTRMatrix() *
+    glm::inverse(source->mSkeleton.getWorldTRMatrix());
+  /* only rotation and translation, no scale */
+  glm::dualquat relativeDualQuat = glm::dualquat(glm::quat_cast(relativeTransform),
+    glm::vec3(relativeTransform[3]));
+  bool dualQuat = mModelSettings.msVertexSkinningMode == skinningMode::dualQuat;
+
+  for (int i = 0; i < mJointMatrices.size(); ++i) {
+    mJointMatrices.at(i) = relativeTransform * source->mJointMatrices.at(i);
+    if (dualQuat) {
+      mJointDualQuats.at(i) = glm::mat2x4_cast(relativeDualQuat *
+        glm::dualquat_cast(source->mJointDualQuats.at(i)));
     }
   }
+
+  /* the joints no longer match the node matrices of this instance */
+  mUpdateAllJoints = true;
+  /* the source was evaluated for the same rounded time */
+  mPoseValid = source->mPoseValid;
+  mPoseTime = source->mPoseTime;
+  mPoseCopied = true;
 }
 
 void GltfInstance::solveIK() {
@@ -299,39 +450,18 @@ void GltfInstance::solveIK() {
   }
 }
 
-void GltfInstance::playAnimation(int animNum, float speedDivider, float blendFactor,
-    replayDirection direction) {
-  double currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-  if (direction == replayDirection::backward) {
-    blendAnimationFrame(animNum, mAnimClips.at(animNum)->getClipEndTime() -
-      std::fmod(currentTime / 1000.0 * speedDivider,
-      mAnimClips.at(animNum)->getClipEndTime()), blendFactor);
-  } else {
-    blendAnimationFrame(animNum, std::fmod(currentTime / 1000.0 * speedDivider,
-      mAnimClips.at(animNum)->getClipEndTime()), blendFactor);
-  }
-}
-
-void GltfInstance::playAnimation(int sourceAnimNumber, int destAnimNumber,
-    float speedDivider, float blendFactor, replayDirection direction) {
-  double currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-
-  if (direction == replayDirection::backward) {
-    crossBlendAnimationFrame(sourceAnimNumber, destAnimNumber,
-      mAnimClips.at(sourceAnimNumber)->getClipEndTime() -
-      std::fmod(currentTime / 1000.0 * speedDivider,
-      mAnimClips.at(sourceAnimNumber)->getClipEndTime()), blendFactor);
-  } else {
-    crossBlendAnimationFrame(sourceAnimNumber, destAnimNumber,
-      std::fmod(currentTime / 1000.0 * speedDivider,
-      mAnimClips.at(sourceAnimNumber)->getClipEndTime()), blendFactor);
-  }
-}
-
 void GltfInstance::blendAnimationFrame(int animNum, float time, float blendFactor) {
-  mAnimClips.at(animNum)->blendAnimationFrame(mNodeList, mAdditiveAnimationMask, time,
-    blendFactor);
-  updateNodeMatrices(mRootNode);
+  mAnimationLayers.resize(1);
+  AnimationLayer &layer = mAnimationLayers.at(0);
+  layer.clip = mAnimClips.at(animNum).get();
+  layer.keyCursors = &mAnimKeyCursors.at(animNum);
+  layer.time = time;
+  layer.weight = blendFactor;
+  layer.nodeWeights = nullptr;
+  layer.trackMask = mAdditiveTrackMask;
+  layer.mode = layerMode::override;
+
+  evaluateAnimationLayers(mAdditiveAnimationMask);
 }
 
 void GltfInstance::crossBlendAnimationFrame(int sourceAnimNumber, int destAnimNumber,
@@ -342,46 +472,154 @@ void GltfInstance::crossBlendAnimationFrame(int sourceAnimNumber, int destAnimNu
 
   float scaledTime = time * (destAnimDuration / sourceAnimDuration);
 
-  mAnimClips.at(sourceAnimNumber)->setAnimationFrame(mNodeList, mAdditiveAnimationMask, time);
-  mAnimClips.at(destAnimNumber)->blendAnimationFrame(mNodeList, mAdditiveAnimationMask,
-    scaledTime, blendFactor);
+  /* destination over source below the split node, source over destination above */
+  if (mSplitNodeWeightsFactor != blendFactor) {
+    mSplitNodeWeights.resize(mNodeCount);
+    for (int i = 0; i < mNodeCount; ++i) {
+      mSplitNodeWeights.at(i) = mAdditiveAnimationMask.at(i) ? blendFactor : 1.0f - blendFactor;
+    }
+    mSplitNodeWeightsFactor = blendFactor;
+  }
+
+  mAnimationLayers.resize(2);
+  AnimationLayer &sourceLayer = mAnimationLayers.at(0);
+  sourceLayer.clip = mAnimClips.at(sourceAnimNumber).get();
+  sourceLayer.keyCursors = &mAnimKeyCursors.at(sourceAnimNumber);
+  sourceLayer.time = time;
+  sourceLayer.weight = 1.0f;
+  sourceLayer.nodeWeights = nullptr;
+  sourceLayer.trackMask = mSkeletonLodTrackMask;
+  sourceLayer.mode = layerMode::override;
+
+  AnimationLayer &destLayer = mAnimationLayers.at(1);
+  destLayer.clip = mAnimClips.at(destAnimNumber).get();
+  destLayer.keyCursors = &mAnimKeyCursors.at(destAnimNumber);
+  destLayer.time = scaledTime;
+  destLayer.weight = 1.0f;
+  destLayer.nodeWeights = &mSplitNodeWeights;
+  destLayer.trackMask = mSkeletonLodTrackMask;
+  destLayer.mode = layerMode::override;
+
+  /* both masks together are the nodes of the skeleton LOD level */
+  evaluateAnimationLayers(mSkeletonLodMask);
+}
+
+void GltfInstance::evaluateAnimationLayers(const std::vector<bool> &nodeMask) {
+  PoseArena &arena = PoseArena::getThreadArena();
+  size_t arenaMark = arena.getMark();
+  PoseBuffer basePose = arena.allocatePose(mNodeCount);
+  PoseBuffer blendedPose = arena.allocatePose(mNodeCount);
+
+  mSkeleton.getBasePose(basePose);
+  LayeredBlend::evaluate(mAnimationLayers, basePose, nodeMask, blendedPose);
+  mSkeleton.applyPose(blendedPose);
+
+  arena.release(arenaMark);
+  updateNodeMatrices();
+}
 
-  mAnimClips.at(destAnimNumber)->setAnimationFrame(mNodeList, mInvertedAdditiveAnimationMask,
-    scaledTime);
-  mAnimClips.at(sourceAnimNumber)->blendAnimationFrame(mNodeList,
-    mInvertedAdditiveAnimationMask, time, blendFactor);
+void GltfInstance::setSkeletonSplitNode(int nodeNum) {
+  mSkeletonSplitNode = nodeNum;
+  /* only the split node and the nodes below get the additive clip */
+  std::fill(mAdditiveAnimationMask.begin(), mAdditiveAnimationMask.end(), true);
+  if (nodeNum != mSkeleton.getRootNodeNum()) {
+    for (const auto orderNodeNum : mSkeleton.getNodeOrder()) {
+      mAdditiveAnimationMask.at(orderNodeNum) = false;
+    }
+    if (mSkeleton.hasNode(nodeNum)) {
+      const std::vector<int> &nodeOrder = mSkeleton.getNodeOrder();
+      int first = mSkeleton.getOrderIndex(nodeNum);
+      int last = first + mSkeleton.getSubtreeSize(nodeNum);
+      for (int i = first; i < last; ++i) {
+        mAdditiveAnimationMask.at(nodeOrder.at(i)) = true;
+      }
+    }
+  }
 
-  updateNodeMatrices(mRootNode);
+  /* channels of pruned nodes are skipped by the clips */
+  for (int i = 0; i < mNodeCount; ++i) {
+    if (!mSkeletonLodMask.at(i)) {
+      mAdditiveAnimationMask.at(i) = false;
+    }
+  }
+  mAdditiveTrackMask = mGltfModel->getTrackMask(mAdditiveAnimationMask);
+  mSplitNodeWeightsFactor = -1.0f;
 }
 
-void GltfInstance::updateAdditiveMask(std::shared_ptr<GltfNode> treeNode, int splitNodeNum) {
-  /* break chain here */
-  if (treeNode->getNodeNum() == splitNodeNum) {
+void GltfInstance::setSkeletonLod(int level) {
+  /* inverse kinematics and the skeleton need the matrices of all nodes */
+  if (mModelSettings.msIkMode != ikMode::off || mModelSettings.msDrawSkeleton) {
+    level = 0;
+  }
+  level = std::clamp(level, 0, GltfModel::mSkeletonLodCount - 1);
+  if (level == mSkeletonLod) {
     return;
   }
 
-  mAdditiveAnimationMask.at(treeNode->getNodeNum()) = false;
-  for (auto& childNode : treeNode->getChilds()) {
-    updateAdditiveMask(childNode, splitNodeNum);
+  mSkeletonLod = level;
+  mSkeletonLodMask = mGltfModel->getSkeletonLodMask(mSkeletonLod);
+  mSkeletonLodTrackMask = mGltfModel->getSkeletonLodTrackMask(mSkeletonLod);
+  setSkeletonSplitNode(mSkeletonSplitNode);
+
+  /* previously pruned nodes have outdated matrices */
+  mSkeleton.invalidateNodeMatrices();
+  mUpdateAllJoints = true;
+  mPoseValid = false;
+}
+
+int GltfInstance::getSkeletonLod() {
+  return mSkeletonLod;
+}
+
+std::vector<bool> GltfInstance::getSkeletonLodMask() {
+  return mSkeletonLodMask;
+}
+
+int GltfInstance::getSkeletonLodTrackMask() {
+  return mSkeletonLodTrackMask;
+}
+
+int GltfInstance::getSkippedChannelCount() {
+  int skippedChannels = mGltfModel->getSkeletonLodSkippedChannels(mSkeletonLod,
+    mModelSettings.msAnimClip);
+  if (mModelSettings.msBlendingMode == blendMode::crossfade ||
+      mModelSettings.msBlendingMode == blendMode::additive) {
+    skippedChannels += mGltfModel->getSkeletonLodSkippedChannels(mSkeletonLod,
+      mModelSettings.msCrossBlendDestAnimClip);
   }
+  return skippedChannels;
 }
 
-void GltfInstance::setSkeletonSplitNode(int nodeNum) {
-  std::fill(mAdditiveAnimationMask.begin(), mAdditiveAnimationMask.end(), true);
-  updateAdditiveMask(mRootNode, nodeNum);
+float GltfInstance::getSkeletonSize() {
+  return mGltfModel->getSkeletonSize();
+}
+
+int GltfInstance::getUpdatedNodeCount() {
+  return mSkeleton.getUpdatedNodeCount();
+}
+
+int GltfInstance::getUpdatedJointCount() {
+  return mUpdatedJointCount;
+}
 
-  mInvertedAdditiveAnimationMask = mAdditiveAnimationMask;
-  mInvertedAdditiveAnimationMask.flip();
+void GltfInstance::resetUpdateCounters() {
+  mSkeleton.resetUpdatedNodeCount();
+  mUpdatedJointCount = 0;
 }
 
-void GltfInstance::setInstanceSettings(ModelSettings settings) {
+void GltfInstance::setInstanceSettings(const ModelSettings &settings) {
   mModelSettings = settings;
+  mPoseValid = false;
 }
 
-ModelSettings GltfInstance::getInstanceSettings() {
+const ModelSettings &GltfInstance::getInstanceSettings() {
   return mModelSettings;
 }
 
+bool GltfInstance::isAnimationBaked() {
+  return mModelSettings.msBakedAnimation;
+}
+
 glm::vec2 GltfInstance::getWorldPosition() {
   return mModelSettings.msWorldPosition;
 }
@@ -394,43 +632,44 @@ glm::quat GltfInstance::getWorldRotation() {
   )));
 }
 
+glm::mat4 GltfInstance::getWorldMatrix() {
+  return mSkeleton.getWorldTRMatrix();
+}
+
 float GltfInstance::getAnimationEndTime(int animNum) {
   return mAnimClips.at(animNum)->getClipEndTime();
 }
 
 void GltfInstance::setInverseKinematicsNodes(int effectorNodeNum, int ikChainRootNodeNum) {
-  if (effectorNodeNum < 0 || effectorNodeNum > (mNodeList.size() - 1)) {
+  if (effectorNodeNum < 0 || effectorNodeNum > (mSkeleton.getNodeCount() - 1)) {
     Logger::log(1, "%s error: effector node %i is out of range\n", __FUNCTION__,
       effectorNodeNum);
     return;
   }
 
-  if (ikChainRootNodeNum < 0 || ikChainRootNodeNum > (mNodeList.size() - 1)) {
+  if (ikChainRootNodeNum < 0 || ikChainRootNodeNum > (mSkeleton.getNodeCount() - 1)) {
     Logger::log(1, "%s error: IK chaine root node %i is out of range\n", __FUNCTION__,
       ikChainRootNodeNum);
     return;
   }
 
-  std::vector<std::shared_ptr<GltfNode>> ikNodes{};
+  std::vector<int> ikNodes{};
   int currentNodeNum = effectorNodeNum;
 
-  ikNodes.insert(ikNodes.begin(), mNodeList.at(effectorNodeNum));
+  ikNodes.insert(ikNodes.begin(), effectorNodeNum);
   while (currentNodeNum != ikChainRootNodeNum) {
-    std::shared_ptr<GltfNode> node = mNodeList.at(currentNodeNum);
-    if (node) {
-      std::shared_ptr<GltfNode> parentNode = node->getParentNode();
-      if (parentNode) {
-        currentNodeNum = parentNode->getNodeNum();
-        ikNodes.push_back(parentNode);
-      } else {
-        /* force stopping on the root node */
-        Logger::log(1, "%s error: reached skeleton root node, stopping\n", __FUNCTION__);
-        break;
-      }
+    int parentNodeNum = mSkeleton.getParentNodeNum(currentNodeNum);
+    if (parentNodeNum >= 0) {
+      currentNodeNum = parentNodeNum;
+      ikNodes.push_back(parentNodeNum);
+    } else {
+      /* force stopping on the root node */
+      Logger::log(1, "%s error: reached skeleton root node, stopping\n", __FUNCTION__);
+      break;
     }
   }
 
-  mIKSolver.setNodes(ikNodes);
+  mIKSolver.setNodes(mSkeleton, ikNodes);
 }
 
 void GltfInstance::setNumIKIterations(int iterations) {
@@ -438,11 +677,11 @@ void GltfInstance::setNumIKIterations(int iterations) {
 }
 
 void GltfInstance::solveIKByCCD(glm::vec3 target)  {
-  mIKSolver.solveCCD(target);
-  updateNodeMatrices(mIKSolver.getIkChainRootNode());
+  mIKSolver.solveCCD(mSkeleton, target);
+  updateJointMatrices(mIKSolver.getIkChainRootNode());
 }
 
 void GltfInstance::solveIKByFABRIK(glm::vec3 target)  {
-  mIKSolver.solveFABRIK(target);
-  updateNodeMatrices(mIKSolver.getIkChainRootNode());
+  mIKSolver.solveFABRIK(mSkeleton, target);
+  updateJointMatrices(mIKSolver.getIkChainRootNode());
 }
@@ -3,17 +3,37 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <tuple>
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
 #include "GltfModel.h"
-#include "GltfNode.h"
+#include "GltfSkeleton.h"
 #include "GltfAnimationClip.h"
 #include "IKSolver.h"
+#include "LayeredBlend.h"
 
 #include "OGLRenderData.h"
 #include "ModelSettings.h"
 
+/* instances with the same key have the same pose, apart from the world transform */
+struct PoseKey {
+  GltfAnimationClip *clip = nullptr;
+  GltfAnimationClip *destClip = nullptr;
+  long timeIndex = 0;
+  blendMode blending = blendMode::fadeinout;
+  float blendFactor = 0.0f;
+  int splitNode = 0;
+  skinningMode skinning = skinningMode::linear;
+  int skeletonLod = 0;
+
+  bool operator<(const PoseKey &other) const {
+    return std::tie(clip, destClip, timeIndex, blending, blendFactor, splitNode, skinning,
+      skeletonLod) < std::tie(other.clip, other.destClip, other.timeIndex, other.blending,
+      other.blendFactor, other.splitNode, other.skinning, other.skeletonLod);
+  }
+};
+
 class GltfInstance {
   public:
     GltfInstance(std::shared_ptr<GltfModel> model, glm::vec2 worldPos, bool randomize = false);
@@ -24,63 +44,138 @@ class GltfInstance {
     std::shared_ptr<OGLMesh> getSkeleton();
     void setSkeletonSplitNode(int nodeNum);
 
+    /* pruned joints follow their parent, see GltfModel::getSkeletonLodMask() */
+    void setSkeletonLod(int level);
+    int getSkeletonLod();
+    std::vector<bool> getSkeletonLodMask();
+    /* tracks of the level in every clip, see GltfModel::getTrackMask() */
+    int getSkeletonLodTrackMask();
+    /* channels of the current clips not evaluated on the skeleton LOD level */
+    int getSkippedChannelCount();
+    float getSkeletonSize();
+
+    /* node and joint matrices recomputed since the last reset */
+    int getUpdatedNodeCount();
+    int getUpdatedJointCount();
+    void resetUpdateCounters();
+
     int getJointMatrixSize();
     int getJointDualQuatsSize();
-    std::vector<glm::mat4> getJointMatrices();
-    std::vector<glm::mat2x4> getJointDualQuats();
+    const std::vector<glm::mat4> &getJointMatrices();
+    const std::vector<glm::mat2x4> &getJointDualQuats();
 
     void updateAnimation();
-
-    void setInstanceSettings(ModelSettings settings);
-    ModelSettings getInstanceSettings();
+    void updateAnimation(float time);
+    /* moves the replay position by deltaTime times the replay speed, see AnimationClock */
+    void advanceAnimationTime(float deltaTime);
+    void resetAnimationTime();
+    /* replay position, or the position set in the UI if the replay is stopped */
+    float getAnimationTime();
+
+    /* single clip replay without blending, can be evaluated by AnimationBatch */
+    bool getBatchAnimationClip(int &animNum);
+    std::shared_ptr<GltfAnimationClip> getAnimClip(int animNum);
+    std::vector<unsigned int> &getAnimKeyCursors(int animNum);
+    void getNodeTRS(int nodeNum, glm::vec3 &translation, glm::quat &rotation, glm::vec3 &scale);
+    void setNodeTRS(int nodeNum, glm::vec3 translation, glm::quat rotation, glm::vec3 scale,
+      const glm::mat4x3 &trsMatrix);
+    /* node and joint matrices after all nodes were set, the pose is kept for time */
+    void updatePose(float time);
+    /* pose of the last update is still valid for time, no need to sample the clips */
+    bool isPoseValid(float time);
+    /* only the changed node and joint matrices, for a valid pose */
+    void keepPose();
+
+    /* time is rounded to timeStep if the pose can be shared, see PoseCache */
+    bool getPoseKey(float timeStep, PoseKey &key, float &time);
+    /* joint matrices of the source, moved to the world position of this instance */
+    void copyPose(GltfInstance *source);
+
+    void setInstanceSettings(const ModelSettings &settings);
+    const ModelSettings &getInstanceSettings();
+    /* baked instances are animated by the shaders, see BakedAnimations */
+    bool isAnimationBaked();
     void checkForUpdates();
 
     glm::vec2 getWorldPosition();
     glm::quat getWorldRotation();
+    /* transform of the root node, part of all joint matrices */
+    glm::mat4 getWorldMatrix();
 
     void solveIK();
     void setInverseKinematicsNodes(int effectorNodeNum, int ikChainRootNodeNum);
     void setNumIKIterations(int iterations);
 
   private:
-    void playAnimation(int animNum, float speedDivider, float blendFactor,
-      replayDirection direction);
-    void playAnimation(int sourceAnimNum, int destAnimNum, float speedDivider,
-      float blendFactor, replayDirection direction);
-
     void blendAnimationFrame(int animNumber, float time, float blendFactor);
     void crossBlendAnimationFrame(int sourceAnimNumber, int destAnimNumber, float time,
       float blendFactor);
+    /* blends mAnimationLayers over the start values and updates the node matrices */
+    void evaluateAnimationLayers(const std::vector<bool> &nodeMask);
 
     float getAnimationEndTime(int animNum);
 
-    void getSkeletonPerNode(std::shared_ptr<GltfNode> treeNode);
-    void updateNodeMatrices(std::shared_ptr<GltfNode> treeNode);
-    void updateJointMatrices(std::shared_ptr<GltfNode> treeNode);
-    void updateJointDualQuats(std::shared_ptr<GltfNode> treeNode);
-    void updateAdditiveMask(std::shared_ptr<GltfNode> treeNode, int splitNodeNum);
+    void updateNodeMatrices();
+    void saveAppliedSettings();
+    /* joint matrices or dual quaternions of the node and all nodes below */
+    void updateJointMatrices(int startNodeNum);
 
     std::shared_ptr<GltfModel> mGltfModel = nullptr;
     unsigned int mNodeCount = 0;
 
-    /* every model needs its onw set of nodes */
-    std::shared_ptr<GltfNode> mRootNode = nullptr;
-    std::vector<std::shared_ptr<GltfNode>> mNodeList{};
+    /* every model needs its own pose, the topology is shared */
+    GltfSkeleton mSkeleton{};
 
     std::vector<std::shared_ptr<GltfAnimationClip>> mAnimClips{};
-    std::vector<glm::mat4> mInverseBindMatrices{};
+    /* keyframe search start positions, per clip and time track */
+    std::vector<std::vector<unsigned int>> mAnimKeyCursors{};
     std::vector<glm::mat4> mJointMatrices{};
     std::vector<glm::mat2x4> mJointDualQuats{};
 
-    std::vector<int> mNodeToJoint{};
+    /* joints are only recomputed if the node matrix changed after the last full update */
+    unsigned int mJointUpdateNumber = 0;
+    skinningMode mJointSkinningMode = skinningMode::linear;
+    bool mUpdateAllJoints = true;
+    int mUpdatedJointCount = 0;
+
+    /* local replay time, wrapped at the end of the current clip */
+    float mAnimationTime = 0.0f;
+
+    /* the clips are not sampled again for the same time */
+    bool mPoseValid = false;
+    float mPoseTime = 0.0f;
+    /* joint matrices copied from another instance, see copyPose() */
+    bool mPoseCopied = false;
 
     std::vector<bool> mAdditiveAnimationMask{};
-    std::vector<bool> mInvertedAdditiveAnimationMask{};
+    int mAdditiveTrackMask = GltfAnimationClip::mAllTracks;
+
+    /* kept between the frames, no allocations for the layers */
+    std::vector<AnimationLayer> mAnimationLayers{};
+    /* weight of the destination clip per node, for the cross blend factor below */
+    std::vector<float> mSplitNodeWeights{};
+    float mSplitNodeWeightsFactor = -1.0f;
+
+    int mSkeletonSplitNode = 0;
+    int mSkeletonLod = 0;
+    std::vector<bool> mSkeletonLodMask{};
+    int mSkeletonLodTrackMask = GltfAnimationClip::mAllTracks;
 
     std::shared_ptr<OGLMesh> mSkeletonMesh = nullptr;
 
     ModelSettings mModelSettings{};
 
+    /* settings at the last checkForUpdates() call, every instance has its own */
+    blendMode mLastBlendMode = blendMode::fadeinout;
+    int mLastSkelSplitNode = 0;
+    glm::vec2 mLastWorldPosition = glm::vec2(0.0f);
+    glm::vec3 mLastWorldRotation = glm::vec3(0.0f);
+    glm::vec3 mLastIkTargetPos = glm::vec3(0.0f);
+    ikMode mLastIkMode = ikMode::off;
+    int mLastIkIterations = 0;
+    int mLastIkEffectorNode = 0;
+    int mLastIkRootNode = 0;
+
     IKSolver mIKSolver{};
     void solveIKByCCD(glm::vec3 target);
     void solveIKByFABRIK(glm::vec3 target);
@@ -8,38 +8,50 @@
 #include <tiny_gltf.h>
 
 #include "Texture.h"
-#include "GltfNode.h"
+#include "GltfSkeleton.h"
 #include "GltfAnimationClip.h"
+#include "ModelLoadSettings.h"
+#include "ModelMetadata.h"
 
 #include "OGLRenderData.h"
 
-struct GltfNodeData {
-    std::shared_ptr<GltfNode> rootNode;
-    std::vector<std::shared_ptr<GltfNode>> nodeList;
-};
-
 class GltfModel {
   public:
     bool loadModel(OGLRenderData &renderData, std::string modelFilename,
-      std::string textureFilename);
+      std::string textureFilename, ModelLoadSettings loadSettings);
     void draw();
     void drawInstanced(int instanceCount);
     void cleanup();
 
     std::string getModelFilename();
     int getNodeCount();
-    GltfNodeData getGltfNodes();
+    /* pose in bind position, on the skeleton topology shared by all instances */
+    GltfSkeleton getGltfSkeleton();
     int getTriangleCount();
 
     void uploadVertexBuffers();
     void uploadIndexBuffer();
 
-    std::vector<glm::mat4> getInverseBindMatrices();
-    std::vector<int> getNodeToJoint();
-
     std::vector<std::shared_ptr<GltfAnimationClip>> getAnimClips();
-
-    void resetNodeData(std::shared_ptr<GltfNode> treeNode);
+    /* unpacked channels of the clip as stored in the file, the clips only keep the packed
+     * tracks. loaded on every call */
+    std::vector<std::shared_ptr<GltfAnimationChannel>> loadAnimationChannels(int clipNum);
+
+    /* node masks of the skeleton levels of detail, level 0 contains all nodes */
+    std::vector<bool> getSkeletonLodMask(int level);
+    /* channels of the clip targeting nodes outside of the level */
+    int getSkeletonLodSkippedChannels(int level, int clipNum);
+    int getSkeletonLodTrackMask(int level);
+    /* number of the track list of nodeMask in every clip, the lists are created on the first
+     * call for a mask. must not be called while the clips are sampled */
+    int getTrackMask(const std::vector<bool> &nodeMask);
+    /* diagonal of the joint positions in bind pose */
+    float getSkeletonSize();
+
+    /* clip and node names, the settings of the instances only keep the numbers */
+    const ModelMetadata &getMetadata();
+
+    static const int mSkeletonLodCount = 4;
 
   private:
     void createVertexBuffers();
@@ -48,11 +60,16 @@ class GltfModel {
     void getJointData();
     void getWeightData();
     void getInvBindMatrices();
-    void getAnimations();
-    void getNodes(std::shared_ptr<GltfNode> treeNode);
-    void getNodeData(std::shared_ptr<GltfNode> treeNode);
-    std::vector<std::shared_ptr<GltfNode>> getNodeList(std::vector<std::shared_ptr<GltfNode>>
-      &nodeList, int nodeNum);
+    void getAnimations(ModelLoadSettings loadSettings);
+    void createSkeletonLods();
+    void createMetadata();
+    float getJointExtent(int nodeNum, glm::vec3 jointPos,
+      const std::vector<glm::vec3> &jointPositions, const std::vector<bool> &isJoint);
+    void pruneSkeletonLod(std::vector<bool> &lodMask, int nodeNum, float minExtent,
+      const std::vector<glm::vec3> &jointPositions, const std::vector<bool> &isJoint);
+    void createSkeletonTopology();
+    void getNodes(int nodeNum);
+    void getNodeData(int nodeNum);
 
     std::string mModelFilename;
     int mNodeCount = 0;
@@ -66,7 +83,20 @@ class GltfModel {
     std::vector<int> mAttribAccessors{};
     std::vector<int> mNodeToJoint{};
 
+    std::shared_ptr<GltfSkeletonTopology> mSkeletonTopology = nullptr;
+    GltfSkeleton mBindPoseSkeleton{};
+
     std::vector<std::shared_ptr<GltfAnimationClip>> mAnimClips{};
+    /* node mask per track mask number */
+    std::vector<std::vector<bool>> mTrackMaskNodes{};
+
+    float mSkeletonSize = 0.0f;
+    std::vector<std::vector<bool>> mSkeletonLodMasks{};
+    /* per level and clip */
+    std::vector<std::vector<int>> mSkeletonLodSkippedChannels{};
+    std::vector<int> mSkeletonLodTrackMasks{};
+
+    ModelMetadata mMetadata{};
 
     GLuint mVAO = 0;
     std::vector<GLuint> mVertexVBO{};
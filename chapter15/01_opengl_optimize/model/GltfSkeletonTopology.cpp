@@ -0,0 +1,139 @@
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include "GltfSkeletonTopology.h"
+#include "Logger.h"
+
+void GltfSkeletonTopology::setNodeCount(int nodeCount) {
+  mParentNodes.assign(nodeCount, -1);
+  mNodeOrder.clear();
+  mOrderIndices.assign(nodeCount, -1);
+  mSubtreeSizes.assign(nodeCount, 0);
+  mNodeNames.assign(nodeCount, "");
+
+  mBindTranslations.assign(nodeCount, glm::vec3(0.0f));
+  mBindRotations.assign(nodeCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  mBindScales.assign(nodeCount, glm::vec3(1.0f));
+
+  mNodeToJoint.assign(nodeCount, -1);
+  mInverseBindMatrices.clear();
+  mInverseBindRotations.clear();
+  mInverseBindTranslations.clear();
+}
+
+void GltfSkeletonTopology::addNode(int nodeNum, int parentNodeNum, std::string nodeName) {
+  mParentNodes.at(nodeNum) = parentNodeNum;
+  mOrderIndices.at(nodeNum) = mNodeOrder.size();
+  mNodeOrder.push_back(nodeNum);
+  mSubtreeSizes.at(nodeNum) = 1;
+  mNodeNames.at(nodeNum) = nodeName;
+
+  /* depth first order, the new node is the last one of all subtrees above */
+  for (int parent = parentNodeNum; parent >= 0; parent = mParentNodes.at(parent)) {
+    ++mSubtreeSizes.at(parent);
+  }
+}
+
+void GltfSkeletonTopology::setBindPose(int nodeNum, glm::vec3 translation, glm::quat rotation,
+    glm::vec3 scale) {
+  mBindTranslations.at(nodeNum) = translation;
+  mBindRotations.at(nodeNum) = rotation;
+  mBindScales.at(nodeNum) = scale;
+}
+
+void GltfSkeletonTopology::setJoints(std::vector<int> nodeToJoint,
+    std::vector<glm::mat4> inverseBindMatrices) {
+  mNodeToJoint = nodeToJoint;
+  mInverseBindMatrices.assign(inverseBindMatrices.begin(), inverseBindMatrices.end());
+
+  /* the scale of the joint is not part of the dual quaternion */
+  mInverseBindRotations.assign(inverseBindMatrices.size(), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  mInverseBindTranslations.assign(inverseBindMatrices.size(), glm::vec3(0.0f));
+  for (int i = 0; i < inverseBindMatrices.size(); ++i) {
+    glm::vec3 scale;
+    glm::vec3 skew;
+    glm::vec4 perspective;
+    if (!glm::decompose(inverseBindMatrices.at(i), scale, mInverseBindRotations.at(i),
+        mInverseBindTranslations.at(i), skew, perspective)) {
+      Logger::log(1, "%s error: could not decompose inverse bind matrix of joint %i\n",
+        __FUNCTION__, i);
+    }
+  }
+}
+
+int GltfSkeletonTopology::getNodeCount() {
+  return mParentNodes.size();
+}
+
+bool GltfSkeletonTopology::hasNode(int nodeNum) {
+  return mOrderIndices.at(nodeNum) >= 0;
+}
+
+int GltfSkeletonTopology::getRootNodeNum() {
+  return mNodeOrder.at(0);
+}
+
+int GltfSkeletonTopology::getParentNodeNum(int nodeNum) {
+  return mParentNodes.at(nodeNum);
+}
+
+std::vector<int> GltfSkeletonTopology::getChildNodeNums(int nodeNum) {
+  std::vector<int> childNodes{};
+  for (const auto orderNodeNum : mNodeOrder) {
+    if (mParentNodes.at(orderNodeNum) == nodeNum) {
+      childNodes.push_back(orderNodeNum);
+    }
+  }
+  return childNodes;
+}
+
+std::string GltfSkeletonTopology::getNodeName(int nodeNum) {
+  return mNodeNames.at(nodeNum);
+}
+
+const std::vector<int> &GltfSkeletonTopology::getNodeOrder() {
+  return mNodeOrder;
+}
+
+const std::vector<int> &GltfSkeletonTopology::getParentNodes() {
+  return mParentNodes;
+}
+
+int GltfSkeletonTopology::getOrderIndex(int nodeNum) {
+  return mOrderIndices.at(nodeNum);
+}
+
+int GltfSkeletonTopology::getSubtreeSize(int nodeNum) {
+  return mSubtreeSizes.at(nodeNum);
+}
+
+const std::vector<glm::vec3> &GltfSkeletonTopology::getBindTranslations() {
+  return mBindTranslations;
+}
+
+const std::vector<glm::quat> &GltfSkeletonTopology::getBindRotations() {
+  return mBindRotations;
+}
+
+const std::vector<glm::vec3> &GltfSkeletonTopology::getBindScales() {
+  return mBindScales;
+}
+
+int GltfSkeletonTopology::getJointCount() {
+  return mInverseBindMatrices.size();
+}
+
+const std::vector<int> &GltfSkeletonTopology::getNodeToJoint() {
+  return mNodeToJoint;
+}
+
+const std::vector<glm::mat4x3> &GltfSkeletonTopology::getInverseBindMatrices() {
+  return mInverseBindMatrices;
+}
+
+const std::vector<glm::quat> &GltfSkeletonTopology::getInverseBindRotations() {
+  return mInverseBindRotations;
+}
+
+const std::vector<glm::vec3> &GltfSkeletonTopology::getInverseBindTranslations() {
+  return mInverseBindTranslations;
+}
@@ -0,0 +1,83 @@
+#include "InstanceManager.h"
+#include "Logger.h"
+
+void InstanceManager::init(std::shared_ptr<GltfModel> model, int maxInstances) {
+  mGltfModel = model;
+
+  mInstances.clear();
+  mInstances.shrink_to_fit();
+  mInstances.reserve(maxInstances);
+  mFlags.clear();
+  mFlags.reserve(maxInstances);
+  mWorldMatrices.clear();
+  mWorldMatrices.reserve(maxInstances);
+}
+
+int InstanceManager::addInstance(glm::vec2 worldPos, bool randomize) {
+  /* a reallocation would invalidate all pointers to the instances */
+  if (mInstances.size() == mInstances.capacity()) {
+    Logger::log(1, "%s error: no space for another instance\n", __FUNCTION__);
+    return -1;
+  }
+
+  mInstances.emplace_back(mGltfModel, worldPos, randomize);
+  mFlags.emplace_back();
+  mWorldMatrices.emplace_back(1.0f);
+
+  int handle = mInstances.size() - 1;
+  updateComponents(handle);
+  return handle;
+}
+
+int InstanceManager::getInstanceCount() {
+  return mInstances.size();
+}
+
+GltfInstance *InstanceManager::getInstance(int handle) {
+  return &mInstances.at(handle);
+}
+
+int InstanceManager::getHandle(const GltfInstance *instance) {
+  return instance - mInstances.data();
+}
+
+void InstanceManager::setInstanceSettings(int handle, const ModelSettings &settings) {
+  GltfInstance &instance = mInstances.at(handle);
+  instance.setInstanceSettings(settings);
+  instance.checkForUpdates();
+  updateComponents(handle);
+}
+
+void InstanceManager::advanceAnimationTimes(float deltaTime) {
+  for (auto &instance : mInstances) {
+    instance.advanceAnimationTime(deltaTime);
+  }
+}
+
+void InstanceManager::resetAnimationTimes() {
+  for (auto &instance : mInstances) {
+    instance.resetAnimationTime();
+  }
+}
+
+const std::vector<InstanceFlags> &InstanceManager::getFlags() {
+  return mFlags;
+}
+
+const std::vector<glm::mat4> &InstanceManager::getWorldMatrices() {
+  return mWorldMatrices;
+}
+
+void InstanceManager::updateComponents(int handle) {
+  GltfInstance &instance = mInstances.at(handle);
+  const ModelSettings &settings = instance.getInstanceSettings();
+
+  InstanceFlags &flags = mFlags.at(handle);
+  flags.ifDrawModel = settings.msDrawModel;
+  flags.ifDrawSkeleton = settings.msDrawSkeleton;
+  flags.ifBakedAnimation = settings.msBakedAnimation;
+  flags.ifDualQuatSkinning = settings.msVertexSkinningMode == skinningMode::dualQuat;
+  flags.ifInverseKinematics = settings.msIkMode != ikMode::off;
+
+  mWorldMatrices.at(handle) = instance.getWorldMatrix();
+}
@@ -0,0 +1,52 @@
+/* all instances of a model in a single allocation, the data read by the per-frame loops is
+ * kept in arrays indexed by the instance handle */
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "GltfModel.h"
+#include "GltfInstance.h"
+#include "ModelSettings.h"
+
+/* copy of the settings deciding how an instance is updated and drawn */
+struct InstanceFlags {
+  bool ifDrawModel = true;
+  bool ifDrawSkeleton = false;
+  bool ifBakedAnimation = false;
+  bool ifDualQuatSkinning = false;
+  bool ifInverseKinematics = false;
+};
+
+class InstanceManager {
+  public:
+    /* the storage for maxInstances is allocated here, the instances never move */
+    void init(std::shared_ptr<GltfModel> model, int maxInstances);
+    /* returns the handle of the new instance, or -1 if the storage is full */
+    int addInstance(glm::vec2 worldPos, bool randomize);
+    int getInstanceCount();
+
+    /* the pointers stay valid until the next init() call */
+    GltfInstance *getInstance(int handle);
+    int getHandle(const GltfInstance *instance);
+
+    /* applies the settings, must be used for all changes to keep the arrays up to date */
+    void setInstanceSettings(int handle, const ModelSettings &settings);
+
+    /* moves the replay position of all instances, see AnimationClock */
+    void advanceAnimationTimes(float deltaTime);
+    void resetAnimationTimes();
+
+    const std::vector<InstanceFlags> &getFlags();
+    const std::vector<glm::mat4> &getWorldMatrices();
+
+  private:
+    void updateComponents(int handle);
+
+    std::shared_ptr<GltfModel> mGltfModel = nullptr;
+    /* the position in the vector is the handle */
+    std::vector<GltfInstance> mInstances{};
+
+    std::vector<InstanceFlags> mFlags{};
+    std::vector<glm::mat4> mWorldMatrices{};
+};
@@ -0,0 +1,35 @@
+/* blends any number of clips over a base pose, every track is sampled once per layer */
+#pragma once
+#include <vector>
+
+#include "GltfAnimationClip.h"
+#include "PoseBuffer.h"
+
+enum class layerMode {
+  /* blends towards the clip */
+  override = 0,
+  /* adds the difference of the clip to the base pose */
+  additive
+};
+
+/* the layers are applied in order, each one over the result of the layers before */
+struct AnimationLayer {
+  GltfAnimationClip *clip = nullptr;
+  std::vector<unsigned int> *keyCursors = nullptr;
+  float time = 0.0f;
+  float weight = 1.0f;
+  /* per node, multiplied with the weight. all nodes use the weight if not set */
+  const std::vector<float> *nodeWeights = nullptr;
+  /* sampled tracks, see GltfModel::getTrackMask() */
+  int trackMask = GltfAnimationClip::mAllTracks;
+  layerMode mode = layerMode::override;
+};
+
+class LayeredBlend {
+  public:
+    /* result gets the blended pose of the nodes in nodeMask, the properties not animated by
+     * any layer are not marked as written. basePose must contain all nodes. the track masks
+     * of the layers should not contain nodes outside of nodeMask */
+    static void evaluate(const std::vector<AnimationLayer> &layers, const PoseBuffer &basePose,
+      const std::vector<bool> &nodeMask, PoseBuffer &result);
+};
@@ -0,0 +1,10 @@
+/* data of a glTF model shown in the UI, shared by all instances */
+#pragma once
+#include <vector>
+#include <string>
+
+struct ModelMetadata {
+  std::vector<std::string> mdClipNames{};
+  /* nodes outside of the skeleton are named "(invalid)" */
+  std::vector<std::string> mdSkelNodeNames{};
+};
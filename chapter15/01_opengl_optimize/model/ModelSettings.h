@@ -1,3 +1,4 @@
+/* per-instance settings, read every frame. the names are in ModelMetadata */
 #pragma once
 struct ModelSettings {
   glm::vec2 msWorldPosition = glm::vec2(0.0f);
@@ -6,6 +7,8 @@ struct ModelSettings {
   bool msDrawModel = true;
   bool msDrawSkeleton = false;
   skinningMode msVertexSkinningMode = skinningMode::linear;
+  /* replay of msAnimClip from the baked palettes, no blending and inverse kinematics */
+  bool msBakedAnimation = false;
 
   bool msPlayAnimation = true;
   replayDirection msAnimationPlayDirection = replayDirection::forward;
@@ -20,10 +23,6 @@ struct ModelSettings {
   float msAnimCrossBlendFactor = 0.0f;
   int msSkelSplitNode = 0;
 
-  std::vector<std::string> msClipNames{};
-  /* saved per instance as the node list is created here */
-  std::vector<std::string> msSkelNodeNames{};
-
   ikMode msIkMode = ikMode::off;
   int msIkIterations = 10;
   glm::vec3 msIkTargetPos = glm::vec3(0.0f, 3.0f, 1.0f);
@@ -0,0 +1,65 @@
+#include <algorithm>
+
+#include "PoseArena.h"
+
+std::atomic<unsigned int> PoseArena::mCurrentFrame = 0;
+
+PoseArena &PoseArena::getThreadArena() {
+  thread_local PoseArena arena{};
+  unsigned int frame = mCurrentFrame.load(std::memory_order_relaxed);
+  if (arena.mFrame != frame) {
+    arena.reset();
+    arena.mFrame = frame;
+  }
+  return arena;
+}
+
+void PoseArena::nextFrame() {
+  mCurrentFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+PoseBuffer PoseArena::allocatePose(int nodeCount) {
+  PoseBuffer pose{};
+  pose.nodeCount = nodeCount;
+  pose.translations = allocate<glm::vec3>(nodeCount);
+  pose.rotations = allocate<glm::quat>(nodeCount);
+  pose.scales = allocate<glm::vec3>(nodeCount);
+  pose.written = allocate<unsigned char>(nodeCount);
+  std::fill(pose.written, pose.written + nodeCount, 0);
+  return pose;
+}
+
+size_t PoseArena::getMark() {
+  return mOffset;
+}
+
+void PoseArena::release(size_t mark) {
+  /* a mark from an older block only frees the start of the current one */
+  if (mark < mOffset) {
+    mOffset = mark;
+  }
+}
+
+void PoseArena::reset() {
+  mRetiredBlocks.clear();
+  mOffset = 0;
+}
+
+size_t PoseArena::getCapacity() {
+  return mBlockSize;
+}
+
+void *PoseArena::allocateBytes(size_t size, size_t alignment) {
+  size_t offset = (mOffset + alignment - 1) & ~(alignment - 1);
+  if (!mBlock || offset + size > mBlockSize) {
+    /* the old block may still be in use, the next frame only uses the new one */
+    if (mBlock) {
+      mRetiredBlocks.push_back(std::move(mBlock));
+    }
+    mBlockSize = std::max({mMinBlockSize, mBlockSize * 2, size + alignment});
+    mBlock = std::make_unique<unsigned char[]>(mBlockSize);
+    offset = 0;
+  }
+  mOffset = offset + size;
+  return mBlock.get() + offset;
+}
@@ -0,0 +1,46 @@
+/* bump allocator for the temporary poses and buffers of a frame, one arena per thread.
+ * the memory is kept for the next frames, no heap allocations once the arena is large enough */
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+
+#include "PoseBuffer.h"
+
+class PoseArena {
+  public:
+    /* arena of the calling thread, reset on the first use in a new frame */
+    static PoseArena &getThreadArena();
+    /* starts a new frame for the arenas of all threads */
+    static void nextFrame();
+
+    /* uninitialized memory, valid until reset() or release() */
+    template <typename T>
+    T *allocate(size_t count) {
+      return static_cast<T *>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+    /* nothing is marked as written */
+    PoseBuffer allocatePose(int nodeCount);
+
+    /* release() hands out the memory allocated after getMark() again */
+    size_t getMark();
+    void release(size_t mark);
+    void reset();
+
+    size_t getCapacity();
+
+  private:
+    void *allocateBytes(size_t size, size_t alignment);
+
+    std::unique_ptr<unsigned char[]> mBlock = nullptr;
+    size_t mBlockSize = 0;
+    size_t mOffset = 0;
+    /* blocks that were too small, still in use until the next reset */
+    std::vector<std::unique_ptr<unsigned char[]>> mRetiredBlocks{};
+
+    unsigned int mFrame = 0;
+    static std::atomic<unsigned int> mCurrentFrame;
+
+    static const size_t mMinBlockSize = 64 * 1024;
+};
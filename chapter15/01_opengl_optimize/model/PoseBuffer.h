@@ -0,0 +1,18 @@
+/* local transforms of the nodes of a skeleton, indexed by the glTF node number. the memory
+ * belongs to a PoseArena, see PoseArena::allocatePose() */
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+struct PoseBuffer {
+  int nodeCount = 0;
+  glm::vec3 *translations = nullptr;
+  glm::quat *rotations = nullptr;
+  glm::vec3 *scales = nullptr;
+  /* properties set by sampling or blending, combination of the bits below */
+  unsigned char *written = nullptr;
+
+  static const unsigned char mTranslationBit = 1;
+  static const unsigned char mRotationBit = 2;
+  static const unsigned char mScaleBit = 4;
+};
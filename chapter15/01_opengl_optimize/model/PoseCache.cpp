@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "PoseCache.h"
+
+void PoseCache::updateAnimations(std::vector<GltfInstance*> &instances,
+    float timeStep, AnimationBatch *batch) {
+  mTaskGraph.clear();
+  addTasks(mTaskGraph, instances, timeStep, batch, mPoseTasks);
+  if (mThreadPool) {
+    mThreadPool->run(mTaskGraph);
+  } else {
+    mTaskGraph.runSerial();
+  }
+}
+
+void PoseCache::addTasks(TaskGraph &graph, std::vector<GltfInstance*> &instances,
+    float timeStep, AnimationBatch *batch, std::vector<int> &poseTasks) {
+  mPoseKeys.clear();
+  mSourceInstances.clear();
+  mSourceTimes.clear();
+  mSourceNums.clear();
+  mPoseCopies.clear();
+  mTimes.resize(instances.size());
+  mPoseSources.assign(instances.size(), -1);
+  mSourceNumbers.resize(instances.size());
+
+  for (int i = 0; i < instances.size(); ++i) {
+    PoseKey key{};
+    if (instances.at(i)->getPoseKey(timeStep, key, mTimes.at(i))) {
+      mPoseKeys.emplace_back(key, i);
+    }
+  }
+  mLookups = mPoseKeys.size();
+
+  /* no map nodes to allocate, the first instance with a key animates the pose */
+  std::sort(mPoseKeys.begin(), mPoseKeys.end());
+  for (int i = 0; i < mPoseKeys.size(); ++i) {
+    bool sameKey = i > 0 && !(mPoseKeys.at(i - 1).first < mPoseKeys.at(i).first);
+    mPoseSources.at(mPoseKeys.at(i).second) = sameKey ?
+      mPoseSources.at(mPoseKeys.at(i - 1).second) : mPoseKeys.at(i).second;
+  }
+
+  mHits = 0;
+  for (int i = 0; i < instances.size(); ++i) {
+    int source = mPoseSources.at(i);
+    /* a paused instance keeps its own or copied pose, the batch only updates the matrices */
+    if (source >= 0 && source != i && !instances.at(i)->isPoseValid(mTimes.at(i))) {
+      ++mHits;
+      mPoseCopies.emplace_back(i, mSourceNumbers.at(source));
+      continue;
+    }
+    mSourceNumbers.at(i) = mSourceInstances.size();
+    mSourceInstances.push_back(instances.at(i));
+    mSourceTimes.push_back(mTimes.at(i));
+    mSourceNums.push_back(i);
+  }
+
+  if (batch) {
+    batch->addTasks(graph, mSourceInstances, mSourceTimes, mSourceTasks);
+  } else {
+    mSourceTasks.resize(mSourceInstances.size());
+    for (int i = 0; i < mSourceInstances.size(); ++i) {
+      GltfInstance *instance = mSourceInstances.at(i);
+      float time = mSourceTimes.at(i);
+      mSourceTasks.at(i) = graph.addTask([instance, time]() {
+        instance->updateAnimation(time);
+      });
+    }
+  }
+
+  poseTasks.resize(instances.size());
+  for (int i = 0; i < mSourceInstances.size(); ++i) {
+    poseTasks.at(mSourceNums.at(i)) = mSourceTasks.at(i);
+  }
+
+  /* a copy only waits for the pose of its source */
+  for (const auto &poseCopy : mPoseCopies) {
+    GltfInstance *instance = instances.at(poseCopy.first);
+    /* two pointers fit into the std::function without a heap allocation */
+    GltfInstance *source = mSourceInstances.at(poseCopy.second);
+    poseTasks.at(poseCopy.first) = graph.addTask([instance, source]() {
+      instance->copyPose(source);
+    });
+    graph.addDependency(poseTasks.at(poseCopy.first), mSourceTasks.at(poseCopy.second));
+  }
+}
+
+void PoseCache::setThreadPool(ThreadPool *threadPool) {
+  mThreadPool = threadPool;
+}
+
+int PoseCache::getLookups() {
+  return mLookups;
+}
+
+int PoseCache::getHits() {
+  return mHits;
+}
+
+float PoseCache::getHitRate() {
+  if (mLookups == 0) {
+    return 0.0f;
+  }
+  return static_cast<float>(mHits) / static_cast<float>(mLookups) * 100.0f;
+}
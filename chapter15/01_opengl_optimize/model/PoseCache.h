@@ -0,0 +1,55 @@
+/* instances at the same clip time with the same blending share a single evaluated pose */
+#pragma once
+#include <vector>
+#include <memory>
+
+#include "GltfInstance.h"
+#include "AnimationBatch.h"
+#include "ThreadPool.h"
+#include "TaskGraph.h"
+
+class PoseCache {
+  public:
+    /* animates one instance per pose, the others copy the joint matrices.
+     * times are rounded to timeStep, batch is used if set */
+    void updateAnimations(std::vector<GltfInstance*> &instances,
+      float timeStep, AnimationBatch *batch);
+    /* same as updateAnimations(), as tasks of the graph. poseTasks gets the task creating
+     * the pose of every instance, a copy depends on the task of its source */
+    void addTasks(TaskGraph &graph, std::vector<GltfInstance*> &instances,
+      float timeStep, AnimationBatch *batch, std::vector<int> &poseTasks);
+
+    int getLookups();
+    int getHits();
+    /* in percent */
+    float getHitRate();
+
+    /* updateAnimations() runs the tasks in parallel if set */
+    void setThreadPool(ThreadPool *threadPool);
+
+  private:
+    /* key and position of the instances that can share a pose, sorted to find the equal
+     * keys. the memory is kept for the next frames */
+    std::vector<std::pair<PoseKey, int>> mPoseKeys{};
+    /* position of the instance animating the pose, per instance. -1 if not shared */
+    std::vector<int> mPoseSources{};
+    std::vector<float> mTimes{};
+
+    /* instances to animate, and the instances copying the pose of a source */
+    std::vector<GltfInstance*> mSourceInstances{};
+    std::vector<float> mSourceTimes{};
+    /* position of the source in the instances, and the task creating the pose */
+    std::vector<int> mSourceNums{};
+    std::vector<int> mSourceTasks{};
+    /* number of the source, per position in the instances */
+    std::vector<int> mSourceNumbers{};
+    /* position of the copy in the instances and the number of the source */
+    std::vector<std::pair<int, int>> mPoseCopies{};
+
+    int mLookups = 0;
+    int mHits = 0;
+
+    ThreadPool *mThreadPool = nullptr;
+    TaskGraph mTaskGraph{};
+    std::vector<int> mPoseTasks{};
+};
@@ -0,0 +1,490 @@
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define POSE_KERNELS_X86
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+/* GCC and Clang need the instruction set per function, MSVC allows all intrinsics */
+#if defined(POSE_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+  #define POSE_KERNELS_SSE __attribute__((target("sse2")))
+  #define POSE_KERNELS_AVX2 __attribute__((target("avx2,fma")))
+#else
+  #define POSE_KERNELS_SSE
+  #define POSE_KERNELS_AVX2
+#endif
+
+#include "PoseKernels.h"
+#include "Logger.h"
+
+ESimdLevel PoseKernels::mSimdLevel = PoseKernels::detectSimdLevel();
+
+namespace {
+  /* slerp without trigonometric functions, from D. Eberly, "A Fast and Accurate Algorithm
+   * for Computing SLERP". sin(t * angle) / sin(angle) is a polynomial in cos(angle) - 1,
+   * the last of the eight terms is corrected to keep the error below 2e-5 */
+  constexpr float slerpOnePlusMu = 1.85298109240830f;
+  constexpr float slerpU[8] = {
+    1.0f / (1.0f * 3.0f), 1.0f / (2.0f * 5.0f), 1.0f / (3.0f * 7.0f), 1.0f / (4.0f * 9.0f),
+    1.0f / (5.0f * 11.0f), 1.0f / (6.0f * 13.0f), 1.0f / (7.0f * 15.0f),
+    slerpOnePlusMu / (8.0f * 17.0f)
+  };
+  constexpr float slerpV[8] = {
+    1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f,
+    5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f,
+    slerpOnePlusMu * 8.0f / 17.0f
+  };
+
+  void lerpVec3Scalar(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int c = 0; c < 3; ++c) {
+      for (int i = 0; i < stride; ++i) {
+        int index = c * stride + i;
+        result[index] = prev[index] + factor[i] * (next[index] - prev[index]);
+      }
+    }
+  }
+
+  void nlerpQuatScalar(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; ++i) {
+      float value[4];
+      float lengthSq = 0.0f;
+      for (int c = 0; c < 4; ++c) {
+        int index = c * stride + i;
+        value[c] = prev[index] * (1.0f - factor[i]) + next[index] * factor[i];
+        lengthSq += value[c] * value[c];
+      }
+      float length = std::sqrt(lengthSq);
+      for (int c = 0; c < 4; ++c) {
+        result[c * stride + i] = value[c] / length;
+      }
+    }
+  }
+
+  void slerpQuatScalar(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; ++i) {
+      float dot = 0.0f;
+      for (int c = 0; c < 4; ++c) {
+        dot += prev[c * stride + i] * next[c * stride + i];
+      }
+      /* take the shorter path */
+      float sign = dot < 0.0f ? -1.0f : 1.0f;
+      float cosMinusOne = dot * sign - 1.0f;
+
+      float t = factor[i];
+      float d = 1.0f - t;
+      float tSq = t * t;
+      float dSq = d * d;
+      float bT = 1.0f;
+      float bD = 1.0f;
+      for (int j = 7; j >= 0; --j) {
+        bT = 1.0f + (slerpU[j] * tSq - slerpV[j]) * cosMinusOne * bT;
+        bD = 1.0f + (slerpU[j] * dSq - slerpV[j]) * cosMinusOne * bD;
+      }
+      float coeffNext = sign * t * bT;
+      float coeffPrev = d * bD;
+
+      for (int c = 0; c < 4; ++c) {
+        int index = c * stride + i;
+        result[index] = prev[index] * coeffPrev + next[index] * coeffNext;
+      }
+    }
+  }
+
+  void composeTRSScalar(const float *translation, const float *rotation, const float *scale,
+      float *matrices, int stride) {
+    for (int i = 0; i < stride; ++i) {
+      float x = rotation[i];
+      float y = rotation[stride + i];
+      float z = rotation[2 * stride + i];
+      float w = rotation[3 * stride + i];
+      float sx = scale[i];
+      float sy = scale[stride + i];
+      float sz = scale[2 * stride + i];
+
+      /* same as glm::mat4_cast() */
+      matrices[i] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+      matrices[stride + i] = 2.0f * (x * y + w * z) * sx;
+      matrices[2 * stride + i] = 2.0f * (x * z - w * y) * sx;
+      matrices[3 * stride + i] = 2.0f * (x * y - w * z) * sy;
+      matrices[4 * stride + i] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+      matrices[5 * stride + i] = 2.0f * (y * z + w * x) * sy;
+      matrices[6 * stride + i] = 2.0f * (x * z + w * y) * sz;
+      matrices[7 * stride + i] = 2.0f * (y * z - w * x) * sz;
+      matrices[8 * stride + i] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+      matrices[9 * stride + i] = translation[i];
+      matrices[10 * stride + i] = translation[stride + i];
+      matrices[11 * stride + i] = translation[2 * stride + i];
+    }
+  }
+
+#ifdef POSE_KERNELS_X86
+  POSE_KERNELS_SSE
+  void lerpVec3SSE(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; i += 4) {
+      __m128 t = _mm_loadu_ps(factor + i);
+      for (int c = 0; c < 3; ++c) {
+        int index = c * stride + i;
+        __m128 p = _mm_loadu_ps(prev + index);
+        __m128 n = _mm_loadu_ps(next + index);
+        _mm_storeu_ps(result + index, _mm_add_ps(p, _mm_mul_ps(t, _mm_sub_ps(n, p))));
+      }
+    }
+  }
+
+  POSE_KERNELS_SSE
+  void nlerpQuatSSE(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; i += 4) {
+      __m128 t = _mm_loadu_ps(factor + i);
+      __m128 d = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+      __m128 value[4];
+      __m128 lengthSq = _mm_setzero_ps();
+      for (int c = 0; c < 4; ++c) {
+        int index = c * stride + i;
+        value[c] = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(prev + index), d),
+          _mm_mul_ps(_mm_loadu_ps(next + index), t));
+        lengthSq = _mm_add_ps(lengthSq, _mm_mul_ps(value[c], value[c]));
+      }
+      __m128 length = _mm_sqrt_ps(lengthSq);
+      for (int c = 0; c < 4; ++c) {
+        _mm_storeu_ps(result + c * stride + i, _mm_div_ps(value[c], length));
+      }
+    }
+  }
+
+  POSE_KERNELS_SSE
+  void slerpQuatSSE(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (int i = 0; i < stride; i += 4) {
+      __m128 p[4];
+      __m128 n[4];
+      __m128 dot = _mm_setzero_ps();
+      for (int c = 0; c < 4; ++c) {
+        p[c] = _mm_loadu_ps(prev + c * stride + i);
+        n[c] = _mm_loadu_ps(next + c * stride + i);
+        dot = _mm_add_ps(dot, _mm_mul_ps(p[c], n[c]));
+      }
+      /* take the shorter path, flip the sign of the next coefficient */
+      __m128 sign = _mm_and_ps(dot, signBit);
+      __m128 cosMinusOne = _mm_sub_ps(_mm_xor_ps(dot, sign), one);
+
+      __m128 t = _mm_loadu_ps(factor + i);
+      __m128 d = _mm_sub_ps(one, t);
+      __m128 tSq = _mm_mul_ps(t, t);
+      __m128 dSq = _mm_mul_ps(d, d);
+      __m128 bT = one;
+      __m128 bD = one;
+      for (int j = 7; j >= 0; --j) {
+        __m128 u = _mm_set1_ps(slerpU[j]);
+        __m128 v = _mm_set1_ps(slerpV[j]);
+        bT = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, tSq), v),
+          cosMinusOne), bT));
+        bD = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, dSq), v),
+          cosMinusOne), bD));
+      }
+      __m128 coeffNext = _mm_xor_ps(_mm_mul_ps(t, bT), sign);
+      __m128 coeffPrev = _mm_mul_ps(d, bD);
+
+      for (int c = 0; c < 4; ++c) {
+        _mm_storeu_ps(result + c * stride + i, _mm_add_ps(_mm_mul_ps(p[c], coeffPrev),
+          _mm_mul_ps(n[c], coeffNext)));
+      }
+    }
+  }
+
+  POSE_KERNELS_SSE
+  void composeTRSSSE(const float *translation, const float *rotation, const float *scale,
+      float *matrices, int stride) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (int i = 0; i < stride; i += 4) {
+      __m128 x = _mm_loadu_ps(rotation + i);
+      __m128 y = _mm_loadu_ps(rotation + stride + i);
+      __m128 z = _mm_loadu_ps(rotation + 2 * stride + i);
+      __m128 w = _mm_loadu_ps(rotation + 3 * stride + i);
+      __m128 sx = _mm_mul_ps(two, _mm_loadu_ps(scale + i));
+      __m128 sy = _mm_mul_ps(two, _mm_loadu_ps(scale + stride + i));
+      __m128 sz = _mm_mul_ps(two, _mm_loadu_ps(scale + 2 * stride + i));
+
+      __m128 xx = _mm_mul_ps(x, x);
+      __m128 yy = _mm_mul_ps(y, y);
+      __m128 zz = _mm_mul_ps(z, z);
+      __m128 xy = _mm_mul_ps(x, y);
+      __m128 xz = _mm_mul_ps(x, z);
+      __m128 yz = _mm_mul_ps(y, z);
+      __m128 wx = _mm_mul_ps(w, x);
+      __m128 wy = _mm_mul_ps(w, y);
+      __m128 wz = _mm_mul_ps(w, z);
+
+      /* 1 - 2a as (0.5 - a) * 2, the factor 2 is part of the scale */
+      _mm_storeu_ps(matrices + i, _mm_mul_ps(_mm_sub_ps(half, _mm_add_ps(yy, zz)), sx));
+      _mm_storeu_ps(matrices + stride + i, _mm_mul_ps(_mm_add_ps(xy, wz), sx));
+      _mm_storeu_ps(matrices + 2 * stride + i, _mm_mul_ps(_mm_sub_ps(xz, wy), sx));
+      _mm_storeu_ps(matrices + 3 * stride + i, _mm_mul_ps(_mm_sub_ps(xy, wz), sy));
+      _mm_storeu_ps(matrices + 4 * stride + i, _mm_mul_ps(_mm_sub_ps(half, _mm_add_ps(xx, zz)), sy));
+      _mm_storeu_ps(matrices + 5 * stride + i, _mm_mul_ps(_mm_add_ps(yz, wx), sy));
+      _mm_storeu_ps(matrices + 6 * stride + i, _mm_mul_ps(_mm_add_ps(xz, wy), sz));
+      _mm_storeu_ps(matrices + 7 * stride + i, _mm_mul_ps(_mm_sub_ps(yz, wx), sz));
+      _mm_storeu_ps(matrices + 8 * stride + i, _mm_mul_ps(_mm_sub_ps(half, _mm_add_ps(xx, yy)), sz));
+      _mm_storeu_ps(matrices + 9 * stride + i, _mm_loadu_ps(translation + i));
+      _mm_storeu_ps(matrices + 10 * stride + i, _mm_loadu_ps(translation + stride + i));
+      _mm_storeu_ps(matrices + 11 * stride + i, _mm_loadu_ps(translation + 2 * stride + i));
+    }
+  }
+
+  POSE_KERNELS_AVX2
+  void lerpVec3AVX2(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; i += 8) {
+      __m256 t = _mm256_loadu_ps(factor + i);
+      for (int c = 0; c < 3; ++c) {
+        int index = c * stride + i;
+        __m256 p = _mm256_loadu_ps(prev + index);
+        __m256 n = _mm256_loadu_ps(next + index);
+        _mm256_storeu_ps(result + index, _mm256_fmadd_ps(t, _mm256_sub_ps(n, p), p));
+      }
+    }
+  }
+
+  POSE_KERNELS_AVX2
+  void nlerpQuatAVX2(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    for (int i = 0; i < stride; i += 8) {
+      __m256 t = _mm256_loadu_ps(factor + i);
+      __m256 d = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+      __m256 value[4];
+      __m256 lengthSq = _mm256_setzero_ps();
+      for (int c = 0; c < 4; ++c) {
+        int index = c * stride + i;
+        value[c] = _mm256_fmadd_ps(_mm256_loadu_ps(prev + index), d,
+          _mm256_mul_ps(_mm256_loadu_ps(next + index), t));
+        lengthSq = _mm256_fmadd_ps(value[c], value[c], lengthSq);
+      }
+      __m256 length = _mm256_sqrt_ps(lengthSq);
+      for (int c = 0; c < 4; ++c) {
+        _mm256_storeu_ps(result + c * stride + i, _mm256_div_ps(value[c], length));
+      }
+    }
+  }
+
+  POSE_KERNELS_AVX2
+  void slerpQuatAVX2(const float *prev, const float *next, const float *factor,
+      float *result, int stride) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    for (int i = 0; i < stride; i += 8) {
+      __m256 p[4];
+      __m256 n[4];
+      __m256 dot = _mm256_setzero_ps();
+      for (int c = 0; c < 4; ++c) {
+        p[c] = _mm256_loadu_ps(prev + c * stride + i);
+        n[c] = _mm256_loadu_ps(next + c * stride + i);
+        dot = _mm256_fmadd_ps(p[c], n[c], dot);
+      }
+      __m256 sign = _mm256_and_ps(dot, signBit);
+      __m256 cosMinusOne = _mm256_sub_ps(_mm256_xor_ps(dot, sign), one);
+
+      __m256 t = _mm256_loadu_ps(factor + i);
+      __m256 d = _mm256_sub_ps(one, t);
+      __m256 tSq = _mm256_mul_ps(t, t);
+      __m256 dSq = _mm256_mul_ps(d, d);
+      __m256 bT = one;
+      __m256 bD = one;
+      for (int j = 7; j >= 0; --j) {
+        __m256 u = _mm256_set1_ps(slerpU[j]);
+        __m256 v = _mm256_set1_ps(slerpV[j]);
+        bT = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, tSq, v), cosMinusOne), bT, one);
+        bD = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, dSq, v), cosMinusOne), bD, one);
+      }
+      __m256 coeffNext = _mm256_xor_ps(_mm256_mul_ps(t, bT), sign);
+      __m256 coeffPrev = _mm256_mul_ps(d, bD);
+
+      for (int c = 0; c < 4; ++c) {
+        _mm256_storeu_ps(result + c * stride + i, _mm256_fmadd_ps(p[c], coeffPrev,
+          _mm256_mul_ps(n[c], coeffNext)));
+      }
+    }
+  }
+
+  POSE_KERNELS_AVX2
+  void composeTRSAVX2(const float *translation, const float *rotation, const float *scale,
+      float *matrices, int stride) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    for (int i = 0; i < stride; i += 8) {
+      __m256 x = _mm256_loadu_ps(rotation + i);
+      __m256 y = _mm256_loadu_ps(rotation + stride + i);
+      __m256 z = _mm256_loadu_ps(rotation + 2 * stride + i);
+      __m256 w = _mm256_loadu_ps(rotation + 3 * stride + i);
+      __m256 sx = _mm256_mul_ps(two, _mm256_loadu_ps(scale + i));
+      __m256 sy = _mm256_mul_ps(two, _mm256_loadu_ps(scale + stride + i));
+      __m256 sz = _mm256_mul_ps(two, _mm256_loadu_ps(scale + 2 * stride + i));
+
+      __m256 xx = _mm256_mul_ps(x, x);
+      __m256 yy = _mm256_mul_ps(y, y);
+      __m256 zz = _mm256_mul_ps(z, z);
+      __m256 xy = _mm256_mul_ps(x, y);
+      __m256 xz = _mm256_mul_ps(x, z);
+      __m256 yz = _mm256_mul_ps(y, z);
+      __m256 wx = _mm256_mul_ps(w, x);
+      __m256 wy = _mm256_mul_ps(w, y);
+      __m256 wz = _mm256_mul_ps(w, z);
+
+      _mm256_storeu_ps(matrices + i, _mm256_mul_ps(_mm256_sub_ps(half, _mm256_add_ps(yy, zz)), sx));
+      _mm256_storeu_ps(matrices + stride + i, _mm256_mul_ps(_mm256_add_ps(xy, wz), sx));
+      _mm256_storeu_ps(matrices + 2 * stride + i, _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx));
+      _mm256_storeu_ps(matrices + 3 * stride + i, _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy));
+      _mm256_storeu_ps(matrices + 4 * stride + i, _mm256_mul_ps(_mm256_sub_ps(half, _mm256_add_ps(xx, zz)), sy));
+      _mm256_storeu_ps(matrices + 5 * stride + i, _mm256_mul_ps(_mm256_add_ps(yz, wx), sy));
+      _mm256_storeu_ps(matrices + 6 * stride + i, _mm256_mul_ps(_mm256_add_ps(xz, wy), sz));
+      _mm256_storeu_ps(matrices + 7 * stride + i, _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz));
+      _mm256_storeu_ps(matrices + 8 * stride + i, _mm256_mul_ps(_mm256_sub_ps(half, _mm256_add_ps(xx, yy)), sz));
+      _mm256_storeu_ps(matrices + 9 * stride + i, _mm256_loadu_ps(translation + i));
+      _mm256_storeu_ps(matrices + 10 * stride + i, _mm256_loadu_ps(translation + stride + i));
+      _mm256_storeu_ps(matrices + 11 * stride + i, _mm256_loadu_ps(translation + 2 * stride + i));
+    }
+  }
+#endif
+}
+
+ESimdLevel PoseKernels::detectSimdLevel() {
+  ESimdLevel level = ESimdLevel::SCALAR;
+#if defined(POSE_KERNELS_X86) && defined(_MSC_VER)
+  int cpuInfo[4];
+  __cpuid(cpuInfo, 1);
+  bool hasSSE2 = (cpuInfo[3] & (1 << 26)) != 0;
+  bool hasFMA = (cpuInfo[2] & (1 << 12)) != 0;
+  /* the OS must save the AVX registers too */
+  bool hasOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+  bool hasAVX2 = false;
+  if (hasOSXSave && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(cpuInfo, 7, 0);
+    hasAVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+  }
+  if (hasSSE2) {
+    level = ESimdLevel::SSE;
+  }
+  if (hasAVX2 && hasFMA) {
+    level = ESimdLevel::AVX2;
+  }
+#elif defined(POSE_KERNELS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    level = ESimdLevel::SSE;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    level = ESimdLevel::AVX2;
+  }
+#endif
+  return level;
+}
+
+ESimdLevel PoseKernels::getSupportedLevel() {
+  return detectSimdLevel();
+}
+
+ESimdLevel PoseKernels::getSimdLevel() {
+  return mSimdLevel;
+}
+
+void PoseKernels::setSimdLevel(ESimdLevel level) {
+  ESimdLevel supportedLevel = getSupportedLevel();
+  if (level > supportedLevel) {
+    Logger::log(1, "%s: %s not supported, using %s\n", __FUNCTION__,
+      getSimdLevelName(level).c_str(), getSimdLevelName(supportedLevel).c_str());
+    level = supportedLevel;
+  }
+  mSimdLevel = level;
+}
+
+std::string PoseKernels::getSimdLevelName(ESimdLevel level) {
+  switch (level) {
+    case ESimdLevel::SSE:
+      return "SSE";
+    case ESimdLevel::AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+int PoseKernels::getPaddedLaneCount(int laneCount) {
+  return (laneCount + mLaneAlignment - 1) / mLaneAlignment * mLaneAlignment;
+}
+
+void PoseKernels::lerpVec3(const float *prev, const float *next, const float *factor,
+    float *result, int stride) {
+  switch (mSimdLevel) {
+#ifdef POSE_KERNELS_X86
+    case ESimdLevel::AVX2:
+      lerpVec3AVX2(prev, next, factor, result, stride);
+      break;
+    case ESimdLevel::SSE:
+      lerpVec3SSE(prev, next, factor, result, stride);
+      break;
+#endif
+    default:
+      lerpVec3Scalar(prev, next, factor, result, stride);
+      break;
+  }
+}
+
+void PoseKernels::nlerpQuat(const float *prev, const float *next, const float *factor,
+    float *result, int stride) {
+  switch (mSimdLevel) {
+#ifdef POSE_KERNELS_X86
+    case ESimdLevel::AVX2:
+      nlerpQuatAVX2(prev, next, factor, result, stride);
+      break;
+    case ESimdLevel::SSE:
+      nlerpQuatSSE(prev, next, factor, result, stride);
+      break;
+#endif
+    default:
+      nlerpQuatScalar(prev, next, factor, result, stride);
+      break;
+  }
+}
+
+void PoseKernels::slerpQuat(const float *prev, const float *next, const float *factor,
+    float *result, int stride) {
+  switch (mSimdLevel) {
+#ifdef POSE_KERNELS_X86
+    case ESimdLevel::AVX2:
+      slerpQuatAVX2(prev, next, factor, result, stride);
+      break;
+    case ESimdLevel::SSE:
+      slerpQuatSSE(prev, next, factor, result, stride);
+      break;
+#endif
+    default:
+      slerpQuatScalar(prev, next, factor, result, stride);
+      break;
+  }
+}
+
+void PoseKernels::composeTRS(const float *translation, const float *rotation,
+    const float *scale, float *matrices, int stride) {
+  switch (mSimdLevel) {
+#ifdef POSE_KERNELS_X86
+    case ESimdLevel::AVX2:
+      composeTRSAVX2(translation, rotation, scale, matrices, stride);
+      break;
+    case ESimdLevel::SSE:
+      composeTRSSSE(translation, rotation, scale, matrices, stride);
+      break;
+#endif
+    default:
+      composeTRSScalar(translation, rotation, scale, matrices, stride);
+      break;
+  }
+}
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SkeletonLod.h"
+
+void SkeletonLod::selectLevels(std::vector<GltfInstance*> &instances,
+    glm::vec3 cameraPos, int fieldOfView, int screenHeight, glm::vec3 screenSizes) {
+  for (int i = 0; i < GltfModel::mSkeletonLodCount; ++i) {
+    mLevelInstances[i] = 0;
+  }
+  mSkippedChannels = 0;
+
+  for (auto instance : instances) {
+    glm::vec2 worldPos = instance->getWorldPosition();
+    float distance = glm::length(glm::vec3(worldPos.x, 0.0f, worldPos.y) - cameraPos);
+    float screenSize = getScreenSize(instance->getSkeletonSize(), distance, fieldOfView,
+      screenHeight);
+
+    int level = 0;
+    for (int i = 0; i < GltfModel::mSkeletonLodCount - 1; ++i) {
+      if (screenSize < screenSizes[i]) {
+        level = i + 1;
+      }
+    }
+
+    /* the instance may stay on the full skeleton, e.g. for inverse kinematics */
+    instance->setSkeletonLod(level);
+    ++mLevelInstances[instance->getSkeletonLod()];
+    mSkippedChannels += instance->getSkippedChannelCount();
+  }
+}
+
+void SkeletonLod::resetLevels(std::vector<GltfInstance*> &instances) {
+  for (auto instance : instances) {
+    instance->setSkeletonLod(0);
+  }
+
+  for (int i = 0; i < GltfModel::mSkeletonLodCount; ++i) {
+    mLevelInstances[i] = 0;
+  }
+  mSkippedChannels = 0;
+}
+
+int SkeletonLod::getLevelInstanceCount(int level) {
+  return mLevelInstances[level];
+}
+
+int SkeletonLod::getSkippedChannelCount() {
+  return mSkippedChannels;
+}
+
+float SkeletonLod::getScreenSize(float objectSize, float distance, int fieldOfView,
+    int screenHeight) {
+  /* the object covers the whole screen height at the distance d = size / (2 * tan(fov / 2)) */
+  float viewHeight = 2.0f * std::max(distance, 1e-3f) *
+    std::tan(glm::radians(static_cast<float>(fieldOfView)) * 0.5f);
+  return objectSize / viewHeight * screenHeight;
+}
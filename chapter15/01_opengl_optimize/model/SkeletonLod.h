@@ -0,0 +1,29 @@
+/* screen size based skeleton level of detail of the instances */
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "GltfModel.h"
+#include "GltfInstance.h"
+
+class SkeletonLod {
+  public:
+    /* instances smaller than screenSizes.x, .y and .z pixels use the levels 1, 2 and 3 */
+    void selectLevels(std::vector<GltfInstance*> &instances,
+      glm::vec3 cameraPos, int fieldOfView, int screenHeight, glm::vec3 screenSizes);
+    /* sets all instances back to the full skeleton */
+    void resetLevels(std::vector<GltfInstance*> &instances);
+
+    /* instances per level and skipped channels of the last call */
+    int getLevelInstanceCount(int level);
+    int getSkippedChannelCount();
+
+    /* projected height in pixels of an object of the given size */
+    static float getScreenSize(float objectSize, float distance, int fieldOfView,
+      int screenHeight);
+
+  private:
+    int mLevelInstances[GltfModel::mSkeletonLodCount] = { 0 };
+    int mSkippedChannels = 0;
+};
@@ -18,6 +18,15 @@ struct OGLMesh {
   std::vector<OGLVertex> vertices;
 };
 
+/* per instance data of the baked animation shaders, std430 layout */
+struct BakedInstanceData {
+  glm::mat4 worldMatrix = glm::mat4(1.0f);
+  /* first frame, frame count, joint count, frame rate */
+  glm::vec4 clipData = glm::vec4(0.0f);
+  /* replay speed, time offset and clip length in seconds */
+  glm::vec4 replayData = glm::vec4(0.0f);
+};
+
 enum class skinningMode {
   linear = 0,
   dualQuat
@@ -71,4 +80,52 @@ struct OGLRenderData {
 
   int rdNumberOfInstances = 0;
   int rdCurrentSelectedInstance = 0;
+
+  /* instances are animated and solved on a pool of threads */
+  int rdAnimationThreads = 1;
+  /* time spent in tasks per thread in percent of the frame graph time */
+  std::vector<float> rdWorkerUtilization{};
+
+  /* all instances advance by the same scaled frame time, the fixed step replays the
+   * same poses in every run */
+  bool rdAnimationPaused = false;
+  float rdAnimationTimeScale = 1.0f;
+  bool rdAnimationFixedStep = false;
+  float rdAnimationFixedStepSize = 1.0f / 60.0f;
+  bool rdResetAnimationClock = false;
+  float rdAnimationClockTime = 0.0f;
+
+  /* instances replaying a single clip are evaluated together */
+  bool rdBatchAnimations = true;
+  int rdBatchedInstances = 0;
+
+  /* instances at the same rounded clip time share a pose */
+  bool rdPoseCache = false;
+  float rdPoseCacheTimeStep = 1.0f / 30.0f;
+  float rdPoseCacheHitRate = 0.0f;
+
+  /* baked instances are animated by the shaders only */
+  int rdBakedInstances = 0;
+  bool rdBakeAllInstances = false;
+  bool rdUnbakeAllInstances = false;
+
+  /* instances beyond the distances are animated every 2nd, 4th and 8th frame */
+  bool rdAnimationLod = false;
+  glm::vec3 rdAnimationLodDistances = glm::vec3(25.0f, 50.0f, 100.0f);
+  int rdAnimationLodInstances[4] = { 0 };
+
+  /* instances smaller than the screen sizes in pixels animate fewer joints */
+  bool rdSkeletonLod = false;
+  glm::vec3 rdSkeletonLodScreenSizes = glm::vec3(300.0f, 100.0f, 50.0f);
+  int rdSkeletonLodInstances[4] = { 0 };
+  int rdSkeletonLodSkippedChannels = 0;
+
+  /* node and joint matrices recomputed in the last frame */
+  int rdUpdatedNodes = 0;
+  int rdUpdatedJoints = 0;
+
+  /* IK uses glm::decompose() for the global node transforms, differences are logged */
+  bool rdIkDecomposeValidation = false;
+
+  bool rdRunAnimationBenchmarks = false;
 };
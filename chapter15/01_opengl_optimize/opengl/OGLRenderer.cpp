@@ -10,6 +10,8 @@
 #include "OGLRenderer.h"
 #include "ModelSettings.h"
 #include "Logger.h"
+#include "AnimationBenchmark.h"
+#include "PoseArena.h"
 
 OGLRenderer::OGLRenderer(GLFWwindow *window) {
   mRenderData.rdWindow = window;
@@ -77,6 +79,27 @@ bool OGLRenderer::init(unsigned int width, unsigned int height) {
       __FUNCTION__);
     return false;
   }
+
+  if (!mGltfGPUBakedShader.loadShaders("shader/gltf_gpu_baked.vert", "shader/gltf_gpu.frag")) {
+    Logger::log(1, "%s: glTF GPU baked shader loading failed\n", __FUNCTION__);
+    return false;
+  }
+  if (!mGltfGPUBakedShader.getUniformLocation("aReplayTime")) {
+    Logger::log(1, "%s: failed to get replay time uniform for glTF GPU baked shader\n",
+      __FUNCTION__);
+    return false;
+  }
+
+  if (!mGltfGPUBakedDualQuatShader.loadShaders("shader/gltf_gpu_dquat_baked.vert",
+      "shader/gltf_gpu_dquat.frag")) {
+    Logger::log(1, "%s: glTF GPU baked dual quat shader loading failed\n", __FUNCTION__);
+    return false;
+  }
+  if (!mGltfGPUBakedDualQuatShader.getUniformLocation("aReplayTime")) {
+    Logger::log(1, "%s: failed to get replay time uniform for glTF GPU baked dual quat shader\n",
+      __FUNCTION__);
+    return false;
+  }
   Logger::log(1, "%s: shaders succesfully loaded\n", __FUNCTION__);
 
   mUserInterface.init(mRenderData);
@@ -90,7 +113,14 @@ bool OGLRenderer::init(unsigned int width, unsigned int height) {
   mGltfModel = std::make_shared<GltfModel>();
   std::string modelFilename = "assets/Woman.gltf";
   std::string modelTexFilename = "textures/Woman.png";
-  if (!mGltfModel->loadModel(mRenderData, modelFilename, modelTexFilename)) {
+
+  /* optional animation clip processing, see ModelLoadSettings.h */
+  ModelLoadSettings loadSettings{};
+  loadSettings.mlsReduceKeyframes = false;
+  loadSettings.mlsResampleAnimations = false;
+  loadSettings.mlsCompressAnimations = false;
+
+  if (!mGltfModel->loadModel(mRenderData, modelFilename, modelTexFilename, loadSettings)) {
     Logger::log(1, "%s: loading glTF model '%s' failed\n", __FUNCTION__, modelFilename.c_str());
     return false;
   }
@@ -99,32 +129,70 @@ bool OGLRenderer::init(unsigned int width, unsigned int height) {
 
   Logger::log(1, "%s: glTF model '%s' succesfully loaded\n", __FUNCTION__, modelFilename.c_str());
 
+  /* all clips for the baked instances, uploaded only once */
+  if (!mBakedAnimations.bake(mGltfModel, 30.0f)) {
+    Logger::log(1, "%s: baking the animation clips failed\n", __FUNCTION__);
+    return false;
+  }
+
+  std::vector<glm::mat4> bakedJointMatrices = mBakedAnimations.getJointMatrices();
+  size_t bakedJointMatrixBufferSize = bakedJointMatrices.size() * sizeof(glm::mat4);
+  mBakedJointMatrixSSBuffer.init(bakedJointMatrixBufferSize);
+  mBakedJointMatrixSSBuffer.uploadSsboData(bakedJointMatrices, 3);
+
+  std::vector<glm::mat2x4> bakedJointDualQuats = mBakedAnimations.getJointDualQuats();
+  size_t bakedJointDualQuatBufferSize = bakedJointDualQuats.size() * sizeof(glm::mat2x4);
+  mBakedDualQuatSSBuffer.init(bakedJointDualQuatBufferSize);
+  mBakedDualQuatSSBuffer.uploadSsboData(bakedJointDualQuats, 4);
+
+  Logger::log(1, "%s: baked joint shader storage buffers (size %i and %i bytes) successfully created\n",
+    __FUNCTION__, bakedJointMatrixBufferSize, bakedJointDualQuatBufferSize);
+
   int numTriangles = 0;
 
-  /* create glTF instances from the model */
-  for (int i = 0; i < 1000; ++i) {
+  /* create glTF instances from the model, in a single block of memory */
+  int instanceCount = 1000;
+  mInstanceManager.init(mGltfModel, instanceCount);
+  for (int i = 0; i < instanceCount; ++i) {
     int xPos = std::rand() % 150 - 75;
     int zPos = std::rand() % 150 - 75;
-    mGltfInstances.emplace_back(std::make_shared<GltfInstance>(mGltfModel, glm::vec2(static_cast<float>(xPos),
-      static_cast<float>(zPos)), true));
+    mInstanceManager.addInstance(glm::vec2(static_cast<float>(xPos),
+      static_cast<float>(zPos)), true);
     numTriangles += mGltfModel->getTriangleCount();
   }
 
   mRenderData.rdTriangleCount = numTriangles;
 
-  mRenderData.rdNumberOfInstances = mGltfInstances.size();
+  mRenderData.rdNumberOfInstances = mInstanceManager.getInstanceCount();
+
+  /* instances are animated in parallel, starts with one thread per core */
+  mAnimationBatch.setThreadPool(&mThreadPool);
+  mPoseCache.setThreadPool(&mThreadPool);
+  mRenderData.rdAnimationThreads = mThreadPool.getThreadCount();
 
-  size_t modelJointMatrixBufferSize = mRenderData.rdNumberOfInstances * mGltfInstances.at(0)->getJointMatrixSize() *
+  size_t modelJointMatrixBufferSize = mRenderData.rdNumberOfInstances * mInstanceManager.getInstance(0)->getJointMatrixSize() *
     sizeof(glm::mat4);
-  size_t modelJointDualQuatBufferSize = mRenderData.rdNumberOfInstances * mGltfInstances.at(0)->getJointDualQuatsSize() *
+  size_t modelJointDualQuatBufferSize = mRenderData.rdNumberOfInstances * mInstanceManager.getInstance(0)->getJointDualQuatsSize() *
      sizeof(glm::mat2x4);
 
-  mGltfShaderStorageBuffer.init(modelJointMatrixBufferSize);
+  /* the joints are written by the animation tasks, without an upload */
+  if (!mGltfShaderStorageBuffer.initMapped(modelJointMatrixBufferSize)) {
+    Logger::log(1, "%s error: could not create glTF joint matrix shader storage buffer\n", __FUNCTION__);
+    return false;
+  }
   Logger::log(1, "%s: glTF joint matrix shader storage buffer (size %i bytes) successfully created\n", __FUNCTION__, modelJointMatrixBufferSize);
 
-  mGltfDualQuatSSBuffer.init(modelJointDualQuatBufferSize);
+  if (!mGltfDualQuatSSBuffer.initMapped(modelJointDualQuatBufferSize)) {
+    Logger::log(1, "%s error: could not create glTF joint dual quaternions shader storage buffer\n", __FUNCTION__);
+    return false;
+  }
   Logger::log(1, "%s: glTF joint dual quaternions shader storage buffer (size %i bytes) successfully created\n", __FUNCTION__, modelJointDualQuatBufferSize);
 
+  size_t bakedInstanceBufferSize = mRenderData.rdNumberOfInstances * sizeof(BakedInstanceData);
+  mBakedMatrixInstanceSSBuffer.init(bakedInstanceBufferSize);
+  mBakedDualQuatInstanceSSBuffer.init(bakedInstanceBufferSize);
+  Logger::log(1, "%s: baked instance shader storage buffers (size %i bytes) successfully created\n", __FUNCTION__, bakedInstanceBufferSize);
+
   /* valid, but emtpy */
   mLineMesh = std::make_shared<OGLMesh>();
   Logger::log(1, "%s: line mesh storage initialized\n", __FUNCTION__);
@@ -279,6 +347,12 @@ void OGLRenderer::draw() {
   glClearDepth(1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+  /* run outside of the timers, takes some seconds */
+  if (mRenderData.rdRunAnimationBenchmarks) {
+    AnimationBenchmark::runAll(mGltfModel);
+    mRenderData.rdRunAnimationBenchmarks = false;
+  }
+
   mMatrixGenerateTimer.start();
   mProjectionMatrix = glm::perspective(
     glm::radians(static_cast<float>(mRenderData.rdFieldOfView)),
@@ -287,107 +361,240 @@ void OGLRenderer::draw() {
 
   mViewMatrix = mCamera.getViewMatrix(mRenderData);
 
-  /* animate and update inverse kinematics */
-  mRenderData.rdIKTime = 0.0f;
-  for (auto &instance : mGltfInstances) {
-    instance->updateAnimation();
-
-    mIKTimer.start();
-    instance->solveIK();
-    mRenderData.rdIKTime += mIKTimer.stop();
+  if (mRenderData.rdBakeAllInstances || mRenderData.rdUnbakeAllInstances) {
+    for (int i = 0; i < mInstanceManager.getInstanceCount(); ++i) {
+      ModelSettings instanceSettings = mInstanceManager.getInstance(i)->getInstanceSettings();
+      instanceSettings.msBakedAnimation = mRenderData.rdBakeAllInstances;
+      mInstanceManager.setInstanceSettings(i, instanceSettings);
+    }
+    mRenderData.rdBakeAllInstances = false;
+    mRenderData.rdUnbakeAllInstances = false;
   }
 
-  /* save value to avoid changes during later call */
-  int selectedInstance = mRenderData.rdCurrentSelectedInstance;
-  glm::vec2 modelWorldPos = mGltfInstances.at(selectedInstance)->getWorldPosition();
-  glm::quat modelWorldRot = mGltfInstances.at(selectedInstance)->getWorldRotation();
-
-  mLineMesh->vertices.clear();
-
-  /* get gltTF skeleton */
-  mSkeletonLineIndexCount = 0;
-  for (const auto &instance : mGltfInstances) {
-    ModelSettings settings = instance->getInstanceSettings();
-    if (settings.msDrawSkeleton) {
-      std::shared_ptr<OGLMesh> mesh = instance->getSkeleton();
-      mSkeletonLineIndexCount += mesh->vertices.size();
-      mLineMesh->vertices.insert(mLineMesh->vertices.begin(),
-        mesh->vertices.begin(), mesh->vertices.end());
+  /* one time step for all instances, the system clock is not read per instance */
+  if (mRenderData.rdResetAnimationClock) {
+    mAnimationClock.reset();
+    mInstanceManager.resetAnimationTimes();
+    mRenderData.rdResetAnimationClock = false;
+  }
+  mAnimationClock.setPaused(mRenderData.rdAnimationPaused);
+  mAnimationClock.setTimeScale(mRenderData.rdAnimationTimeScale);
+  mAnimationClock.setFixedStep(mRenderData.rdAnimationFixedStep ?
+    mRenderData.rdAnimationFixedStepSize : 0.0f);
+  mAnimationClock.tick(mRenderData.rdTickDiff);
+  mInstanceManager.advanceAnimationTimes(mAnimationClock.getDeltaTime());
+  mRenderData.rdAnimationClockTime = mAnimationClock.getTime();
+
+  /* the loops over all instances read the flags array, not the instances */
+  const std::vector<InstanceFlags> &instanceFlags = mInstanceManager.getFlags();
+
+  /* baked instances are animated in the shaders */
+  mAnimatedInstances.clear();
+  for (int i = 0; i < mInstanceManager.getInstanceCount(); ++i) {
+    if (!instanceFlags[i].ifBakedAnimation) {
+      mAnimatedInstances.push_back(mInstanceManager.getInstance(i));
     }
   }
+  mRenderData.rdBakedInstances = mInstanceManager.getInstanceCount() - mAnimatedInstances.size();
 
-  /* get coordinate arrows for the IK target of current instance only */
-  mCoordArrowsLineIndexCount = 0;
-  {
-    ModelSettings ikSettings = mGltfInstances.at(selectedInstance)->getInstanceSettings();
-    if (ikSettings.msIkMode == ikMode::ccd ||
-        ikSettings.msIkMode == ikMode::fabrik) {
-      mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
-      mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
-      std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
-        [=](auto &n){
-          n.color /= 2.0f;
-          n.position = modelWorldRot * n.position;
-          n.position += ikSettings.msIkTargetWorldPos;
+  /* distant instances keep their last joint matrices between the updates */
+  if (mRenderData.rdAnimationLod) {
+    mAnimationLod.selectInstances(mInstanceManager, mAnimatedInstances,
+      mRenderData.rdCameraWorldPosition, mRenderData.rdAnimationLodDistances, mLodInstances);
+  }
+  for (int i = 0; i < AnimationLod::mBandCount; ++i) {
+    mRenderData.rdAnimationLodInstances[i] = mRenderData.rdAnimationLod ?
+      mAnimationLod.getBandInstanceCount(i) : 0;
+  }
+  std::vector<GltfInstance*> &updateInstances =
+    mRenderData.rdAnimationLod ? mLodInstances : mAnimatedInstances;
+
+  /* small instances skip the channels and nodes of fingers and toes */
+  if (mRenderData.rdSkeletonLod) {
+    mSkeletonLod.selectLevels(updateInstances, mRenderData.rdCameraWorldPosition,
+      mRenderData.rdFieldOfView, mRenderData.rdHeight, mRenderData.rdSkeletonLodScreenSizes);
+  } else {
+    mSkeletonLod.resetLevels(updateInstances);
+  }
+  for (int i = 0; i < GltfModel::mSkeletonLodCount; ++i) {
+    mRenderData.rdSkeletonLodInstances[i] = mSkeletonLod.getLevelInstanceCount(i);
+  }
+  mRenderData.rdSkeletonLodSkippedChannels = mSkeletonLod.getSkippedChannelCount();
+
+  /* animation, inverse kinematics, joint data packing and the line mesh run as one task
+   * graph. the tasks of an instance only wait for the earlier tasks of the same instance */
+  mThreadPool.setThreadCount(mRenderData.rdAnimationThreads);
+  mThreadPool.resetUtilization();
+  /* the temporary poses of the last frame are no longer used */
+  PoseArena::nextFrame();
+  mFrameGraph.clear();
+
+  mRenderData.rdBatchedInstances = 0;
+  mRenderData.rdPoseCacheHitRate = 0.0f;
+  if (mRenderData.rdPoseCache) {
+    mPoseCache.addTasks(mFrameGraph, updateInstances, mRenderData.rdPoseCacheTimeStep,
+      mRenderData.rdBatchAnimations ? &mAnimationBatch : nullptr, mPoseTasks);
+    mRenderData.rdPoseCacheHitRate = mPoseCache.getHitRate();
+  } else if (mRenderData.rdBatchAnimations) {
+    mAnimationBatch.addTasks(mFrameGraph, updateInstances, mPoseTasks);
+  } else {
+    mPoseTasks.resize(updateInstances.size());
+    for (int i = 0; i < updateInstances.size(); ++i) {
+      GltfInstance *instance = updateInstances.at(i);
+      mPoseTasks.at(i) = mFrameGraph.addTask([instance]() {
+        instance->updateAnimation();
       });
-
-      mLineMesh->vertices.insert(mLineMesh->vertices.end(),
-        mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
     }
   }
+  if (mRenderData.rdBatchAnimations) {
+    mRenderData.rdBatchedInstances = mAnimationBatch.getBatchedInstanceCount();
+  }
 
-  /* draw coordiante arrows*/
-  mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
-  mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
-  std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
-    [=](auto &n){
-      n.color /= 2.0f;
-      n.position = modelWorldRot * n.position;
-      n.position += glm::vec3(modelWorldPos.x, 0.0f, modelWorldPos.y);
-  });
-
-  mLineMesh->vertices.insert(mLineMesh->vertices.end(),
-    mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
-
-  mRenderData.rdMatrixGenerateTime = mMatrixGenerateTimer.stop();
+  /* the last task changing the joints of an instance, by handle */
+  mInstanceTasks.assign(mInstanceManager.getInstanceCount(), -1);
+  for (int i = 0; i < updateInstances.size(); ++i) {
+    mInstanceTasks[mInstanceManager.getHandle(updateInstances[i])] = mPoseTasks.at(i);
+  }
 
-  mUploadToUBOTimer.start();
-  std::vector<glm::mat4> matrixData;
-  matrixData.push_back(mViewMatrix);
-  matrixData.push_back(mProjectionMatrix);
-  mUniformBuffer.uploadUboData(matrixData, 0);
+  GltfSkeleton::setDecomposeValidation(mRenderData.rdIkDecomposeValidation);
+  mIKTimes.assign(updateInstances.size(), 0.0f);
+  for (int i = 0; i < updateInstances.size(); ++i) {
+    GltfInstance *instance = updateInstances.at(i);
+    int handle = mInstanceManager.getHandle(instance);
+    if (!instanceFlags[handle].ifInverseKinematics) {
+      continue;
+    }
+    int ikTask = mFrameGraph.addTask([this, instance, i]() {
+      Timer ikTimer{};
+      ikTimer.start();
+      instance->solveIK();
+      mIKTimes[i] = ikTimer.stop();
+    });
+    mFrameGraph.addDependency(ikTask, mPoseTasks.at(i));
+    mInstanceTasks[handle] = ikTask;
+  }
 
-  mModelJointMatrices.clear();
-  mModelJointDualQuats.clear();
+  /* every instance gets a fixed slot in the joint buffers, the slots are filled in parallel.
+   * the joints go directly into the mapped shader storage buffers */
+  glm::mat4 *jointMatrices =
+    static_cast<glm::mat4*>(mGltfShaderStorageBuffer.getNextMappedRegion());
+  glm::mat2x4 *jointDualQuats =
+    static_cast<glm::mat2x4*>(mGltfDualQuatSSBuffer.getNextMappedRegion());
+  mBakedMatrixInstances.clear();
+  mBakedDualQuatInstances.clear();
 
   unsigned int matrixInstances = 0;
   unsigned int dualQuatInstances = 0;
   unsigned int numTriangles = 0;
+  size_t jointMatrixCount = 0;
+  size_t jointDualQuatCount = 0;
+  /* identical for all instances of the model */
+  int jointMatrixSize = mInstanceManager.getInstance(0)->getJointMatrixSize();
+  int jointDualQuatsSize = mInstanceManager.getInstance(0)->getJointDualQuatsSize();
+
+  const std::vector<glm::mat4> &worldMatrices = mInstanceManager.getWorldMatrices();
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    const InstanceFlags &flags = instanceFlags[handle];
+    if (!flags.ifDrawModel) {
+      continue;
+    }
+
+    numTriangles += mGltfModel->getTriangleCount();
 
-  for (const auto &instance : mGltfInstances) {
-    ModelSettings settings = instance->getInstanceSettings();
-    if (!settings.msDrawModel) {
+    GltfInstance *packInstance = mInstanceManager.getInstance(handle);
+    if (flags.ifBakedAnimation) {
+      BakedInstanceData instanceData = mBakedAnimations.getInstanceData(
+        packInstance->getInstanceSettings(), worldMatrices[handle],
+        packInstance->getAnimationTime(), mAnimationClock.getTime());
+      if (flags.ifDualQuatSkinning) {
+        mBakedDualQuatInstances.push_back(instanceData);
+      } else {
+        mBakedMatrixInstances.push_back(instanceData);
+      }
       continue;
     }
 
-    if (settings.msVertexSkinningMode == skinningMode::dualQuat) {
-      std::vector<glm::mat2x4> quats = instance->getJointDualQuats();
-      mModelJointDualQuats.insert(mModelJointDualQuats.end(),
-        quats.begin(), quats.end());
+    int packTask = 0;
+    if (flags.ifDualQuatSkinning) {
+      glm::mat2x4 *slot = jointDualQuats + jointDualQuatCount;
+      packTask = mFrameGraph.addTask([packInstance, slot]() {
+        const std::vector<glm::mat2x4> &quats = packInstance->getJointDualQuats();
+        std::copy(quats.begin(), quats.end(), slot);
+      });
+      jointDualQuatCount += jointDualQuatsSize;
       ++dualQuatInstances;
     } else {
-      std::vector<glm::mat4> mats = instance->getJointMatrices();
-      mModelJointMatrices.insert(mModelJointMatrices.end(),
-        mats.begin(), mats.end());
+      glm::mat4 *slot = jointMatrices + jointMatrixCount;
+      packTask = mFrameGraph.addTask([packInstance, slot]() {
+        const std::vector<glm::mat4> &mats = packInstance->getJointMatrices();
+        std::copy(mats.begin(), mats.end(), slot);
+      });
+      jointMatrixCount += jointMatrixSize;
       ++matrixInstances;
     }
-    numTriangles += mGltfModel->getTriangleCount();
+
+    /* instances skipped by the animation LOD keep the joints of the last update */
+    if (mInstanceTasks[handle] >= 0) {
+      mFrameGraph.addDependency(packTask, mInstanceTasks[handle]);
+    }
   }
 
+  /* save value to avoid changes during later call */
+  int selectedInstance = mRenderData.rdCurrentSelectedInstance;
+  glm::vec2 modelWorldPos = mInstanceManager.getInstance(selectedInstance)->getWorldPosition();
+  glm::quat modelWorldRot = mInstanceManager.getInstance(selectedInstance)->getWorldRotation();
+  ModelSettings ikSettings = mInstanceManager.getInstance(selectedInstance)->getInstanceSettings();
+
+  /* the line mesh waits for all instances drawing the skeleton */
+  mSkeletonInstances.clear();
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    if (instanceFlags[handle].ifDrawSkeleton && !instanceFlags[handle].ifBakedAnimation) {
+      mSkeletonInstances.push_back(mInstanceManager.getInstance(handle));
+    }
+  }
+  int lineMeshTask = mFrameGraph.addTask([this, modelWorldPos, modelWorldRot, ikSettings]() {
+    updateLineMesh(modelWorldPos, modelWorldRot, ikSettings);
+  });
+  for (const auto &instance : mSkeletonInstances) {
+    int instanceTask = mInstanceTasks[mInstanceManager.getHandle(instance)];
+    if (instanceTask >= 0) {
+      mFrameGraph.addDependency(lineMeshTask, instanceTask);
+    }
+  }
+
+  mThreadPool.run(mFrameGraph);
+  mRenderData.rdWorkerUtilization = mThreadPool.getUtilization();
+
+  /* sum of the solver times on all threads */
+  mRenderData.rdIKTime = 0.0f;
+  for (const auto ikTime : mIKTimes) {
+    mRenderData.rdIKTime += ikTime;
+  }
+
+  /* unchanged nodes and joints are skipped, also counts the changes made by the UI */
+  mRenderData.rdUpdatedNodes = 0;
+  mRenderData.rdUpdatedJoints = 0;
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    GltfInstance *instance = mInstanceManager.getInstance(handle);
+    mRenderData.rdUpdatedNodes += instance->getUpdatedNodeCount();
+    mRenderData.rdUpdatedJoints += instance->getUpdatedJointCount();
+    instance->resetUpdateCounters();
+  }
+
+  mRenderData.rdMatrixGenerateTime = mMatrixGenerateTimer.stop();
+
+  mUploadToUBOTimer.start();
+  std::vector<glm::mat4> matrixData;
+  matrixData.push_back(mViewMatrix);
+  matrixData.push_back(mProjectionMatrix);
+  mUniformBuffer.uploadUboData(matrixData, 0);
+
   mRenderData.rdTriangleCount = numTriangles;
 
-  mGltfShaderStorageBuffer.uploadSsboData(mModelJointMatrices, 1);
-  mGltfDualQuatSSBuffer.uploadSsboData(mModelJointDualQuats, 2);
+  mGltfShaderStorageBuffer.bindMappedRegion(jointMatrixCount * sizeof(glm::mat4), 1);
+  mGltfDualQuatSSBuffer.bindMappedRegion(jointDualQuatCount * sizeof(glm::mat2x4), 2);
+  mBakedMatrixInstanceSSBuffer.uploadSsboData(mBakedMatrixInstances, 5);
+  mBakedDualQuatInstanceSSBuffer.uploadSsboData(mBakedDualQuatInstances, 6);
 
   mRenderData.rdUploadToUBOTime = mUploadToUBOTimer.stop();
 
@@ -401,13 +608,26 @@ void OGLRenderer::draw() {
   /* draw the glTF models */
   mGltfGPUShader.use();
   /* set SSBO stride, identical for ALL models */
-  mGltfGPUShader.setUniformValue(mGltfInstances.at(0)->getJointMatrixSize());
+  mGltfGPUShader.setUniformValue(mInstanceManager.getInstance(0)->getJointMatrixSize());
   mGltfModel->drawInstanced(matrixInstances);
 
   mGltfGPUDualQuatShader.use();
-  mGltfGPUDualQuatShader.setUniformValue(mGltfInstances.at(0)->getJointDualQuatsSize());
+  mGltfGPUDualQuatShader.setUniformValue(mInstanceManager.getInstance(0)->getJointDualQuatsSize());
   mGltfModel->drawInstanced(dualQuatInstances);
 
+  /* the regions written in this frame are reused after these draw calls are done */
+  mGltfShaderStorageBuffer.fenceMappedRegion();
+  mGltfDualQuatSSBuffer.fenceMappedRegion();
+
+  /* baked instances, the shaders select the frame from the replay time */
+  mGltfGPUBakedShader.use();
+  mGltfGPUBakedShader.setUniformValue(static_cast<float>(mAnimationClock.getTime()));
+  mGltfModel->drawInstanced(mBakedMatrixInstances.size());
+
+  mGltfGPUBakedDualQuatShader.use();
+  mGltfGPUBakedDualQuatShader.setUniformValue(static_cast<float>(mAnimationClock.getTime()));
+  mGltfModel->drawInstanced(mBakedDualQuatInstances.size());
+
   /* draw the coordinate arrow WITH depth buffer */
   if (mCoordArrowsLineIndexCount > 0) {
     mLineShader.use();
@@ -429,10 +649,9 @@ void OGLRenderer::draw() {
 
   mUIGenerateTimer.start();
 
-  ModelSettings settings = mGltfInstances.at(selectedInstance)->getInstanceSettings();
-  mUserInterface.createFrame(mRenderData, settings);
-  mGltfInstances.at(selectedInstance)->setInstanceSettings(settings);
-  mGltfInstances.at(selectedInstance)->checkForUpdates();
+  ModelSettings settings = mInstanceManager.getInstance(selectedInstance)->getInstanceSettings();
+  mUserInterface.createFrame(mRenderData, settings, mGltfModel->getMetadata());
+  mInstanceManager.setInstanceSettings(selectedInstance, settings);
 
   mRenderData.rdUIGenerateTime = mUIGenerateTimer.stop();
 
@@ -443,10 +662,58 @@ void OGLRenderer::draw() {
   mLastTickTime = tickTime;
 }
 
+void OGLRenderer::updateLineMesh(glm::vec2 modelWorldPos, glm::quat modelWorldRot,
+    const ModelSettings &ikSettings) {
+  mLineMesh->vertices.clear();
+
+  /* get gltTF skeleton */
+  mSkeletonLineIndexCount = 0;
+  for (const auto &instance : mSkeletonInstances) {
+    std::shared_ptr<OGLMesh> mesh = instance->getSkeleton();
+    mSkeletonLineIndexCount += mesh->vertices.size();
+    mLineMesh->vertices.insert(mLineMesh->vertices.begin(),
+      mesh->vertices.begin(), mesh->vertices.end());
+  }
+
+  /* get coordinate arrows for the IK target of current instance only */
+  mCoordArrowsLineIndexCount = 0;
+  {
+    if (ikSettings.msIkMode == ikMode::ccd ||
+        ikSettings.msIkMode == ikMode::fabrik) {
+      mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
+      mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
+      std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
+        [=](auto &n){
+          n.color /= 2.0f;
+          n.position = modelWorldRot * n.position;
+          n.position += ikSettings.msIkTargetWorldPos;
+      });
+
+      mLineMesh->vertices.insert(mLineMesh->vertices.end(),
+        mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+    }
+  }
+
+  /* draw coordiante arrows*/
+  mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
+  mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
+  std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
+    [=](auto &n){
+      n.color /= 2.0f;
+      n.position = modelWorldRot * n.position;
+      n.position += glm::vec3(modelWorldPos.x, 0.0f, modelWorldPos.y);
+  });
+
+  mLineMesh->vertices.insert(mLineMesh->vertices.end(),
+    mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+}
+
 void OGLRenderer::cleanup() {
   mGltfModel->cleanup();
   mGltfModel.reset();
 
+  mGltfGPUBakedDualQuatShader.cleanup();
+  mGltfGPUBakedShader.cleanup();
   mGltfGPUDualQuatShader.cleanup();
   mGltfGPUShader.cleanup();
   mUserInterface.cleanup();
@@ -454,6 +721,10 @@ void OGLRenderer::cleanup() {
   mVertexBuffer.cleanup();
   mGltfShaderStorageBuffer.cleanup();
   mGltfDualQuatSSBuffer.cleanup();
+  mBakedJointMatrixSSBuffer.cleanup();
+  mBakedDualQuatSSBuffer.cleanup();
+  mBakedMatrixInstanceSSBuffer.cleanup();
+  mBakedDualQuatInstanceSSBuffer.cleanup();
   mUniformBuffer.cleanup();
   mFramebuffer.cleanup();
 }
@@ -8,6 +8,7 @@
 #include <GLFW/glfw3.h>
 
 #include "Timer.h"
+#include "ThreadPool.h"
 #include "Framebuffer.h"
 #include "VertexBuffer.h"
 #include "Texture.h"
@@ -19,6 +20,13 @@
 #include "CoordArrowsModel.h"
 #include "GltfModel.h"
 #include "GltfInstance.h"
+#include "InstanceManager.h"
+#include "AnimationClock.h"
+#include "AnimationBatch.h"
+#include "PoseCache.h"
+#include "BakedAnimations.h"
+#include "AnimationLod.h"
+#include "SkeletonLod.h"
 
 #include "OGLRenderData.h"
 
@@ -41,7 +49,6 @@ class OGLRenderer {
 
     Timer mFrameTimer{};
     Timer mMatrixGenerateTimer{};
-    Timer mIKTimer{};
     Timer mUploadToVBOTimer{};
     Timer mUploadToUBOTimer{};
     Timer mUIGenerateTimer{};
@@ -50,25 +57,48 @@ class OGLRenderer {
     Shader mLineShader{};
     Shader mGltfGPUShader{};
     Shader mGltfGPUDualQuatShader{};
+    Shader mGltfGPUBakedShader{};
+    Shader mGltfGPUBakedDualQuatShader{};
 
     Framebuffer mFramebuffer{};
     VertexBuffer mVertexBuffer{};
     UniformBuffer mUniformBuffer{};
     ShaderStorageBuffer mGltfShaderStorageBuffer{};
     ShaderStorageBuffer mGltfDualQuatSSBuffer{};
+    ShaderStorageBuffer mBakedJointMatrixSSBuffer{};
+    ShaderStorageBuffer mBakedDualQuatSSBuffer{};
+    ShaderStorageBuffer mBakedMatrixInstanceSSBuffer{};
+    ShaderStorageBuffer mBakedDualQuatInstanceSSBuffer{};
     UserInterface mUserInterface{};
     Camera mCamera{};
 
     std::shared_ptr<GltfModel> mGltfModel = nullptr;
 
-    std::vector<std::shared_ptr<GltfInstance>> mGltfInstances{};
-
-    std::vector<glm::mat4> mModelJointMatrices{};
-    std::vector<glm::mat2x4> mModelJointDualQuats{};
+    InstanceManager mInstanceManager{};
+    AnimationClock mAnimationClock{};
+    ThreadPool mThreadPool{};
+    /* all per-frame work on the instances before the upload */
+    TaskGraph mFrameGraph{};
+    std::vector<int> mPoseTasks{};
+    /* by instance handle, -1 for instances without a task */
+    std::vector<int> mInstanceTasks{};
+    std::vector<float> mIKTimes{};
+    AnimationBatch mAnimationBatch{};
+    PoseCache mPoseCache{};
+    BakedAnimations mBakedAnimations{};
+    /* instances without a baked animation */
+    std::vector<GltfInstance*> mAnimatedInstances{};
+    AnimationLod mAnimationLod{};
+    std::vector<GltfInstance*> mLodInstances{};
+    SkeletonLod mSkeletonLod{};
+
+    std::vector<BakedInstanceData> mBakedMatrixInstances{};
+    std::vector<BakedInstanceData> mBakedDualQuatInstances{};
 
     CoordArrowsModel mCoordArrowsModel{};
     OGLMesh mCoordArrowsMesh{};
     std::shared_ptr<OGLMesh> mLineMesh = nullptr;
+    std::vector<GltfInstance*> mSkeletonInstances{};
     unsigned int mSkeletonLineIndexCount = 0;
     unsigned int mCoordArrowsLineIndexCount = 0;
 
@@ -79,6 +109,9 @@ class OGLRenderer {
     double mLastTickTime = 0.0;
 
     void handleMovementKeys();
+    /* skeletons of mSkeletonInstances and the coordinate arrows of the selected instance */
+    void updateLineMesh(glm::vec2 modelWorldPos, glm::quat modelWorldRot,
+      const ModelSettings &ikSettings);
 
     /* create identity matrix by default */
     glm::mat4 mViewMatrix = glm::mat4(1.0f);
@@ -41,6 +41,15 @@ void Shader::setUniformValue(int value) {
   }
 }
 
+void Shader::setUniformValue(float value) {
+  if (mShaderProgram > 0) {
+    /* 0 is a valid location */
+    if (mUniformLocation > -1) {
+      glUniform1f(mUniformLocation, value);
+    }
+  }
+}
+
 void Shader::cleanup() {
   glDeleteProgram(mShaderProgram);
 }
@@ -9,6 +9,7 @@ class Shader {
     void use();
     bool getUniformLocation(std::string uniformName);
     void setUniformValue(int value);
+    void setUniformValue(float value);
     void cleanup();
 
   private:
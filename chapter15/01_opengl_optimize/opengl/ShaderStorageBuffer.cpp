@@ -11,7 +11,8 @@ void ShaderStorageBuffer::init(size_t bufferSize) {
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void ShaderStorageBuffer::uploadSsboData(std::vector<glm::mat4> bufferData, int bindingPoint) {
+void ShaderStorageBuffer::uploadSsboData(const std::vector<glm::mat4> &bufferData,
+    int bindingPoint) {
   if (bufferData.size() == 0) {
     return;
   }
@@ -23,7 +24,8 @@ void ShaderStorageBuffer::uploadSsboData(std::vector<glm::mat4> bufferData, int
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void ShaderStorageBuffer::uploadSsboData(std::vector<glm::mat2x4> bufferData, int bindingPoint) {
+void ShaderStorageBuffer::uploadSsboData(const std::vector<glm::mat2x4> &bufferData,
+    int bindingPoint) {
   if (bufferData.size() == 0) {
     return;
   }
@@ -35,6 +37,83 @@ void ShaderStorageBuffer::uploadSsboData(std::vector<glm::mat2x4> bufferData, in
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
+void ShaderStorageBuffer::uploadSsboData(const std::vector<BakedInstanceData> &bufferData,
+    int bindingPoint) {
+  if (bufferData.size() == 0) {
+    return;
+  }
+  size_t bufferSize = bufferData.size() * sizeof(BakedInstanceData);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mShaderStorageBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bufferSize, bufferData.data());
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingPoint, mShaderStorageBuffer, 0,
+    bufferSize);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool ShaderStorageBuffer::initMapped(size_t regionSize) {
+  /* the regions are bound with an offset, which must be aligned */
+  GLint offsetAlignment = 1;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+  mRegionSize = (regionSize + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+  mBufferSize = mRegionSize * mMappedRegionCount;
+
+  glGenBuffers(1, &mShaderStorageBuffer);
+
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mShaderStorageBuffer);
+  glBufferStorage(GL_SHADER_STORAGE_BUFFER, mBufferSize, NULL, flags);
+  mMappedData = static_cast<char*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+    mBufferSize, flags));
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  if (!mMappedData) {
+    Logger::log(1, "%s error: could not map shader storage buffer\n", __FUNCTION__);
+    return false;
+  }
+
+  /* the first call starts with region 0 */
+  mCurrentRegion = mMappedRegionCount - 1;
+  return true;
+}
+
+void *ShaderStorageBuffer::getNextMappedRegion() {
+  mCurrentRegion = (mCurrentRegion + 1) % mMappedRegionCount;
+
+  GLsync &fence = mRegionFences[mCurrentRegion];
+  if (fence) {
+    /* only blocks if the CPU is more than two frames ahead */
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  return mMappedData + mCurrentRegion * mRegionSize;
+}
+
+void ShaderStorageBuffer::bindMappedRegion(size_t dataSize, int bindingPoint) {
+  if (dataSize == 0) {
+    return;
+  }
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingPoint, mShaderStorageBuffer,
+    mCurrentRegion * mRegionSize, dataSize);
+}
+
+void ShaderStorageBuffer::fenceMappedRegion() {
+  mRegionFences[mCurrentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
 void ShaderStorageBuffer::cleanup() {
+  for (auto &fence : mRegionFences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (mMappedData) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mShaderStorageBuffer);
+    glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    mMappedData = nullptr;
+  }
   glDeleteBuffers(1, &mShaderStorageBuffer);
 }
@@ -4,14 +4,33 @@
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
+#include "OGLRenderData.h"
+
 class ShaderStorageBuffer {
   public:
     void init(size_t bufferSize);
-    void uploadSsboData(std::vector<glm::mat4> bufferData, int bindingPoint);
-    void uploadSsboData(std::vector<glm::mat2x4> bufferData, int bindingPoint);
+    void uploadSsboData(const std::vector<glm::mat4> &bufferData, int bindingPoint);
+    void uploadSsboData(const std::vector<glm::mat2x4> &bufferData, int bindingPoint);
+    void uploadSsboData(const std::vector<BakedInstanceData> &bufferData, int bindingPoint);
+
+    /* persistently mapped buffer, the CPU writes one region while the GPU reads the others */
+    bool initMapped(size_t regionSize);
+    /* waits until the GPU is done with the next region and returns its start */
+    void *getNextMappedRegion();
+    /* binds the first dataSize bytes of the current region */
+    void bindMappedRegion(size_t dataSize, int bindingPoint);
+    /* call after the last draw call reading the current region */
+    void fenceMappedRegion();
+
     void cleanup();
 
   private:
     size_t mBufferSize;
     GLuint mShaderStorageBuffer = 0;
+
+    static const int mMappedRegionCount = 3;
+    size_t mRegionSize = 0;
+    int mCurrentRegion = 0;
+    char *mMappedData = nullptr;
+    GLsync mRegionFences[mMappedRegionCount] = {};
 };
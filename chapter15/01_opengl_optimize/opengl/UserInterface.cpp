@@ -8,6 +8,8 @@
 #include <imgui_impl_opengl3.h>
 
 #include "UserInterface.h"
+#include "PoseKernels.h"
+#include "ThreadPool.h"
 
 void UserInterface::init(OGLRenderData &renderData) {
   IMGUI_CHECKVERSION();
@@ -32,7 +34,8 @@ void UserInterface::init(OGLRenderData &renderData) {
   mUiDrawValues.resize(mNumUiDrawValues);
 }
 
-void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settings) {
+void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settings,
+    const ModelMetadata &metadata) {
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -236,6 +239,20 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::EndTooltip();
     }
 
+    ImGui::Text("Pose Cache Hit Rate:");
+    ImGui::SameLine();
+    ImGui::Text("%s", std::to_string(renderData.rdPoseCacheHitRate).c_str());
+    ImGui::SameLine();
+    ImGui::Text("%%");
+
+    ImGui::Text("Updated Nodes:");
+    ImGui::SameLine();
+    ImGui::Text("%s", std::to_string(renderData.rdUpdatedNodes).c_str());
+
+    ImGui::Text("Updated Joints:");
+    ImGui::SameLine();
+    ImGui::Text("%s", std::to_string(renderData.rdUpdatedJoints).c_str());
+
     ImGui::BeginGroup();
     ImGui::Text("Matrix Upload Time:");
     ImGui::SameLine();
@@ -358,11 +375,79 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
     ImGui::SameLine();
     ImGui::SliderFloat("##WORLDROT", &settings.msWorldRotation.y,
       -180.0f, 180.0f, "%.0f", flags);
+
+    ImGui::Text("Animation Threads:");
+    ImGui::SameLine();
+    ImGui::SliderInt("##ANIMTHREADS", &renderData.rdAnimationThreads, 1,
+      ThreadPool::getMaxThreadCount(), "%d", flags);
+    for (int i = 0; i < renderData.rdWorkerUtilization.size(); ++i) {
+      float utilization = renderData.rdWorkerUtilization.at(i);
+      ImGui::Text("Thread %2d        :", i);
+      ImGui::SameLine();
+      ImGui::ProgressBar(utilization / 100.0f, ImVec2(0.0f, 0.0f),
+        (std::to_string(static_cast<int>(utilization)) + " %").c_str());
+    }
+
+    ImGui::Checkbox("Pause Animations", &renderData.rdAnimationPaused);
+    ImGui::SameLine();
+    if (ImGui::Button("Restart")) {
+      renderData.rdResetAnimationClock = true;
+    }
+    ImGui::Text("Time Scale       :");
+    ImGui::SameLine();
+    ImGui::SliderFloat("##TIMESCALE", &renderData.rdAnimationTimeScale,
+      0.0f, 4.0f, "%.2fx", flags);
+    ImGui::Checkbox("Fixed Time Step", &renderData.rdAnimationFixedStep);
+    ImGui::Text("Fixed Step       :");
+    ImGui::SameLine();
+    ImGui::SliderFloat("##FIXEDSTEP", &renderData.rdAnimationFixedStepSize,
+      0.001f, 0.1f, "%.3f s", flags);
+    ImGui::Text("Animation Time   : %.3f s", renderData.rdAnimationClockTime);
+
+    ImGui::Checkbox("Batch Pose Evaluation", &renderData.rdBatchAnimations);
+    ImGui::SameLine();
+    ImGui::Text("(%s)", PoseKernels::getSimdLevelName(PoseKernels::getSimdLevel()).c_str());
+    ImGui::Text("Batched Instances: %d", renderData.rdBatchedInstances);
+
+    ImGui::Checkbox("Pose Cache", &renderData.rdPoseCache);
+    ImGui::Text("Time Step        :");
+    ImGui::SameLine();
+    ImGui::SliderFloat("##POSETIMESTEP", &renderData.rdPoseCacheTimeStep,
+      0.001f, 0.1f, "%.3f s", flags);
+
+    if (ImGui::Button("Bake All")) {
+      renderData.rdBakeAllInstances = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Unbake All")) {
+      renderData.rdUnbakeAllInstances = true;
+    }
+    ImGui::Text("Baked Instances  : %d", renderData.rdBakedInstances);
+
+    ImGui::Checkbox("Animation LOD", &renderData.rdAnimationLod);
+    ImGui::Text("LOD Distances    :");
+    ImGui::SameLine();
+    ImGui::SliderFloat3("##LODDIST", glm::value_ptr(renderData.rdAnimationLodDistances),
+      0.0f, 200.0f, "%.0f", flags);
+    ImGui::Text("LOD Instances    : %d / %d / %d / %d",
+      renderData.rdAnimationLodInstances[0], renderData.rdAnimationLodInstances[1],
+      renderData.rdAnimationLodInstances[2], renderData.rdAnimationLodInstances[3]);
+
+    ImGui::Checkbox("Skeleton LOD", &renderData.rdSkeletonLod);
+    ImGui::Text("Screen Sizes     :");
+    ImGui::SameLine();
+    ImGui::SliderFloat3("##SKELLODSIZE", glm::value_ptr(renderData.rdSkeletonLodScreenSizes),
+      0.0f, 1000.0f, "%.0f px", flags);
+    ImGui::Text("Skeleton Levels  : %d / %d / %d / %d",
+      renderData.rdSkeletonLodInstances[0], renderData.rdSkeletonLodInstances[1],
+      renderData.rdSkeletonLodInstances[2], renderData.rdSkeletonLodInstances[3]);
+    ImGui::Text("Skipped Channels : %d", renderData.rdSkeletonLodSkippedChannels);
   }
 
   if (ImGui::CollapsingHeader("glTF Model")) {
     ImGui::Checkbox("Draw Model", &settings.msDrawModel);
     ImGui::Checkbox("Draw Skeleton", &settings.msDrawSkeleton);
+    ImGui::Checkbox("Baked Animation", &settings.msBakedAnimation);
 
     ImGui::Text("Vertex Skinning:");
     ImGui::SameLine();
@@ -403,10 +488,10 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
     ImGui::Text("Clip   ");
     ImGui::SameLine();
     if (ImGui::BeginCombo("##ClipCombo",
-      settings.msClipNames.at(settings.msAnimClip).c_str())) {
-      for (int i = 0; i < settings.msClipNames.size(); ++i) {
+      metadata.mdClipNames.at(settings.msAnimClip).c_str())) {
+      for (int i = 0; i < metadata.mdClipNames.size(); ++i) {
         const bool isSelected = (settings.msAnimClip == i);
-        if (ImGui::Selectable(settings.msClipNames.at(i).c_str(), isSelected)) {
+        if (ImGui::Selectable(metadata.mdClipNames.at(i).c_str(), isSelected)) {
           settings.msAnimClip = i;
         }
 
@@ -459,10 +544,10 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::Text("Dest Clip   ");
       ImGui::SameLine();
       if (ImGui::BeginCombo("##DestClipCombo",
-        settings.msClipNames.at(settings.msCrossBlendDestAnimClip).c_str())) {
-        for (int i = 0; i < settings.msClipNames.size(); ++i) {
+        metadata.mdClipNames.at(settings.msCrossBlendDestAnimClip).c_str())) {
+        for (int i = 0; i < metadata.mdClipNames.size(); ++i) {
           const bool isSelected = (settings.msCrossBlendDestAnimClip == i);
-          if (ImGui::Selectable(settings.msClipNames.at(i).c_str(), isSelected)) {
+          if (ImGui::Selectable(metadata.mdClipNames.at(i).c_str(), isSelected)) {
             settings.msCrossBlendDestAnimClip = i;
           }
 
@@ -483,11 +568,11 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::Text("Split Node  ");
       ImGui::SameLine();
       if (ImGui::BeginCombo("##SplitNodeCombo",
-        settings.msSkelNodeNames.at(settings.msSkelSplitNode).c_str())) {
-        for (int i = 0; i < settings.msSkelNodeNames.size(); ++i) {
-          if (settings.msSkelNodeNames.at(i).compare("(invalid)") != 0) {
+        metadata.mdSkelNodeNames.at(settings.msSkelSplitNode).c_str())) {
+        for (int i = 0; i < metadata.mdSkelNodeNames.size(); ++i) {
+          if (metadata.mdSkelNodeNames.at(i).compare("(invalid)") != 0) {
             const bool isSelected = (settings.msSkelSplitNode == i);
-            if (ImGui::Selectable(settings.msSkelNodeNames.at(i).c_str(), isSelected)) {
+            if (ImGui::Selectable(metadata.mdSkelNodeNames.at(i).c_str(), isSelected)) {
               settings.msSkelSplitNode = i;
             }
 
@@ -524,6 +609,7 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::Text("IK Iterations  :");
       ImGui::SameLine();
       ImGui::SliderInt("##IKITER", &settings.msIkIterations, 0, 15, "%d", flags);
+      ImGui::Checkbox("Validate with glm::decompose()", &renderData.rdIkDecomposeValidation);
 
       ImGui::Text("Target Position:");
       ImGui::SameLine();
@@ -532,11 +618,11 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::Text("Effector Node  :");
       ImGui::SameLine();
       if (ImGui::BeginCombo("##EffectorNodeCombo",
-        settings.msSkelNodeNames.at(settings.msIkEffectorNode).c_str())) {
-        for (int i = 0; i < settings.msSkelNodeNames.size(); ++i) {
-          if (settings.msSkelNodeNames.at(i).compare("(invalid)") != 0) {
+        metadata.mdSkelNodeNames.at(settings.msIkEffectorNode).c_str())) {
+        for (int i = 0; i < metadata.mdSkelNodeNames.size(); ++i) {
+          if (metadata.mdSkelNodeNames.at(i).compare("(invalid)") != 0) {
             const bool isSelected = (settings.msIkEffectorNode == i);
-            if (ImGui::Selectable(settings.msSkelNodeNames.at(i).c_str(), isSelected)) {
+            if (ImGui::Selectable(metadata.mdSkelNodeNames.at(i).c_str(), isSelected)) {
               settings.msIkEffectorNode = i;
             }
 
@@ -551,11 +637,11 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
       ImGui::Text("IK Root Node   :");
       ImGui::SameLine();
       if (ImGui::BeginCombo("##RootNodeCombo",
-        settings.msSkelNodeNames.at(settings.msIkRootNode).c_str())) {
-        for (int i = 0; i < settings.msSkelNodeNames.size(); ++i) {
-          if (settings.msSkelNodeNames.at(i).compare("(invalid)") != 0) {
+        metadata.mdSkelNodeNames.at(settings.msIkRootNode).c_str())) {
+        for (int i = 0; i < metadata.mdSkelNodeNames.size(); ++i) {
+          if (metadata.mdSkelNodeNames.at(i).compare("(invalid)") != 0) {
             const bool isSelected = (settings.msIkRootNode == i);
-            if (ImGui::Selectable(settings.msSkelNodeNames.at(i).c_str(), isSelected)) {
+            if (ImGui::Selectable(metadata.mdSkelNodeNames.at(i).c_str(), isSelected)) {
               settings.msIkRootNode = i;
             }
 
@@ -569,6 +655,14 @@ void UserInterface::createFrame(OGLRenderData &renderData, ModelSettings &settin
     }
   }
 
+  if (ImGui::CollapsingHeader("Benchmarks")) {
+    if (ImGui::Button("Run Animation Benchmarks")) {
+      renderData.rdRunAnimationBenchmarks = true;
+    }
+    ImGui::SameLine();
+    ImGui::Text("(results in log)");
+  }
+
   ImGui::End();
 }
 
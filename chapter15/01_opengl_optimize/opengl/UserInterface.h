@@ -4,11 +4,13 @@
 
 #include "OGLRenderData.h"
 #include "ModelSettings.h"
+#include "ModelMetadata.h"
 
 class UserInterface {
   public:
     void init(OGLRenderData &renderData);
-    void createFrame(OGLRenderData &renderData, ModelSettings &settings);
+    void createFrame(OGLRenderData &renderData, ModelSettings &settings,
+      const ModelMetadata &metadata);
     void render();
     void cleanup();
 
@@ -0,0 +1,52 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aJointNum;
+layout (location = 4) in vec4 aJointWeight;
+
+layout (location = 0) out vec3 normal;
+layout (location = 1) out vec2 texCoord;
+
+layout (std140, binding = 0) uniform Matrices {
+  mat4 view;
+  mat4 projection;
+};
+
+layout (std430, binding = 3) readonly buffer BakedJointMatrices {
+  mat4 bakedJointMat[];
+};
+
+struct BakedInstance {
+  mat4 worldMatrix;
+  vec4 clipData;   // first frame, frame count, joint count, frame rate
+  vec4 replayData; // speed, time offset, clip length
+};
+
+layout (std430, binding = 5) readonly buffer BakedInstances {
+  BakedInstance bakedInstances[];
+};
+
+uniform float aReplayTime;
+
+int getPaletteOffset(BakedInstance instance) {
+  float clipTime = mod(aReplayTime * instance.replayData.x + instance.replayData.y,
+    max(instance.replayData.z, 1e-6));
+  float clipFrame = clamp(floor(clipTime * instance.clipData.w), 0.0, instance.clipData.y - 1.0);
+  return int(instance.clipData.x + clipFrame) * int(instance.clipData.z);
+}
+
+void main() {
+  BakedInstance instance = bakedInstances[gl_InstanceID];
+  int offset = getPaletteOffset(instance);
+
+  mat4 skinMat = instance.worldMatrix * (
+    aJointWeight.x * bakedJointMat[int(aJointNum.x) + offset] +
+    aJointWeight.y * bakedJointMat[int(aJointNum.y) + offset] +
+    aJointWeight.z * bakedJointMat[int(aJointNum.z) + offset] +
+    aJointWeight.w * bakedJointMat[int(aJointNum.w) + offset]);
+
+  gl_Position = projection * view * skinMat * vec4(aPos, 1.0);
+  normal = vec3(transpose(inverse(skinMat)) * vec4(aNormal, 1.0));
+  texCoord = aTexCoord;
+}
@@ -0,0 +1,100 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aJointNum;
+layout (location = 4) in vec4 aJointWeight;
+
+layout (location = 0) out vec3 normal;
+layout (location = 1) out vec2 texCoord;
+
+layout (std140, binding = 0) uniform Matrices {
+  mat4 view;
+  mat4 projection;
+};
+
+layout (std430, binding = 4) readonly buffer BakedJointDualQuats {
+  mat2x4 bakedJointDQs[];
+};
+
+struct BakedInstance {
+  mat4 worldMatrix;
+  vec4 clipData;   // first frame, frame count, joint count, frame rate
+  vec4 replayData; // speed, time offset, clip length
+};
+
+layout (std430, binding = 6) readonly buffer BakedInstances {
+  BakedInstance bakedInstances[];
+};
+
+uniform float aReplayTime;
+
+int getPaletteOffset(BakedInstance instance) {
+  float clipTime = mod(aReplayTime * instance.replayData.x + instance.replayData.y,
+    max(instance.replayData.z, 1e-6));
+  float clipFrame = clamp(floor(clipTime * instance.clipData.w), 0.0, instance.clipData.y - 1.0);
+  return int(instance.clipData.x + clipFrame) * int(instance.clipData.z);
+}
+
+mat2x4 getJointTransform(ivec4 joints, vec4 weights, int offset) {
+  // read dual quaterions from buffer
+  mat2x4 dq0 = bakedJointDQs[joints.x + offset];
+  mat2x4 dq1 = bakedJointDQs[joints.y + offset];
+  mat2x4 dq2 = bakedJointDQs[joints.z + offset];
+  mat2x4 dq3 = bakedJointDQs[joints.w + offset];
+
+  // shortest rotation
+  weights.y *= sign(dot(dq0[0], dq1[0]));
+  weights.z *= sign(dot(dq0[0], dq2[0]));
+  weights.w *= sign(dot(dq0[0], dq3[0]));
+
+  // blend
+  mat2x4 result =
+      weights.x * dq0 +
+      weights.y * dq1 +
+      weights.z * dq2 +
+      weights.w * dq3;
+
+  // normalize the dual quaternion
+  float norm = length(result[0]);
+  return result / norm;
+}
+
+mat4 getSkinMat(int offset) {
+  mat2x4 bone = getJointTransform(ivec4(aJointNum), aJointWeight, offset);
+
+  vec4 r = bone[0]; // rotation
+  vec4 t = bone[1]; // translation
+
+  return mat4(
+      1.0 - (2.0 * r.y * r.y) - (2.0 * r.z * r.z),
+            (2.0 * r.x * r.y) + (2.0 * r.w * r.z),
+            (2.0 * r.x * r.z) - (2.0 * r.w * r.y),
+      0.0,
+
+            (2.0 * r.x * r.y) - (2.0 * r.w * r.z),
+      1.0 - (2.0 * r.x * r.x) - (2.0 * r.z * r.z),
+            (2.0 * r.y * r.z) + (2.0 * r.w * r.x),
+      0.0,
+
+            (2.0 * r.x * r.z) + (2.0 * r.w * r.y),
+            (2.0 * r.y * r.z) - (2.0 * r.w * r.x),
+      1.0 - (2.0 * r.x * r.x) - (2.0 * r.y * r.y),
+      0.0,
+
+      2.0 * (-t.w * r.x + t.x * r.w - t.y * r.z + t.z * r.y),
+      2.0 * (-t.w * r.y + t.x * r.z + t.y * r.w - t.z * r.x),
+      2.0 * (-t.w * r.z - t.x * r.y + t.y * r.x + t.z * r.w),
+      1);
+}
+
+void main() {
+  BakedInstance instance = bakedInstances[gl_InstanceID];
+  // dual quaternions are baked without the world transform
+  mat4 skinMat = instance.worldMatrix * getSkinMat(getPaletteOffset(instance));
+
+  gl_Position = projection * view * skinMat * vec4(aPos, 1.0);
+  normal = vec3(transpose(inverse(skinMat)) * vec4(aNormal, 1.0));
+  texCoord = aTexCoord;
+}
+
@@ -0,0 +1,73 @@
+#include "TaskGraph.h"
+#include "Logger.h"
+
+void TaskGraph::clear() {
+  mTasks.clear();
+  mDependencies.clear();
+}
+
+int TaskGraph::addTask(std::function<void()> func) {
+  mTasks.emplace_back(std::move(func));
+  return mTasks.size() - 1;
+}
+
+void TaskGraph::addDependency(int taskNum, int dependencyTaskNum) {
+  /* also keeps the graph free of cycles */
+  if (dependencyTaskNum < 0 || dependencyTaskNum >= taskNum || taskNum >= mTasks.size()) {
+    Logger::log(1, "%s error: task %i cannot depend on task %i\n", __FUNCTION__, taskNum,
+      dependencyTaskNum);
+    return;
+  }
+  mDependencies.emplace_back(taskNum, dependencyTaskNum);
+}
+
+int TaskGraph::getTaskCount() {
+  return mTasks.size();
+}
+
+void TaskGraph::runSerial() {
+  for (auto &task : mTasks) {
+    task();
+  }
+}
+
+void TaskGraph::prepare(std::vector<int> &readyTasks) {
+  int taskCount = mTasks.size();
+  if (mOpenDependencySize < taskCount) {
+    mOpenDependencies = std::make_unique<std::atomic<int>[]>(taskCount);
+    mOpenDependencySize = taskCount;
+  }
+  for (int i = 0; i < taskCount; ++i) {
+    mOpenDependencies[i] = 0;
+  }
+
+  /* counting sort of the dependencies by the task they depend on */
+  mDependentOffsets.assign(taskCount + 1, 0);
+  for (const auto &dependency : mDependencies) {
+    ++mDependentOffsets[dependency.second + 1];
+    ++mOpenDependencies[dependency.first];
+  }
+  for (int i = 0; i < taskCount; ++i) {
+    mDependentOffsets[i + 1] += mDependentOffsets[i];
+  }
+  mDependents.resize(mDependencies.size());
+  for (const auto &dependency : mDependencies) {
+    /* offsets are moved up while filling and restored below */
+    mDependents[mDependentOffsets[dependency.second]++] = dependency.first;
+  }
+  for (int i = taskCount; i > 0; --i) {
+    mDependentOffsets[i] = mDependentOffsets[i - 1];
+  }
+  mDependentOffsets[0] = 0;
+
+  readyTasks.clear();
+  for (int i = 0; i < taskCount; ++i) {
+    if (mOpenDependencies[i] == 0) {
+      readyTasks.push_back(i);
+    }
+  }
+}
+
+void TaskGraph::runTask(int taskNum) {
+  mTasks[taskNum]();
+}
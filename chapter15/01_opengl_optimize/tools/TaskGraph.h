@@ -0,0 +1,46 @@
+/* tasks and their dependencies, executed by ThreadPool::run() or runSerial() */
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+class TaskGraph {
+  public:
+    /* removes all tasks, the memory is kept for the next graph */
+    void clear();
+
+    /* returns the number of the new task */
+    int addTask(std::function<void()> func);
+    /* the task runs after dependencyTaskNum, which must be an earlier task */
+    void addDependency(int taskNum, int dependencyTaskNum);
+
+    int getTaskCount();
+    /* runs the tasks in the order they were added */
+    void runSerial();
+
+    /* used by ThreadPool::run(), tasks without dependencies go to readyTasks */
+    void prepare(std::vector<int> &readyTasks);
+    void runTask(int taskNum);
+    /* calls ready(dependentTaskNum) for every dependent task without open dependencies */
+    template <typename Func>
+    void releaseDependents(int taskNum, Func ready) {
+      for (int i = mDependentOffsets[taskNum]; i < mDependentOffsets[taskNum + 1]; ++i) {
+        int dependentTaskNum = mDependents[i];
+        if (mOpenDependencies[dependentTaskNum].fetch_sub(1) == 1) {
+          ready(dependentTaskNum);
+        }
+      }
+    }
+
+  private:
+    std::vector<std::function<void()>> mTasks{};
+    /* pairs of task and dependency */
+    std::vector<std::pair<int, int>> mDependencies{};
+
+    /* dependent tasks of task n are in mDependents[mDependentOffsets[n]] and up */
+    std::vector<int> mDependentOffsets{};
+    std::vector<int> mDependents{};
+    std::unique_ptr<std::atomic<int>[]> mOpenDependencies = nullptr;
+    int mOpenDependencySize = 0;
+};
@@ -0,0 +1,259 @@
+#include <algorithm>
+
+#include "AnimationBatch.h"
+#include "PoseKernels.h"
+
+void AnimationBatch::updateAnimations(std::vector<GltfInstance*> &instances) {
+  mTimes.resize(instances.size());
+  for (int i = 0; i < instances.size(); ++i) {
+    mTimes.at(i) = instances.at(i)->getAnimationTime();
+  }
+  updateAnimations(instances, mTimes);
+}
+
+void AnimationBatch::addTasks(TaskGraph &graph,
+    std::vector<GltfInstance*> &instances, std::vector<int> &poseTasks) {
+  mTimes.resize(instances.size());
+  for (int i = 0; i < instances.size(); ++i) {
+    mTimes.at(i) = instances.at(i)->getAnimationTime();
+  }
+  addTasks(graph, instances, mTimes, poseTasks);
+}
+
+void AnimationBatch::updateAnimations(std::vector<GltfInstance*> &instances,
+    const std::vector<float> &times) {
+  mTaskGraph.clear();
+  addTasks(mTaskGraph, instances, times, mPoseTasks);
+  if (mThreadPool) {
+    mThreadPool->run(mTaskGraph);
+  } else {
+    mTaskGraph.runSerial();
+  }
+}
+
+void AnimationBatch::addTasks(TaskGraph &graph,
+    std::vector<GltfInstance*> &instances, const std::vector<float> &times,
+    std::vector<int> &poseTasks) {
+  for (auto &group : mGroups) {
+    group.instances.clear();
+    group.times.clear();
+    group.keyCursors.clear();
+  }
+  mBatchedInstanceCount = 0;
+  poseTasks.resize(instances.size());
+  mInstanceLanes.resize(instances.size());
+
+  for (int i = 0; i < instances.size(); ++i) {
+    GltfInstance *instance = instances.at(i);
+    int animNum = 0;
+    /* a paused instance is not sampled again */
+    if (instance->isPoseValid(times.at(i)) || !instance->getBatchAnimationClip(animNum)) {
+      mInstanceLanes.at(i) = std::make_pair(-1, -1);
+      continue;
+    }
+
+    std::shared_ptr<GltfAnimationClip> clip = instance->getAnimClip(animNum);
+    int skeletonLod = instance->getSkeletonLod();
+    auto groupIter = std::find_if(mGroups.begin(), mGroups.end(),
+      [&](const BatchGroup &group) {
+        return group.clip == clip && group.skeletonLod == skeletonLod;
+      });
+    if (groupIter == mGroups.end()) {
+      BatchGroup newGroup{};
+      initGroup(newGroup, clip, instance);
+      mGroups.push_back(newGroup);
+      groupIter = mGroups.end() - 1;
+    }
+
+    mInstanceLanes.at(i) = std::make_pair(groupIter - mGroups.begin(),
+      groupIter->instances.size());
+    groupIter->instances.push_back(instance);
+    groupIter->times.push_back(times.at(i));
+    groupIter->keyCursors.push_back(&instance->getAnimKeyCursors(animNum));
+    ++mBatchedInstanceCount;
+  }
+
+  /* the clip of a group is sampled for all instances at once */
+  mGroupTasks.resize(mGroups.size());
+  for (int groupNum = 0; groupNum < mGroups.size(); ++groupNum) {
+    mGroupTasks.at(groupNum) = -1;
+    if (!mGroups.at(groupNum).instances.empty()) {
+      mGroupTasks.at(groupNum) = graph.addTask([this, groupNum]() {
+        evaluateGroup(mGroups[groupNum]);
+      });
+    }
+  }
+
+  /* node and joint matrices of every instance, in a task of its own */
+  for (int i = 0; i < instances.size(); ++i) {
+    int groupNum = mInstanceLanes.at(i).first;
+    if (groupNum < 0) {
+      GltfInstance *instance = instances.at(i);
+      float time = times.at(i);
+      if (instance->isPoseValid(time)) {
+        poseTasks.at(i) = graph.addTask([instance]() {
+          instance->keepPose();
+        });
+      } else {
+        poseTasks.at(i) = graph.addTask([instance, time]() {
+          instance->updateAnimation(time);
+        });
+      }
+      continue;
+    }
+
+    int lane = mInstanceLanes.at(i).second;
+    poseTasks.at(i) = graph.addTask([this, groupNum, lane]() {
+      setInstancePose(mGroups[groupNum], lane);
+    });
+    graph.addDependency(poseTasks.at(i), mGroupTasks.at(groupNum));
+  }
+}
+
+void AnimationBatch::setInstancePose(BatchGroup &group, int lane) {
+  GltfInstance *instance = group.instances.at(lane);
+  for (int i = 0; i < group.nodes.size(); ++i) {
+    instance->setNodeTRS(group.nodes.at(i).nodeNum, getTranslation(group, i, lane),
+      getRotation(group, i, lane), getScale(group, i, lane), getLocalMatrix(group, i, lane));
+  }
+  instance->updatePose(group.times.at(lane));
+}
+
+void AnimationBatch::setThreadPool(ThreadPool *threadPool) {
+  mThreadPool = threadPool;
+}
+
+int AnimationBatch::getBatchedInstanceCount() {
+  return mBatchedInstanceCount;
+}
+
+void AnimationBatch::initGroup(BatchGroup &group, std::shared_ptr<GltfAnimationClip> clip,
+    GltfInstance *restInstance) {
+  group.clip = clip;
+  group.nodes.clear();
+
+  std::vector<PackedTrack> tracks = clip->getTracks();
+  if (restInstance) {
+    group.skeletonLod = restInstance->getSkeletonLod();
+    group.nodeMask = restInstance->getSkeletonLodMask();
+    group.trackMask = restInstance->getSkeletonLodTrackMask();
+  } else {
+    int nodeCount = 0;
+    for (const auto &track : tracks) {
+      nodeCount = std::max(nodeCount, track.targetNode + 1);
+    }
+    group.skeletonLod = 0;
+    group.nodeMask.assign(nodeCount, true);
+    group.trackMask = GltfAnimationClip::mAllTracks;
+  }
+
+  /* tracks are sorted by node */
+  for (int i = 0; i < tracks.size(); ++i) {
+    const PackedTrack &track = tracks.at(i);
+    if (!group.nodeMask.at(track.targetNode)) {
+      continue;
+    }
+    if (group.nodes.empty() || group.nodes.back().nodeNum != track.targetNode) {
+      BatchNode node{};
+      node.nodeNum = track.targetNode;
+      if (restInstance) {
+        restInstance->getNodeTRS(node.nodeNum, node.restTranslation, node.restRotation,
+          node.restScale);
+      }
+      group.nodes.push_back(node);
+    }
+
+    switch (track.targetPath) {
+      case ETargetPath::TRANSLATION:
+        group.nodes.back().translationTrack = i;
+        break;
+      case ETargetPath::ROTATION:
+        group.nodes.back().rotationTrack = i;
+        break;
+      case ETargetPath::SCALE:
+        group.nodes.back().scaleTrack = i;
+        break;
+    }
+  }
+}
+
+void AnimationBatch::evaluateGroup(BatchGroup &group) {
+  group.laneStride = PoseKernels::getPaddedLaneCount(group.times.size());
+  int stride = group.laneStride;
+
+  group.clip->sampleBatch(group.times, group.keyCursors, stride, group.trackMask,
+    group.trackValues);
+
+  group.restValues.resize(group.nodes.size() * 10 * stride);
+  group.localMatrices.resize(group.nodes.size() * 12 * stride);
+
+  for (int i = 0; i < group.nodes.size(); ++i) {
+    const BatchNode &node = group.nodes.at(i);
+    float *rest = &group.restValues[i * 10 * stride];
+    if (node.translationTrack < 0) {
+      for (int c = 0; c < 3; ++c) {
+        std::fill(rest + c * stride, rest + (c + 1) * stride, node.restTranslation[c]);
+      }
+    }
+    if (node.rotationTrack < 0) {
+      const float rotation[4] = { node.restRotation.x, node.restRotation.y,
+        node.restRotation.z, node.restRotation.w };
+      for (int c = 0; c < 4; ++c) {
+        std::fill(rest + (3 + c) * stride, rest + (4 + c) * stride, rotation[c]);
+      }
+    }
+    if (node.scaleTrack < 0) {
+      for (int c = 0; c < 3; ++c) {
+        std::fill(rest + (7 + c) * stride, rest + (8 + c) * stride, node.restScale[c]);
+      }
+    }
+
+    PoseKernels::composeTRS(getTrackValues(group, i, node.translationTrack, 0),
+      getTrackValues(group, i, node.rotationTrack, 3),
+      getTrackValues(group, i, node.scaleTrack, 7),
+      &group.localMatrices[i * 12 * stride], stride);
+  }
+}
+
+const float *AnimationBatch::getTrackValues(BatchGroup &group, int nodeIndex, int track,
+    int restOffset) {
+  if (track < 0) {
+    return &group.restValues[(nodeIndex * 10 + restOffset) * group.laneStride];
+  }
+  return &group.trackValues[track * 4 * group.laneStride];
+}
+
+glm::vec3 AnimationBatch::getTranslation(BatchGroup &group, int nodeIndex, int lane) {
+  const float *values = getTrackValues(group, nodeIndex,
+    group.nodes.at(nodeIndex).translationTrack, 0);
+  int stride = group.laneStride;
+  return glm::vec3(values[lane], values[stride + lane], values[2 * stride + lane]);
+}
+
+glm::quat AnimationBatch::getRotation(BatchGroup &group, int nodeIndex, int lane) {
+  const float *values = getTrackValues(group, nodeIndex,
+    group.nodes.at(nodeIndex).rotationTrack, 3);
+  int stride = group.laneStride;
+  return glm::quat(values[3 * stride + lane], values[lane], values[stride + lane],
+    values[2 * stride + lane]);
+}
+
+glm::vec3 AnimationBatch::getScale(BatchGroup &group, int nodeIndex, int lane) {
+  const float *values = getTrackValues(group, nodeIndex,
+    group.nodes.at(nodeIndex).scaleTrack, 7);
+  int stride = group.laneStride;
+  return glm::vec3(values[lane], values[stride + lane], values[2 * stride + lane]);
+}
+
+glm::mat4x3 AnimationBatch::getLocalMatrix(BatchGroup &group, int nodeIndex, int lane) {
+  const float *values = &group.localMatrices[nodeIndex * 12 * group.laneStride];
+  int stride = group.laneStride;
+
+  glm::mat4x3 matrix;
+  for (int col = 0; col < 4; ++col) {
+    for (int row = 0; row < 3; ++row) {
+      matrix[col][row] = values[(col * 3 + row) * stride + lane];
+    }
+  }
+  return matrix;
+}
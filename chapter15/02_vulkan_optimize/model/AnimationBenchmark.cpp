@@ -0,0 +1,724 @@
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+#include "AnimationBenchmark.h"
+#include "AnimationBatch.h"
+#include "AnimationClock.h"
+#include "InstanceManager.h"
+#include "LayeredBlend.h"
+#include "PoseArena.h"
+#include "AffineTransform.h"
+#include "PoseKernels.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "Logger.h"
+
+void AnimationBenchmark::runAll(std::shared_ptr<GltfModel> model) {
+  std::vector<std::shared_ptr<GltfAnimationClip>> animClips = model->getAnimClips();
+  Logger::log(1, "%s: running animation benchmarks for %i clips\n", __FUNCTION__,
+    animClips.size());
+  runKeyframeSearch(model);
+  runResampledSampling(model);
+  runBatchEvaluation(animClips);
+  runNodeMatrices(animClips, model->getGltfSkeleton());
+  runLayeredBlend(animClips, model->getGltfSkeleton());
+  runTrackMasks(model);
+  runThreadScaling(model);
+  runDeterministicReplay(model);
+  Logger::log(1, "%s: animation benchmarks finished\n", __FUNCTION__);
+}
+
+void AnimationBenchmark::runKeyframeSearch(std::shared_ptr<GltfModel> model) {
+  Timer timer{};
+  std::vector<std::shared_ptr<GltfAnimationClip>> animClips = model->getAnimClips();
+
+  float totalSearchTime = 0.0f;
+  float totalCursorTime = 0.0f;
+
+  for (int clipNum = 0; clipNum < animClips.size(); ++clipNum) {
+    const std::shared_ptr<GltfAnimationClip> &clip = animClips.at(clipNum);
+    std::vector<std::shared_ptr<GltfAnimationChannel>> channels =
+      model->loadAnimationChannels(clipNum);
+    float endTime = clip->getClipEndTime();
+    if (channels.empty() || endTime <= 0.0f) {
+      continue;
+    }
+
+    /* same replay times for both runs, including the loop wrap */
+    std::vector<float> times(mNumFrames);
+    for (int i = 0; i < mNumFrames; ++i) {
+      times.at(i) = std::fmod(i * mFrameStep, endTime);
+    }
+
+    /* keep the results alive, the compiler may remove the calls otherwise */
+    std::vector<glm::vec4> searchResults(mNumFrames * channels.size());
+    std::vector<glm::vec4> cursorResults(mNumFrames * channels.size());
+
+    timer.start();
+    for (int i = 0; i < mNumFrames; ++i) {
+      for (int j = 0; j < channels.size(); ++j) {
+        std::shared_ptr<GltfAnimationChannel> &channel = channels.at(j);
+        switch(channel->getTargetPath()) {
+          case ETargetPath::ROTATION: {
+              glm::quat rotation = channel->getRotation(times.at(i));
+              searchResults.at(i * channels.size() + j) =
+                glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+            }
+            break;
+          case ETargetPath::TRANSLATION:
+            searchResults.at(i * channels.size() + j) =
+              glm::vec4(channel->getTranslation(times.at(i)), 0.0f);
+            break;
+          case ETargetPath::SCALE:
+            searchResults.at(i * channels.size() + j) =
+              glm::vec4(channel->getScaling(times.at(i)), 0.0f);
+            break;
+        }
+      }
+    }
+    float searchTime = timer.stop();
+
+    std::vector<unsigned int> keyCursors(channels.size(), 0);
+
+    timer.start();
+    for (int i = 0; i < mNumFrames; ++i) {
+      for (int j = 0; j < channels.size(); ++j) {
+        std::shared_ptr<GltfAnimationChannel> &channel = channels.at(j);
+        switch(channel->getTargetPath()) {
+          case ETargetPath::ROTATION: {
+              glm::quat rotation = channel->getRotation(times.at(i), keyCursors.at(j));
+              cursorResults.at(i * channels.size() + j) =
+                glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+            }
+            break;
+          case ETargetPath::TRANSLATION:
+            cursorResults.at(i * channels.size() + j) =
+              glm::vec4(channel->getTranslation(times.at(i), keyCursors.at(j)), 0.0f);
+            break;
+          case ETargetPath::SCALE:
+            cursorResults.at(i * channels.size() + j) =
+              glm::vec4(channel->getScaling(times.at(i), keyCursors.at(j)), 0.0f);
+            break;
+        }
+      }
+    }
+    float cursorTime = timer.stop();
+
+    /* both lookups must find the same keyframes */
+    float maxDiff = 0.0f;
+    for (int i = 0; i < searchResults.size(); ++i) {
+      glm::vec4 diff = glm::abs(searchResults.at(i) - cursorResults.at(i));
+      maxDiff = std::max({maxDiff, diff.x, diff.y, diff.z, diff.w});
+    }
+
+    Logger::log(1, "%s: clip '%s' (%i channels, %i frames): search %.3f ms, cursor %.3f ms, max diff %f\n",
+      __FUNCTION__, clip->getClipName().c_str(), channels.size(), mNumFrames, searchTime,
+      cursorTime, maxDiff);
+
+    totalSearchTime += searchTime;
+    totalCursorTime += cursorTime;
+  }
+
+  Logger::log(1, "%s: total: search %.3f ms, cursor %.3f ms\n", __FUNCTION__,
+    totalSearchTime, totalCursorTime);
+}
+
+void AnimationBenchmark::runResampledSampling(std::shared_ptr<GltfModel> model) {
+  Timer timer{};
+  std::vector<std::shared_ptr<GltfAnimationClip>> animClips = model->getAnimClips();
+
+  ModelLoadSettings loadSettings{};
+  loadSettings.mlsResampleAnimations = true;
+
+  float totalChannelTime = 0.0f;
+  float totalResampledTime = 0.0f;
+
+  for (int clipNum = 0; clipNum < animClips.size(); ++clipNum) {
+    const std::shared_ptr<GltfAnimationClip> &clip = animClips.at(clipNum);
+    std::vector<std::shared_ptr<GltfAnimationChannel>> channels =
+      model->loadAnimationChannels(clipNum);
+    float endTime = clip->getClipEndTime();
+    if (channels.empty() || endTime <= 0.0f) {
+      continue;
+    }
+
+    /* resampled copy of the same source channels */
+    GltfAnimationClip resampledClip(clip->getClipName());
+    int nodeCount = 0;
+    for (const auto &channel : channels) {
+      resampledClip.addChannel(channel);
+      nodeCount = std::max(nodeCount, channel->getTargetNode() + 1);
+    }
+    resampledClip.packChannels(loadSettings);
+
+    /* unconnected nodes, the local matrix is the node matrix */
+    std::shared_ptr<GltfSkeletonTopology> topology = std::make_shared<GltfSkeletonTopology>();
+    topology->setNodeCount(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+      topology->addNode(i, -1, "");
+    }
+    GltfSkeleton skeleton{};
+    skeleton.setTopology(topology);
+    std::vector<unsigned int> keyCursors(resampledClip.getTimeTrackCount(), 0);
+
+    std::vector<float> times(mNumFrames);
+    for (int i = 0; i < mNumFrames; ++i) {
+      times.at(i) = std::fmod(i * mFrameStep, endTime);
+    }
+
+    /* same work per frame as GltfAnimationClip::setAnimationFrame() */
+    std::vector<glm::quat> channelRotations{};
+    channelRotations.reserve(mNumFrames * channels.size());
+
+    timer.start();
+    for (int i = 0; i < mNumFrames; ++i) {
+      for (auto &channel : channels) {
+        int targetNode = channel->getTargetNode();
+        switch(channel->getTargetPath()) {
+          case ETargetPath::ROTATION:
+            skeleton.setRotation(targetNode, channel->getRotation(times.at(i)));
+            channelRotations.emplace_back(skeleton.getLocalRotation(targetNode));
+            break;
+          case ETargetPath::TRANSLATION:
+            skeleton.setTranslation(targetNode, channel->getTranslation(times.at(i)));
+            break;
+          case ETargetPath::SCALE:
+            skeleton.setScale(targetNode, channel->getScaling(times.at(i)));
+            break;
+        }
+      }
+      skeleton.updateNodeMatrices();
+    }
+    float channelTime = timer.stop();
+
+    timer.start();
+    for (int i = 0; i < mNumFrames; ++i) {
+      resampledClip.setAnimationFrame(skeleton, GltfAnimationClip::mAllTracks, times.at(i),
+        keyCursors);
+      skeleton.updateNodeMatrices();
+    }
+    float resampledTime = timer.stop();
+
+    /* second run to compare the rotations, not measured */
+    float maxAngle = 0.0f;
+    unsigned int rotationIndex = 0;
+    for (int i = 0; i < mNumFrames; ++i) {
+      resampledClip.setAnimationFrame(skeleton, GltfAnimationClip::mAllTracks, times.at(i),
+        keyCursors);
+      for (auto &channel : channels) {
+        if (channel->getTargetPath() == ETargetPath::ROTATION) {
+          glm::quat diff = glm::conjugate(channelRotations.at(rotationIndex++)) *
+            skeleton.getLocalRotation(channel->getTargetNode());
+          maxAngle = std::max(maxAngle, 2.0f *
+            std::atan2(glm::length(glm::vec3(diff.x, diff.y, diff.z)), std::fabs(diff.w)));
+        }
+      }
+    }
+
+    Logger::log(1, "%s: clip '%s' (%i channels, %i frames): getRotation() path %.3f ms, resampled %.3f ms, max angle diff %f\n",
+      __FUNCTION__, clip->getClipName().c_str(), channels.size(), mNumFrames, channelTime,
+      resampledTime, maxAngle);
+
+    totalChannelTime += channelTime;
+    totalResampledTime += resampledTime;
+  }
+
+  Logger::log(1, "%s: total: getRotation() path %.3f ms, resampled %.3f ms\n", __FUNCTION__,
+    totalChannelTime, totalResampledTime);
+}
+
+void AnimationBenchmark::runBatchEvaluation(
+    std::vector<std::shared_ptr<GltfAnimationClip>> animClips) {
+  Timer timer{};
+
+  ESimdLevel savedLevel = PoseKernels::getSimdLevel();
+  int levelCount = static_cast<int>(PoseKernels::getSupportedLevel()) + 1;
+
+  float totalScalarTime = 0.0f;
+  std::vector<float> totalBatchTimes(levelCount, 0.0f);
+  float maxDiff = 0.0f;
+  int clipCount = 0;
+
+  for (const auto &clip : animClips) {
+    std::vector<PackedTrack> tracks = clip->getTracks();
+    float endTime = clip->getClipEndTime();
+    if (tracks.empty() || endTime <= 0.0f) {
+      continue;
+    }
+    ++clipCount;
+
+    int nodeCount = 0;
+    for (const auto &track : tracks) {
+      nodeCount = std::max(nodeCount, track.targetNode + 1);
+    }
+    /* unconnected nodes, the local matrix is the node matrix */
+    std::shared_ptr<GltfSkeletonTopology> topology = std::make_shared<GltfSkeletonTopology>();
+    topology->setNodeCount(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+      topology->addNode(i, -1, "");
+    }
+    GltfSkeleton skeleton{};
+    skeleton.setTopology(topology);
+
+    std::vector<std::vector<unsigned int>> keyCursors(mBatchInstances,
+      std::vector<unsigned int>(clip->getTimeTrackCount(), 0));
+    std::vector<float> times(mBatchInstances);
+
+    /* GltfInstance path, one instance after the other */
+    timer.start();
+    for (int frame = 0; frame < mBatchFrames; ++frame) {
+      for (int i = 0; i < mBatchInstances; ++i) {
+        times.at(i) = std::fmod(frame * mFrameStep + i * mBatchTimeOffset, endTime);
+        clip->setAnimationFrame(skeleton, GltfAnimationClip::mAllTracks, times.at(i),
+          keyCursors.at(i));
+        skeleton.updateNodeMatrices();
+      }
+    }
+    float scalarTime = timer.stop();
+
+    /* local matrices of the last frame, not measured */
+    std::vector<glm::mat4> scalarMatrices{};
+    for (int i = 0; i < mBatchInstances; ++i) {
+      clip->setAnimationFrame(skeleton, GltfAnimationClip::mAllTracks, times.at(i),
+        keyCursors.at(i));
+      skeleton.updateNodeMatrices();
+      for (int j = 0; j < nodeCount; ++j) {
+        scalarMatrices.emplace_back(skeleton.getNodeMatrix(j));
+      }
+    }
+
+    BatchGroup group{};
+    AnimationBatch::initGroup(group, clip, nullptr);
+    group.times.resize(mBatchInstances);
+    for (auto &cursors : keyCursors) {
+      group.keyCursors.push_back(&cursors);
+    }
+
+    for (int level = 0; level < levelCount; ++level) {
+      PoseKernels::setSimdLevel(static_cast<ESimdLevel>(level));
+      for (auto &cursors : keyCursors) {
+        std::fill(cursors.begin(), cursors.end(), 0);
+      }
+
+      timer.start();
+      for (int frame = 0; frame < mBatchFrames; ++frame) {
+        for (int i = 0; i < mBatchInstances; ++i) {
+          group.times.at(i) = std::fmod(frame * mFrameStep + i * mBatchTimeOffset, endTime);
+        }
+        AnimationBatch::evaluateGroup(group);
+      }
+      totalBatchTimes.at(level) += timer.stop();
+
+      for (int i = 0; i < mBatchInstances; ++i) {
+        for (int j = 0; j < group.nodes.size(); ++j) {
+          glm::mat4 diff = glm::mat4(AnimationBatch::getLocalMatrix(group, j, i)) -
+            scalarMatrices.at(i * nodeCount + group.nodes.at(j).nodeNum);
+          for (int col = 0; col < 4; ++col) {
+            glm::vec4 absDiff = glm::abs(diff[col]);
+            maxDiff = std::max({maxDiff, absDiff.x, absDiff.y, absDiff.z, absDiff.w});
+          }
+        }
+      }
+    }
+
+    Logger::log(1, "%s: clip '%s' (%i tracks): scalar path %.3f ms\n", __FUNCTION__,
+      clip->getClipName().c_str(), tracks.size(), scalarTime);
+    totalScalarTime += scalarTime;
+  }
+  PoseKernels::setSimdLevel(savedLevel);
+
+  if (clipCount == 0) {
+    return;
+  }
+
+  /* poses per second, a pose is the set of local matrices of one instance */
+  float poseCount = static_cast<float>(clipCount) * mBatchInstances * mBatchFrames;
+  Logger::log(1, "%s: %i instances, %i frames, %i clips: scalar path %.3f ms (%.0f poses/s)\n",
+    __FUNCTION__, mBatchInstances, mBatchFrames, clipCount, totalScalarTime,
+    poseCount / totalScalarTime * 1000.0f);
+  for (int level = 0; level < levelCount; ++level) {
+    Logger::log(1, "%s: batch %s %.3f ms (%.0f poses/s)\n", __FUNCTION__,
+      PoseKernels::getSimdLevelName(static_cast<ESimdLevel>(level)).c_str(),
+      totalBatchTimes.at(level), poseCount / totalBatchTimes.at(level) * 1000.0f);
+  }
+  Logger::log(1, "%s: max local matrix diff to the scalar path %f\n", __FUNCTION__, maxDiff);
+}
+
+void AnimationBenchmark::runNodeMatrices(
+    std::vector<std::shared_ptr<GltfAnimationClip>> animClips, GltfSkeleton skeleton) {
+  Timer timer{};
+
+  std::shared_ptr<GltfSkeletonTopology> topology = skeleton.getTopology();
+  const std::vector<int> &nodeOrder = topology->getNodeOrder();
+  const std::vector<int> &parentNodes = topology->getParentNodes();
+  const std::vector<int> &nodeToJoint = topology->getNodeToJoint();
+  const std::vector<glm::mat4x3> &inverseBindTransforms = topology->getInverseBindMatrices();
+  std::vector<glm::mat4> inverseBindMatrices(inverseBindTransforms.begin(),
+    inverseBindTransforms.end());
+  int nodeCount = topology->getNodeCount();
+  int jointCount = topology->getJointCount();
+
+  glm::mat4 worldMatrix = skeleton.getWorldTRMatrix();
+  glm::mat4x3 worldTransform = glm::mat4x3(worldMatrix);
+
+  /* local values of all nodes for every pose, not measured */
+  std::vector<glm::vec3> translations{};
+  std::vector<glm::quat> rotations{};
+  std::vector<glm::vec3> scales{};
+  for (const auto &clip : animClips) {
+    float endTime = clip->getClipEndTime();
+    if (endTime <= 0.0f) {
+      continue;
+    }
+    std::vector<unsigned int> keyCursors(clip->getTimeTrackCount(), 0);
+    for (int i = 0; i < mMatrixFrames; ++i) {
+      clip->setAnimationFrame(skeleton, GltfAnimationClip::mAllTracks,
+        std::fmod(i * mFrameStep, endTime), keyCursors);
+      for (int nodeNum = 0; nodeNum < nodeCount; ++nodeNum) {
+        translations.emplace_back(skeleton.getLocalTranslation(nodeNum));
+        rotations.emplace_back(skeleton.getLocalRotation(nodeNum));
+        scales.emplace_back(skeleton.getLocalScale(nodeNum));
+      }
+    }
+  }
+
+  int poseCount = translations.size() / nodeCount;
+  if (poseCount == 0 || jointCount == 0) {
+    return;
+  }
+
+  /* joint matrices of all poses are kept, the compiler may remove the calculation otherwise */
+  std::vector<glm::mat4> matrixPalettes(poseCount * jointCount);
+  std::vector<glm::mat4> affinePalettes(poseCount * jointCount);
+
+  /* GltfSkeleton path before the affine transforms */
+  std::vector<glm::mat4> nodeMatrices(nodeCount);
+  timer.start();
+  for (int run = 0; run < mMatrixRuns; ++run) {
+    for (int pose = 0; pose < poseCount; ++pose) {
+      int offset = pose * nodeCount;
+      for (const auto nodeNum : nodeOrder) {
+        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f),
+          translations[offset + nodeNum]);
+        glm::mat4 rotationMatrix = glm::mat4_cast(rotations[offset + nodeNum]);
+        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scales[offset + nodeNum]);
+
+        int parentNodeNum = parentNodes[nodeNum];
+        if (parentNodeNum < 0) {
+          nodeMatrices[nodeNum] = worldMatrix * translationMatrix * rotationMatrix * scaleMatrix;
+        } else {
+          nodeMatrices[nodeNum] = nodeMatrices[parentNodeNum] *
+            (translationMatrix * rotationMatrix * scaleMatrix);
+        }
+
+        int jointNum = nodeToJoint[nodeNum];
+        if (jointNum >= 0) {
+          matrixPalettes[pose * jointCount + jointNum] =
+            nodeMatrices[nodeNum] * inverseBindMatrices[jointNum];
+        }
+      }
+    }
+  }
+  float matrixTime = timer.stop();
+
+  std::vector<glm::mat4x3> nodeTransforms(nodeCount);
+  timer.start();
+  for (int run = 0; run < mMatrixRuns; ++run) {
+    for (int pose = 0; pose < poseCount; ++pose) {
+      int offset = pose * nodeCount;
+      for (const auto nodeNum : nodeOrder) {
+        glm::mat4x3 localTransform = AffineTransform::fromTRS(translations[offset + nodeNum],
+          rotations[offset + nodeNum], scales[offset + nodeNum]);
+
+        int parentNodeNum = parentNodes[nodeNum];
+        if (parentNodeNum < 0) {
+          nodeTransforms[nodeNum] = AffineTransform::multiply(worldTransform, localTransform);
+        } else {
+          nodeTransforms[nodeNum] = AffineTransform::multiply(nodeTransforms[parentNodeNum],
+            localTransform);
+        }
+
+        int jointNum = nodeToJoint[nodeNum];
+        if (jointNum >= 0) {
+          affinePalettes[pose * jointCount + jointNum] = glm::mat4(AffineTransform::multiply(
+            nodeTransforms[nodeNum], inverseBindTransforms[jointNum]));
+        }
+      }
+    }
+  }
+  float affineTime = timer.stop();
+
+  float maxDiff = 0.0f;
+  for (int i = 0; i < matrixPalettes.size(); ++i) {
+    for (int col = 0; col < 4; ++col) {
+      glm::vec4 absDiff = glm::abs(matrixPalettes.at(i)[col] - affinePalettes.at(i)[col]);
+      maxDiff = std::max({maxDiff, absDiff.x, absDiff.y, absDiff.z, absDiff.w});
+    }
+  }
+
+  float nodeUpdates = static_cast<float>(mMatrixRuns) * poseCount * nodeOrder.size();
+  Logger::log(1, "%s: %i poses of %i nodes, %i runs: 4x4 matrices %.3f ms (%.0f nodes/s), affine %.3f ms (%.0f nodes/s)\n",
+    __FUNCTION__, poseCount, nodeOrder.size(), mMatrixRuns, matrixTime,
+    nodeUpdates / matrixTime * 1000.0f, affineTime, nodeUpdates / affineTime * 1000.0f);
+  Logger::log(1, "%s: max joint matrix diff %f\n", __FUNCTION__, maxDiff);
+}
+
+void AnimationBenchmark::runLayeredBlend(
+    std::vector<std::shared_ptr<GltfAnimationClip>> animClips, GltfSkeleton skeleton) {
+  Timer timer{};
+  const std::vector<int> layerCounts = { 1, 2, 4, 8 };
+  int nodeCount = skeleton.getNodeCount();
+  if (animClips.empty() || nodeCount == 0) {
+    return;
+  }
+
+  /* every other layer is additive and uses half of the nodes */
+  std::vector<bool> nodeMask(nodeCount, true);
+  std::vector<float> nodeWeights(nodeCount);
+  for (int i = 0; i < nodeCount; ++i) {
+    nodeWeights.at(i) = (i % 2) ? 0.75f : 0.0f;
+  }
+  std::vector<std::vector<unsigned int>> keyCursors{};
+  for (int i = 0; i < layerCounts.back(); ++i) {
+    keyCursors.emplace_back(animClips.at(i % animClips.size())->getTimeTrackCount(), 0);
+  }
+
+  PoseArena &arena = PoseArena::getThreadArena();
+  size_t arenaMark = arena.getMark();
+  PoseBuffer basePose = arena.allocatePose(nodeCount);
+  PoseBuffer blendedPose = arena.allocatePose(nodeCount);
+  skeleton.getBasePose(basePose);
+
+  std::vector<AnimationLayer> layers{};
+  float firstTime = 0.0f;
+  for (const auto layerCount : layerCounts) {
+    layers.resize(layerCount);
+    for (int i = 0; i < layerCount; ++i) {
+      AnimationLayer &layer = layers.at(i);
+      layer.clip = animClips.at(i % animClips.size()).get();
+      layer.keyCursors = &keyCursors.at(i);
+      layer.weight = 0.5f;
+      layer.nodeWeights = (i % 2) ? &nodeWeights : nullptr;
+      layer.mode = (i % 2) ? layerMode::additive : layerMode::override;
+    }
+
+    timer.start();
+    for (int frame = 0; frame < mLayerFrames; ++frame) {
+      for (auto &layer : layers) {
+        layer.time = std::fmod(frame * mFrameStep, layer.clip->getClipEndTime());
+      }
+      LayeredBlend::evaluate(layers, basePose, nodeMask, blendedPose);
+      skeleton.applyPose(blendedPose);
+      skeleton.updateNodeMatrices();
+    }
+    float time = timer.stop() / mLayerFrames * 1000.0f;
+    if (firstTime == 0.0f) {
+      firstTime = time;
+    }
+
+    Logger::log(1, "%s: %i layers, %i nodes: %.2f us per pose (%.2fx of 1 layer), %.1f ns per layer and node\n",
+      __FUNCTION__, layerCount, nodeCount, time, time / firstTime,
+      time * 1000.0f / (layerCount * nodeCount));
+  }
+  arena.release(arenaMark);
+}
+
+void AnimationBenchmark::runTrackMasks(std::shared_ptr<GltfModel> model) {
+  Timer timer{};
+  std::vector<std::shared_ptr<GltfAnimationClip>> animClips = model->getAnimClips();
+  int nodeCount = model->getNodeCount();
+  if (animClips.empty() || nodeCount == 0) {
+    return;
+  }
+
+  /* only the masks the model already has, registering a new mask would change
+   * the live model. split masks appear after an instance has used them */
+  std::vector<std::pair<std::string, int>> trackMasks{};
+  trackMasks.emplace_back("all tracks", GltfAnimationClip::mAllTracks);
+  for (int level = 1; level < GltfModel::mSkeletonLodCount; ++level) {
+    trackMasks.emplace_back("LOD level " + std::to_string(level),
+      model->getSkeletonLodTrackMask(level));
+  }
+  for (int mask = 0; mask < animClips.at(0)->getTrackMaskCount(); ++mask) {
+    if (std::find_if(trackMasks.begin(), trackMasks.end(),
+        [mask](const auto &trackMask) { return trackMask.second == mask; }) == trackMasks.end()) {
+      trackMasks.emplace_back("split mask " + std::to_string(mask), mask);
+    }
+  }
+
+  std::vector<std::vector<unsigned int>> keyCursors{};
+  for (const auto &clip : animClips) {
+    keyCursors.emplace_back(clip->getTimeTrackCount(), 0);
+  }
+
+  PoseArena &arena = PoseArena::getThreadArena();
+  size_t arenaMark = arena.getMark();
+  PoseBuffer pose = arena.allocatePose(nodeCount);
+
+  for (const auto &trackMask : trackMasks) {
+    int trackCount = 0;
+    for (const auto &clip : animClips) {
+      trackCount += clip->getMaskedTrackCount(trackMask.second);
+    }
+
+    timer.start();
+    for (int frame = 0; frame < mNumFrames; ++frame) {
+      for (int i = 0; i < animClips.size(); ++i) {
+        GltfAnimationClip *clip = animClips.at(i).get();
+        clip->samplePose(pose, trackMask.second,
+          std::fmod(frame * mFrameStep, clip->getClipEndTime()), keyCursors.at(i));
+      }
+    }
+    float time = timer.stop();
+
+    Logger::log(1, "%s: %s, %i tracks in %i clips: %.3f ms for %i frames, %.1f ns per track\n",
+      __FUNCTION__, trackMask.first.c_str(), trackCount, animClips.size(), time, mNumFrames,
+      trackCount > 0 ? time * 1.0e6f / (static_cast<float>(trackCount) * mNumFrames) : 0.0f);
+  }
+  arena.release(arenaMark);
+}
+
+void AnimationBenchmark::runThreadScaling(std::shared_ptr<GltfModel> model) {
+  Timer timer{};
+  ThreadPool threadPool{};
+  const std::vector<int> threadCounts = { 1, 2, 4, 8 };
+
+  std::vector<std::shared_ptr<GltfInstance>> instances{};
+  for (int i = 0; i < mBatchInstances; ++i) {
+    instances.emplace_back(std::make_shared<GltfInstance>(model,
+      glm::vec2(static_cast<float>(i % 40), static_cast<float>(-i / 40)), true));
+    ModelSettings settings = instances.back()->getInstanceSettings();
+    settings.msIkMode = ikMode::ccd;
+    instances.back()->setInstanceSettings(settings);
+    instances.back()->checkForUpdates();
+  }
+
+  std::vector<glm::mat4> firstPalettes{};
+  float firstAnimationTime = 0.0f;
+  float firstIKTime = 0.0f;
+  for (const auto threadCount : threadCounts) {
+    threadPool.setThreadCount(threadCount);
+
+    float animationTime = 0.0f;
+    float ikTime = 0.0f;
+    for (int frame = 0; frame < mScalingFrames; ++frame) {
+      timer.start();
+      threadPool.parallelFor(instances.size(), [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+          ModelSettings settings = instances.at(i)->getInstanceSettings();
+          float endTime = instances.at(i)->getAnimClip(settings.msAnimClip)->getClipEndTime();
+          instances.at(i)->updateAnimation(std::fmod(frame * mFrameStep * settings.msAnimSpeed +
+            i * mBatchTimeOffset, endTime));
+        }
+      });
+      animationTime += timer.stop();
+
+      timer.start();
+      threadPool.parallelFor(instances.size(), [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+          instances.at(i)->solveIK();
+        }
+      });
+      ikTime += timer.stop();
+    }
+    animationTime /= mScalingFrames;
+    ikTime /= mScalingFrames;
+
+    /* every thread count must create the same poses */
+    std::vector<glm::mat4> palettes{};
+    for (const auto &instance : instances) {
+      std::vector<glm::mat4> jointMatrices = instance->getJointMatrices();
+      palettes.insert(palettes.end(), jointMatrices.begin(), jointMatrices.end());
+    }
+    float maxDiff = 0.0f;
+    if (firstPalettes.empty()) {
+      firstPalettes = palettes;
+      firstAnimationTime = animationTime;
+      firstIKTime = ikTime;
+    }
+    for (int i = 0; i < palettes.size(); ++i) {
+      for (int col = 0; col < 4; ++col) {
+        glm::vec4 absDiff = glm::abs(palettes.at(i)[col] - firstPalettes.at(i)[col]);
+        maxDiff = std::max({maxDiff, absDiff.x, absDiff.y, absDiff.z, absDiff.w});
+      }
+    }
+
+    Logger::log(1, "%s: %i instances, %i threads (%i cores): animation %.3f ms (%.2fx), CCD %.3f ms (%.2fx) per frame, max joint matrix diff %f\n",
+      __FUNCTION__, instances.size(), threadCount, ThreadPool::getMaxThreadCount(),
+      animationTime, firstAnimationTime / animationTime, ikTime, firstIKTime / ikTime, maxDiff);
+  }
+}
+
+void AnimationBenchmark::runDeterministicReplay(std::shared_ptr<GltfModel> model) {
+  Timer timer{};
+
+  timer.start();
+  unsigned long long firstHash = replayPalettes(model, 1, false);
+  float firstTime = timer.stop();
+
+  timer.start();
+  unsigned long long secondHash = replayPalettes(model, ThreadPool::getMaxThreadCount(), true);
+  float secondTime = timer.stop();
+
+  Logger::log(1, "%s: %i instances, %i frames: palette hash %016llx (1 thread, %.1f ms), %016llx (%i threads, real frame times, %.1f ms), %s\n",
+    __FUNCTION__, mBatchInstances, mReplayFrames, firstHash, firstTime, secondHash,
+    ThreadPool::getMaxThreadCount(), secondTime,
+    firstHash == secondHash ? "bit-identical" : "DIFFERENT");
+}
+
+unsigned long long AnimationBenchmark::replayPalettes(std::shared_ptr<GltfModel> model,
+    int threadCount, bool realFrameTime) {
+  ThreadPool threadPool{};
+  threadPool.setThreadCount(threadCount);
+  AnimationBatch batch{};
+  batch.setThreadPool(&threadPool);
+
+  /* no random settings, every fifth instance is blended and not batched */
+  int clipCount = model->getAnimClips().size();
+  InstanceManager instanceManager{};
+  instanceManager.init(model, mBatchInstances);
+  std::vector<GltfInstance*> instances{};
+  for (int i = 0; i < mBatchInstances; ++i) {
+    int handle = instanceManager.addInstance(
+      glm::vec2(static_cast<float>(i % 40), static_cast<float>(-i / 40)), false);
+    ModelSettings settings = instanceManager.getInstance(handle)->getInstanceSettings();
+    settings.msAnimClip = i % clipCount;
+    settings.msAnimSpeed = 0.5f + (i % 100) / 100.0f;
+    if (i % 5 == 0) {
+      settings.msAnimBlendFactor = 0.5f;
+    }
+    instanceManager.setInstanceSettings(handle, settings);
+    instances.push_back(instanceManager.getInstance(handle));
+  }
+
+  AnimationClock clock{};
+  clock.setFixedStep(mFrameStep);
+
+  /* FNV-1a over the joint matrices of all frames */
+  unsigned long long hash = 14695981039346656037ull;
+  Timer frameTimer{};
+  float frameTime = 0.0f;
+  for (int frame = 0; frame < mReplayFrames; ++frame) {
+    if (realFrameTime) {
+      frameTimer.start();
+    }
+
+    clock.tick(realFrameTime ? frameTime / 1000.0f : mFrameStep);
+    instanceManager.advanceAnimationTimes(clock.getDeltaTime());
+    batch.updateAnimations(instances);
+
+    for (const auto instance : instances) {
+      const std::vector<glm::mat4> &jointMatrices = instance->getJointMatrices();
+      const unsigned char *bytes = reinterpret_cast<const unsigned char *>(jointMatrices.data());
+      for (size_t i = 0; i < jointMatrices.size() * sizeof(glm::mat4); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+      }
+    }
+
+    if (realFrameTime) {
+      frameTime = frameTimer.stop();
+    }
+  }
+  return hash;
+}
@@ -0,0 +1,32 @@
+/* animation time of all instances, advanced once per frame */
+#pragma once
+
+class AnimationClock {
+  public:
+    /* adds the frame time in seconds, or the fixed step if set */
+    void tick(double frameTime);
+    void reset();
+
+    void setPaused(bool paused);
+    bool isPaused();
+    void setTimeScale(float timeScale);
+    float getTimeScale();
+    /* a step of 0 uses the frame time, any other value replays the same times every run */
+    void setFixedStep(float fixedStep);
+    float getFixedStep();
+
+    /* scaled time of the last tick, 0 if paused */
+    float getDeltaTime();
+    /* sum of all deltas since the last reset */
+    double getTime();
+    unsigned long getTickCount();
+
+  private:
+    bool mPaused = false;
+    float mTimeScale = 1.0f;
+    float mFixedStep = 0.0f;
+
+    float mDeltaTime = 0.0f;
+    double mTime = 0.0;
+    unsigned long mTickCount = 0;
+};
@@ -0,0 +1,36 @@
+#include "AnimationLod.h"
+
+void AnimationLod::selectInstances(InstanceManager &instanceManager,
+    std::vector<GltfInstance*> &instances, glm::vec3 cameraPos, glm::vec3 bandDistances,
+    std::vector<GltfInstance*> &updateInstances) {
+  updateInstances.clear();
+  for (int i = 0; i < mBandCount; ++i) {
+    mBandInstances[i] = 0;
+  }
+
+  for (auto instance : instances) {
+    glm::vec2 worldPos = instance->getWorldPosition();
+    float distance = glm::length(glm::vec3(worldPos.x, 0.0f, worldPos.y) - cameraPos);
+
+    int band = 0;
+    for (int i = 0; i < mBandCount - 1; ++i) {
+      if (distance > bandDistances[i]) {
+        band = i + 1;
+      }
+    }
+
+    /* stagger by the handle, it does not change if other instances switch the band */
+    unsigned int interval = 1 << band;
+    unsigned int handle = instanceManager.getHandle(instance);
+    if ((mFrameNum + handle) % interval == 0) {
+      updateInstances.push_back(instance);
+    }
+    ++mBandInstances[band];
+  }
+
+  ++mFrameNum;
+}
+
+int AnimationLod::getBandInstanceCount(int band) {
+  return mBandInstances[band];
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+
+#include "BakedAnimations.h"
+#include "Logger.h"
+
+bool BakedAnimations::bake(std::shared_ptr<GltfModel> model, float frameRate) {
+  if (!model || frameRate <= 0.0f) {
+    Logger::log(1, "%s error: invalid model or frame rate\n", __FUNCTION__);
+    return false;
+  }
+
+  mFrameRate = frameRate;
+  mFrameCount = 0;
+  mClips.clear();
+  mJointMatrices.clear();
+  mJointDualQuats.clear();
+
+  /* scratch instance at the origin, the world transform is added in the shader.
+   * the dual quaternion mode calculates the joint matrices too */
+  std::shared_ptr<GltfInstance> bakeInstance =
+    std::make_shared<GltfInstance>(model, glm::vec2(0.0f));
+  ModelSettings settings = bakeInstance->getInstanceSettings();
+  settings.msVertexSkinningMode = skinningMode::dualQuat;
+  settings.msBlendingMode = blendMode::fadeinout;
+  settings.msAnimBlendFactor = 1.0f;
+
+  mJointCount = bakeInstance->getJointMatrixSize();
+
+  std::vector<std::shared_ptr<GltfAnimationClip>> clips = model->getAnimClips();
+  for (int i = 0; i < clips.size(); ++i) {
+    float endTime = clips.at(i)->getClipEndTime();
+
+    BakedClip clip{};
+    clip.firstFrame = mFrameCount;
+    clip.frameCount = std::max(1, static_cast<int>(std::ceil(endTime * mFrameRate)));
+    clip.endTime = endTime;
+    mClips.push_back(clip);
+
+    settings.msAnimClip = i;
+    bakeInstance->setInstanceSettings(settings);
+
+    for (int frame = 0; frame < clip.frameCount; ++frame) {
+      bakeInstance->updateAnimation(std::min(frame / mFrameRate, endTime));
+
+      std::vector<glm::mat4> matrices = bakeInstance->getJointMatrices();
+      mJointMatrices.insert(mJointMatrices.end(), matrices.begin(), matrices.end());
+      std::vector<glm::mat2x4> quats = bakeInstance->getJointDualQuats();
+      mJointDualQuats.insert(mJointDualQuats.end(), quats.begin(), quats.end());
+    }
+    mFrameCount += clip.frameCount;
+  }
+
+  Logger::log(1, "%s: baked %i clips with %i frames at %f fps (%i joints, %i bytes)\n",
+    __FUNCTION__, mClips.size(), mFrameCount, mFrameRate, mJointCount,
+    mJointMatrices.size() * sizeof(glm::mat4) + mJointDualQuats.size() * sizeof(glm::mat2x4));
+  return true;
+}
+
+bool BakedAnimations::isBaked() {
+  return mFrameCount > 0;
+}
+
+float BakedAnimations::getFrameRate() {
+  return mFrameRate;
+}
+
+int BakedAnimations::getJointCount() {
+  return mJointCount;
+}
+
+int BakedAnimations::getFrameCount() {
+  return mFrameCount;
+}
+
+BakedClip BakedAnimations::getClip(int clipNum) {
+  return mClips.at(clipNum);
+}
+
+std::vector<glm::mat4> BakedAnimations::getJointMatrices() {
+  return mJointMatrices;
+}
+
+std::vector<glm::mat2x4> BakedAnimations::getJointDualQuats() {
+  return mJointDualQuats;
+}
+
+int BakedAnimations::getFrameNum(BakedInstanceData instanceData, float replayTime) {
+  /* must match getPaletteOffset() in the gltf_gpu_baked shaders */
+  float time = replayTime * instanceData.replayData.x + instanceData.replayData.y;
+  float endTime = std::max(instanceData.replayData.z, 1e-6f);
+  float clipTime = time - endTime * std::floor(time / endTime);
+  float clipFrame = std::clamp(std::floor(clipTime * instanceData.clipData.w), 0.0f,
+    instanceData.clipData.y - 1.0f);
+  return static_cast<int>(instanceData.clipData.x + clipFrame);
+}
+
+std::vector<glm::mat4> BakedAnimations::getJointMatrices(BakedInstanceData instanceData,
+    float replayTime) {
+  int offset = getFrameNum(instanceData, replayTime) * mJointCount;
+  std::vector<glm::mat4> matrices(mJointMatrices.begin() + offset,
+    mJointMatrices.begin() + offset + mJointCount);
+  for (auto &matrix : matrices) {
+    matrix = instanceData.worldMatrix * matrix;
+  }
+  return matrices;
+}
+
+std::vector<glm::mat2x4> BakedAnimations::getJointDualQuats(BakedInstanceData instanceData,
+    float replayTime) {
+  int offset = getFrameNum(instanceData, replayTime) * mJointCount;
+  return std::vector<glm::mat2x4>(mJointDualQuats.begin() + offset,
+    mJointDualQuats.begin() + offset + mJointCount);
+}
+
+BakedInstanceData BakedAnimations::getInstanceData(const ModelSettings &settings,
+    glm::mat4 worldMatrix, float animationTime, double clockTime) {
+  BakedClip clip = mClips.at(settings.msAnimClip);
+
+  /* a stopped replay shows the frame at the position set in the UI */
+  float speed = 0.0f;
+  if (settings.msPlayAnimation) {
+    speed = settings.msAnimSpeed;
+    if (settings.msAnimationPlayDirection == replayDirection::backward) {
+      speed = -speed;
+    }
+  }
+  /* same time as the animated pose of the instance, no jump when (un)baking */
+  float timeOffset = static_cast<float>(animationTime - clockTime * speed);
+
+  BakedInstanceData instanceData{};
+  instanceData.worldMatrix = worldMatrix;
+  instanceData.clipData = glm::vec4(clip.firstFrame, clip.frameCount, mJointCount,
+    mFrameRate);
+  instanceData.replayData = glm::vec4(speed, timeOffset, clip.endTime, 0.0f);
+  return instanceData;
+}
@@ -0,0 +1,54 @@
+/* joint matrices and dual quaternions of all clips, sampled at a fixed frame rate */
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "GltfModel.h"
+#include "GltfInstance.h"
+
+#include "VkRenderData.h"
+
+/* frames of a single clip inside the baked palettes */
+struct BakedClip {
+  int firstFrame = 0;
+  int frameCount = 1;
+  float endTime = 0.0f;
+};
+
+class BakedAnimations {
+  public:
+    /* evaluates all clips of the model without world transform */
+    bool bake(std::shared_ptr<GltfModel> model, float frameRate);
+    bool isBaked();
+
+    float getFrameRate();
+    int getJointCount();
+    int getFrameCount();
+    BakedClip getClip(int clipNum);
+
+    /* palette of all frames, frame after frame with getJointCount() entries each */
+    std::vector<glm::mat4> getJointMatrices();
+    std::vector<glm::mat2x4> getJointDualQuats();
+
+    /* the frame lookup of the shaders, replay time is in seconds */
+    int getFrameNum(BakedInstanceData instanceData, float replayTime);
+    /* matrices include the world transform, the dual quaternions do not */
+    std::vector<glm::mat4> getJointMatrices(BakedInstanceData instanceData, float replayTime);
+    std::vector<glm::mat2x4> getJointDualQuats(BakedInstanceData instanceData,
+      float replayTime);
+
+    /* clip, speed and world transform for the shaders, no animation is done. the shaders
+     * show animationTime at clockTime and move on with the speed of the instance */
+    BakedInstanceData getInstanceData(const ModelSettings &settings, glm::mat4 worldMatrix,
+      float animationTime, double clockTime);
+
+  private:
+    float mFrameRate = 30.0f;
+    int mJointCount = 0;
+    int mFrameCount = 0;
+
+    std::vector<BakedClip> mClips{};
+    std::vector<glm::mat4> mJointMatrices{};
+    std::vector<glm::mat2x4> mJointDualQuats{};
+};
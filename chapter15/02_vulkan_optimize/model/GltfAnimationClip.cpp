@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cmath>
+
 #include "GltfAnimationClip.h"
+#include "PoseKernels.h"
+#include "PoseArena.h"
+#include "Logger.h"
 
 GltfAnimationClip::GltfAnimationClip(std::string name) : mClipName(name) {}
 
@@ -9,64 +15,824 @@ void GltfAnimationClip::addChannel(std::shared_ptr<tinygltf::Model> model,
   mAnimationChannels.push_back(chan);
 }
 
-void GltfAnimationClip::setAnimationFrame(std::vector<std::shared_ptr<GltfNode>> nodes,
-    std::vector<bool> additiveMask, float time) {
+void GltfAnimationClip::addChannel(std::shared_ptr<GltfAnimationChannel> channel) {
+  mAnimationChannels.push_back(channel);
+}
+
+void GltfAnimationClip::reduceKeyframes(ModelLoadSettings loadSettings) {
+  int numKeys = 0;
+  int removedKeys = 0;
   for (auto &channel : mAnimationChannels) {
-    int targetNode = channel->getTargetNode();
-    /* do not change if masked out */
-    if (additiveMask.at(targetNode)) {
-      switch(channel->getTargetPath()) {
-        case ETargetPath::ROTATION:
-          nodes.at(targetNode)->setRotation(channel->getRotation(time));
-          break;
-        case ETargetPath::TRANSLATION:
-          nodes.at(targetNode)->setTranslation(channel->getTranslation(time));
-          break;
-        case ETargetPath::SCALE:
-          nodes.at(targetNode)->setScale(channel->getScaling(time));
-          break;
+    numKeys += channel->getTimings().size();
+    removedKeys += channel->reduceKeyframes(loadSettings.mlsReducePositionTolerance,
+      loadSettings.mlsReduceAngleTolerance, loadSettings.mlsReduceScaleTolerance);
+  }
+
+  Logger::log(1, "%s: clip '%s' reduced from %i to %i keys (%.1f%% removed)\n", __FUNCTION__,
+    mClipName.c_str(), numKeys, numKeys - removedKeys,
+    numKeys > 0 ? 100.0f * removedKeys / numKeys : 0.0f);
+}
+
+void GltfAnimationClip::packChannels(ModelLoadSettings loadSettings) {
+  mPackedData.clear();
+  mTimeTracks.clear();
+  mTracks.clear();
+  mClipEndTime = 0.0f;
+
+  /* keep the tracks of a node next to each other */
+  std::vector<std::shared_ptr<GltfAnimationChannel>> channels = mAnimationChannels;
+  std::stable_sort(channels.begin(), channels.end(),
+    [](const auto &a, const auto &b) { return a->getTargetNode() < b->getTargetNode(); });
+
+  /* the exporters usually write the same key times for all channels of a clip */
+  std::vector<std::vector<float>> timings;
+  for (const auto &channel : channels) {
+    std::vector<float> channelTimings = channel->getTimings();
+    auto iter = std::find(timings.begin(), timings.end(), channelTimings);
+
+    PackedTrack track;
+    track.targetNode = channel->getTargetNode();
+    track.targetPath = channel->getTargetPath();
+    track.interType = channel->getInterpolationType();
+    track.timeTrack = std::distance(timings.begin(), iter);
+    mTracks.push_back(track);
+
+    if (iter == timings.end()) {
+      timings.push_back(channelTimings);
+    }
+  }
+
+  for (const auto &keyTimes : timings) {
+    PackedTimeTrack timeTrack;
+    timeTrack.dataOffset = mPackedData.size();
+    timeTrack.keyCount = keyTimes.size();
+    mTimeTracks.push_back(timeTrack);
+
+    mPackedData.insert(mPackedData.end(), keyTimes.begin(), keyTimes.end());
+    mClipEndTime = std::max(mClipEndTime, keyTimes.back());
+  }
+
+  for (size_t i = 0; i < channels.size(); ++i) {
+    mTracks.at(i).dataOffset = mPackedData.size();
+    switch(mTracks.at(i).targetPath) {
+      case ETargetPath::ROTATION:
+        for (const auto &rotation : channels.at(i)->getRotations()) {
+          mPackedData.insert(mPackedData.end(), { rotation.x, rotation.y, rotation.z,
+            rotation.w });
+        }
+        break;
+      case ETargetPath::TRANSLATION:
+        for (const auto &translation : channels.at(i)->getTranslations()) {
+          mPackedData.insert(mPackedData.end(), { translation.x, translation.y,
+            translation.z });
+        }
+        break;
+      case ETargetPath::SCALE:
+        for (const auto &scale : channels.at(i)->getScalings()) {
+          mPackedData.insert(mPackedData.end(), { scale.x, scale.y, scale.z });
+        }
+        break;
+    }
+  }
+  mPackedData.shrink_to_fit();
+
+  /* resampling and compression keep the tracks, the masks stay valid */
+  mTrackMasks.assign(1, std::vector<unsigned int>(mTracks.size()));
+  for (unsigned int i = 0; i < mTracks.size(); ++i) {
+    mTrackMasks.at(mAllTracks).at(i) = i;
+  }
+
+  Logger::log(1, "%s: clip '%s' packed into %i tracks, %i time tracks, %i bytes\n",
+    __FUNCTION__, mClipName.c_str(), mTracks.size(), mTimeTracks.size(),
+    mPackedData.size() * sizeof(float));
+
+  if (loadSettings.mlsResampleAnimations) {
+    resampleTracks(loadSettings.mlsResampleRate);
+    if (loadSettings.mlsCompressAnimations) {
+      Logger::log(1, "%s: clip '%s' is resampled, skipping compression\n", __FUNCTION__,
+        mClipName.c_str());
+    }
+  } else if (loadSettings.mlsCompressAnimations) {
+    compressTracks(loadSettings);
+  }
+
+  /* the source channels are not needed anymore */
+  mAnimationChannels.clear();
+}
+
+void GltfAnimationClip::resampleTracks(float sampleRate) {
+  /* small tolerance, a clip of exactly n frames must not get an extra frame by rounding */
+  mFrameCount = static_cast<unsigned int>(std::ceil(mClipEndTime * sampleRate - 0.001f)) + 1;
+  /* adjust the rate to hit the end of the clip with the last frame */
+  mSampleRate = mFrameCount > 1 ? (mFrameCount - 1) / mClipEndTime : 0.0f;
+
+  std::vector<unsigned int> frameOffsets;
+  mFrameSize = 0;
+  for (const auto &track : mTracks) {
+    frameOffsets.push_back(mFrameSize);
+    mFrameSize += track.targetPath == ETargetPath::ROTATION ? 4 : 3;
+  }
+
+  std::vector<float> frameData(mFrameCount * mFrameSize);
+  std::vector<unsigned int> keyCursors(mTimeTracks.size(), 0);
+  for (unsigned int frame = 0; frame < mFrameCount; ++frame) {
+    float time = mSampleRate > 0.0f ? frame / mSampleRate : 0.0f;
+    updateKeyCursors(time, keyCursors);
+
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+      const PackedTrack &track = mTracks.at(i);
+      unsigned int offset = frame * mFrameSize + frameOffsets.at(i);
+      unsigned int keyIndex = keyCursors.at(track.timeTrack);
+
+      if (track.targetPath == ETargetPath::ROTATION) {
+        glm::quat rotation = glm::normalize(sampleQuat(track, keyIndex, time));
+        /* keep neighbouring frames on the same hemisphere for the nlerp */
+        if (frame > 0) {
+          unsigned int prevOffset = offset - mFrameSize;
+          glm::quat prevRotation = glm::quat(frameData.at(prevOffset + 3),
+            frameData.at(prevOffset), frameData.at(prevOffset + 1), frameData.at(prevOffset + 2));
+          if (glm::dot(prevRotation, rotation) < 0.0f) {
+            rotation = -rotation;
+          }
+        }
+        frameData.at(offset) = rotation.x;
+        frameData.at(offset + 1) = rotation.y;
+        frameData.at(offset + 2) = rotation.z;
+        frameData.at(offset + 3) = rotation.w;
+      } else {
+        glm::vec3 value = sampleVec3(track, keyIndex, time);
+        frameData.at(offset) = value.x;
+        frameData.at(offset + 1) = value.y;
+        frameData.at(offset + 2) = value.z;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < mTracks.size(); ++i) {
+    mTracks.at(i).dataOffset = frameOffsets.at(i);
+    mTracks.at(i).interType = EInterpolationType::LINEAR;
+  }
+  mPackedData = frameData;
+  mTimeTracks.clear();
+  mResampled = true;
+
+  Logger::log(1, "%s: clip '%s' resampled to %i frames at %.2f Hz, %i bytes\n", __FUNCTION__,
+    mClipName.c_str(), mFrameCount, mSampleRate, mPackedData.size() * sizeof(float));
+}
+
+void GltfAnimationClip::compressTracks(ModelLoadSettings loadSettings) {
+  size_t uncompressedSize = mPackedData.size() * sizeof(float);
+
+  std::vector<float> floatData = mPackedData;
+  mPackedData.clear();
+  mQuantizedData.clear();
+
+  int quantizedTimeTracks = 0;
+  for (auto &timeTrack : mTimeTracks) {
+    std::vector<float> keyTimes(floatData.begin() + timeTrack.dataOffset,
+      floatData.begin() + timeTrack.dataOffset + timeTrack.keyCount);
+
+    float startTime = keyTimes.front();
+    float timeScale = (keyTimes.back() - startTime) / 65535.0f;
+
+    std::vector<uint16_t> quantizedTimes;
+    bool withinBudget = true;
+    float prevTime = 0.0f;
+    for (size_t i = 0; i < keyTimes.size(); ++i) {
+      uint16_t quantizedTime = quantizeValue(keyTimes.at(i), startTime, timeScale);
+      float newTime = startTime + quantizedTime * timeScale;
+      /* two keys must not collapse into a single one */
+      if (std::fabs(newTime - keyTimes.at(i)) > loadSettings.mlsMaxTimeError ||
+          (i > 0 && newTime <= prevTime)) {
+        withinBudget = false;
+        break;
       }
+      quantizedTimes.push_back(quantizedTime);
+      prevTime = newTime;
+    }
+
+    if (withinBudget) {
+      timeTrack.quantized = true;
+      timeTrack.startTime = startTime;
+      timeTrack.timeScale = timeScale;
+      timeTrack.dataOffset = mQuantizedData.size();
+      mQuantizedData.insert(mQuantizedData.end(), quantizedTimes.begin(), quantizedTimes.end());
+      quantizedTimeTracks++;
+    } else {
+      timeTrack.dataOffset = mPackedData.size();
+      mPackedData.insert(mPackedData.end(), keyTimes.begin(), keyTimes.end());
     }
   }
-  /* update all nodes in a single run */
-  for (auto &node : nodes) {
-    if (node) {
-      node->calculateLocalTRSMatrix();
+
+  int quantizedTracks = 0;
+  for (auto &track : mTracks) {
+    bool isRotation = track.targetPath == ETargetPath::ROTATION;
+    bool isCubicSpline = track.interType == EInterpolationType::CUBICSPLINE;
+    unsigned int numComponents = isRotation ? 4 : 3;
+    unsigned int numValues = mTimeTracks.at(track.timeTrack).keyCount * (isCubicSpline ? 3 : 1);
+
+    std::vector<float> values(floatData.begin() + track.dataOffset,
+      floatData.begin() + track.dataOffset + numValues * numComponents);
+
+    std::vector<uint16_t> quantizedValues;
+    bool withinBudget = true;
+
+    if (isRotation) {
+      /* cubic spline tangents are no unit quaternions */
+      withinBudget = !isCubicSpline;
+      for (unsigned int i = 0; i < numValues && withinBudget; ++i) {
+        glm::quat rotation = glm::normalize(glm::quat(values.at(i * 4 + 3), values.at(i * 4),
+          values.at(i * 4 + 1), values.at(i * 4 + 2)));
+        uint16_t encoded[3];
+        encodeQuat(rotation, encoded);
+        /* acos() of the dot product is too imprecise for small angles */
+        glm::quat diff = glm::conjugate(rotation) * decodeQuat(encoded);
+        float angle = 2.0f * std::atan2(glm::length(glm::vec3(diff.x, diff.y, diff.z)),
+          std::fabs(diff.w));
+        if (angle > loadSettings.mlsMaxRotationError) {
+          withinBudget = false;
+        }
+        quantizedValues.insert(quantizedValues.end(), encoded, encoded + 3);
+      }
+    } else {
+      float maxError = track.targetPath == ETargetPath::TRANSLATION ?
+        loadSettings.mlsMaxTranslationError : loadSettings.mlsMaxScaleError;
+
+      glm::vec3 rangeMin = glm::vec3(values.at(0), values.at(1), values.at(2));
+      glm::vec3 rangeMax = rangeMin;
+      for (unsigned int i = 0; i < numValues; ++i) {
+        glm::vec3 value = glm::vec3(values.at(i * 3), values.at(i * 3 + 1), values.at(i * 3 + 2));
+        rangeMin = glm::min(rangeMin, value);
+        rangeMax = glm::max(rangeMax, value);
+      }
+      track.rangeMin = rangeMin;
+      track.rangeScale = (rangeMax - rangeMin) / 65535.0f;
+
+      for (unsigned int i = 0; i < numValues && withinBudget; ++i) {
+        glm::vec3 value = glm::vec3(values.at(i * 3), values.at(i * 3 + 1), values.at(i * 3 + 2));
+        glm::vec3 quantized = glm::vec3(
+          quantizeValue(value.x, track.rangeMin.x, track.rangeScale.x),
+          quantizeValue(value.y, track.rangeMin.y, track.rangeScale.y),
+          quantizeValue(value.z, track.rangeMin.z, track.rangeScale.z));
+        if (glm::length(track.rangeMin + quantized * track.rangeScale - value) > maxError) {
+          withinBudget = false;
+        }
+        quantizedValues.insert(quantizedValues.end(), { static_cast<uint16_t>(quantized.x),
+          static_cast<uint16_t>(quantized.y), static_cast<uint16_t>(quantized.z) });
+      }
+    }
+
+    if (withinBudget) {
+      track.quantized = true;
+      track.dataOffset = mQuantizedData.size();
+      mQuantizedData.insert(mQuantizedData.end(), quantizedValues.begin(),
+        quantizedValues.end());
+      quantizedTracks++;
+    } else {
+      track.dataOffset = mPackedData.size();
+      mPackedData.insert(mPackedData.end(), values.begin(), values.end());
     }
   }
+  mPackedData.shrink_to_fit();
+  mQuantizedData.shrink_to_fit();
+
+  size_t compressedSize = mPackedData.size() * sizeof(float) +
+    mQuantizedData.size() * sizeof(uint16_t);
+  Logger::log(1, "%s: clip '%s' compressed from %i to %i bytes (%i bytes saved), %i of %i time tracks and %i of %i tracks quantized\n",
+    __FUNCTION__, mClipName.c_str(), uncompressedSize, compressedSize,
+    uncompressedSize - compressedSize, quantizedTimeTracks, mTimeTracks.size(),
+    quantizedTracks, mTracks.size());
 }
 
-void GltfAnimationClip::blendAnimationFrame(std::vector<std::shared_ptr<GltfNode>> nodes,
-    std::vector<bool> additiveMask, float time, float blendFactor) {
-  for (auto &channel : mAnimationChannels) {
-    int targetNode = channel->getTargetNode();
-    /* do not change if masked out */
-    if (additiveMask.at(targetNode)) {
-      switch(channel->getTargetPath()) {
+uint16_t GltfAnimationClip::quantizeValue(float value, float rangeMin, float rangeScale) {
+  if (rangeScale <= 0.0f) {
+    return 0;
+  }
+  return static_cast<uint16_t>(std::clamp(std::round((value - rangeMin) / rangeScale), 0.0f,
+    65535.0f));
+}
+
+/* "smallest three": the largest component is left out and restored from the unit length.
+ * the other three components are within [-1/sqrt(2), 1/sqrt(2)] and use 15 bits each,
+ * the index of the largest component is stored in the upper bits of the first two values */
+void GltfAnimationClip::encodeQuat(glm::quat rotation, uint16_t *data) {
+  float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+  int largestIndex = 0;
+  for (int i = 1; i < 4; ++i) {
+    if (std::fabs(components[i]) > std::fabs(components[largestIndex])) {
+      largestIndex = i;
+    }
+  }
+
+  /* q and -q are the same rotation, make the largest component positive */
+  float sign = components[largestIndex] < 0.0f ? -1.0f : 1.0f;
+  float rangeMin = -1.0f / std::sqrt(2.0f);
+  float rangeScale = std::sqrt(2.0f) / 32767.0f;
+
+  int dataIndex = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i != largestIndex) {
+      data[dataIndex++] = std::min(quantizeValue(sign * components[i], rangeMin, rangeScale),
+        static_cast<uint16_t>(32767));
+    }
+  }
+  data[0] |= (largestIndex & 1) << 15;
+  data[1] |= (largestIndex >> 1) << 15;
+}
+
+glm::quat GltfAnimationClip::decodeQuat(const uint16_t *data) {
+  float rangeMin = -1.0f / std::sqrt(2.0f);
+  float rangeScale = std::sqrt(2.0f) / 32767.0f;
+  int largestIndex = (data[0] >> 15) | ((data[1] >> 15) << 1);
+
+  float components[4];
+  float lengthSquared = 0.0f;
+  int dataIndex = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i != largestIndex) {
+      components[i] = rangeMin + (data[dataIndex++] & 0x7fff) * rangeScale;
+      lengthSquared += components[i] * components[i];
+    }
+  }
+  components[largestIndex] = std::sqrt(std::max(1.0f - lengthSquared, 0.0f));
+
+  return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+int GltfAnimationClip::addTrackMask(const std::vector<bool> &nodeMask) {
+  std::vector<unsigned int> tracks{};
+  for (unsigned int i = 0; i < mTracks.size(); ++i) {
+    int nodeNum = mTracks.at(i).targetNode;
+    if (nodeNum < static_cast<int>(nodeMask.size()) && nodeMask.at(nodeNum)) {
+      tracks.emplace_back(i);
+    }
+  }
+  mTrackMasks.emplace_back(tracks);
+  return mTrackMasks.size() - 1;
+}
+
+int GltfAnimationClip::getTrackMaskCount() {
+  return mTrackMasks.size();
+}
+
+int GltfAnimationClip::getMaskedTrackCount(int trackMask) {
+  return mTrackMasks.at(trackMask).size();
+}
+
+void GltfAnimationClip::setAnimationFrame(GltfSkeleton &skeleton, int trackMask, float time,
+    std::vector<unsigned int> &keyCursors) {
+  const std::vector<unsigned int> &tracks = mTrackMasks.at(trackMask);
+  if (mResampled) {
+    setResampledFrame(skeleton, tracks, time);
+  } else {
+    updateKeyCursors(time, keyCursors);
+
+    for (const auto trackNum : tracks) {
+      const PackedTrack &track = mTracks[trackNum];
+      unsigned int keyIndex = keyCursors.at(track.timeTrack);
+      switch(track.targetPath) {
         case ETargetPath::ROTATION:
-          nodes.at(targetNode)->blendRotation(channel->getRotation(time), blendFactor);
+          skeleton.setRotation(track.targetNode, sampleQuat(track, keyIndex, time));
           break;
         case ETargetPath::TRANSLATION:
-          nodes.at(targetNode)->blendTranslation(channel->getTranslation(time), blendFactor);
+          skeleton.setTranslation(track.targetNode, sampleVec3(track, keyIndex, time));
           break;
         case ETargetPath::SCALE:
-          nodes.at(targetNode)->blendScale(channel->getScaling(time), blendFactor);
+          skeleton.setScale(track.targetNode, sampleVec3(track, keyIndex, time));
           break;
       }
     }
   }
-  /* update all nodes in a single run */
-  for (auto &node : nodes) {
-    if (node) {
-      node->calculateLocalTRSMatrix();
+}
+
+void GltfAnimationClip::samplePose(PoseBuffer &pose, int trackMask, float time,
+    std::vector<unsigned int> &keyCursors) {
+  const std::vector<unsigned int> &tracks = mTrackMasks[trackMask];
+  if (mResampled) {
+    sampleResampledPose(pose, tracks, time);
+    return;
+  }
+  updateKeyCursors(time, keyCursors);
+
+  for (const auto trackNum : tracks) {
+    const PackedTrack &track = mTracks[trackNum];
+    int nodeNum = track.targetNode;
+    unsigned int keyIndex = keyCursors[track.timeTrack];
+    switch(track.targetPath) {
+      case ETargetPath::ROTATION:
+        pose.rotations[nodeNum] = sampleQuat(track, keyIndex, time);
+        pose.written[nodeNum] |= PoseBuffer::mRotationBit;
+        break;
+      case ETargetPath::TRANSLATION:
+        pose.translations[nodeNum] = sampleVec3(track, keyIndex, time);
+        pose.written[nodeNum] |= PoseBuffer::mTranslationBit;
+        break;
+      case ETargetPath::SCALE:
+        pose.scales[nodeNum] = sampleVec3(track, keyIndex, time);
+        pose.written[nodeNum] |= PoseBuffer::mScaleBit;
+        break;
     }
   }
 }
 
+/* fixed frame rate, the frames around 'time' are found without a search */
+void GltfAnimationClip::getResampledFrames(float time, unsigned int &prevFrameOffset,
+    unsigned int &nextFrameOffset, float &interpolatedTime) {
+  float framePosition = std::clamp(time * mSampleRate, 0.0f,
+    static_cast<float>(mFrameCount - 1));
+  unsigned int prevFrame = std::min(static_cast<unsigned int>(framePosition),
+    mFrameCount > 1 ? mFrameCount - 2 : 0);
+  unsigned int nextFrame = std::min(prevFrame + 1, mFrameCount - 1);
+
+  prevFrameOffset = prevFrame * mFrameSize;
+  nextFrameOffset = nextFrame * mFrameSize;
+  interpolatedTime = framePosition - prevFrame;
+}
+
+glm::vec3 GltfAnimationClip::getResampledVec3(unsigned int prevOffset, unsigned int nextOffset,
+    float interpolatedTime) {
+  glm::vec3 prevValue = glm::vec3(mPackedData[prevOffset], mPackedData[prevOffset + 1],
+    mPackedData[prevOffset + 2]);
+  glm::vec3 nextValue = glm::vec3(mPackedData[nextOffset], mPackedData[nextOffset + 1],
+    mPackedData[nextOffset + 2]);
+  return prevValue + interpolatedTime * (nextValue - prevValue);
+}
+
+/* normalized lerp, the frames are close enough to skip the slerp */
+glm::quat GltfAnimationClip::getResampledQuat(unsigned int prevOffset, unsigned int nextOffset,
+    float interpolatedTime) {
+  glm::quat prevValue = glm::quat(mPackedData[prevOffset + 3], mPackedData[prevOffset],
+    mPackedData[prevOffset + 1], mPackedData[prevOffset + 2]);
+  glm::quat nextValue = glm::quat(mPackedData[nextOffset + 3], mPackedData[nextOffset],
+    mPackedData[nextOffset + 1], mPackedData[nextOffset + 2]);
+  return glm::normalize(prevValue * (1.0f - interpolatedTime) + nextValue * interpolatedTime);
+}
+
+void GltfAnimationClip::setResampledFrame(GltfSkeleton &skeleton,
+    const std::vector<unsigned int> &tracks, float time) {
+  unsigned int prevFrameOffset = 0;
+  unsigned int nextFrameOffset = 0;
+  float interpolatedTime = 0.0f;
+  getResampledFrames(time, prevFrameOffset, nextFrameOffset, interpolatedTime);
+
+  for (const auto trackNum : tracks) {
+    const PackedTrack &track = mTracks[trackNum];
+    unsigned int prevOffset = prevFrameOffset + track.dataOffset;
+    unsigned int nextOffset = nextFrameOffset + track.dataOffset;
+    switch(track.targetPath) {
+      case ETargetPath::ROTATION:
+        skeleton.setRotation(track.targetNode, getResampledQuat(prevOffset, nextOffset,
+          interpolatedTime));
+        break;
+      case ETargetPath::TRANSLATION:
+        skeleton.setTranslation(track.targetNode, getResampledVec3(prevOffset, nextOffset,
+          interpolatedTime));
+        break;
+      case ETargetPath::SCALE:
+        skeleton.setScale(track.targetNode, getResampledVec3(prevOffset, nextOffset,
+          interpolatedTime));
+        break;
+    }
+  }
+}
+
+void GltfAnimationClip::sampleResampledPose(PoseBuffer &pose,
+    const std::vector<unsigned int> &tracks, float time) {
+  unsigned int prevFrameOffset = 0;
+  unsigned int nextFrameOffset = 0;
+  float interpolatedTime = 0.0f;
+  getResampledFrames(time, prevFrameOffset, nextFrameOffset, interpolatedTime);
+
+  for (const auto trackNum : tracks) {
+    const PackedTrack &track = mTracks[trackNum];
+    int nodeNum = track.targetNode;
+    unsigned int prevOffset = prevFrameOffset + track.dataOffset;
+    unsigned int nextOffset = nextFrameOffset + track.dataOffset;
+    switch(track.targetPath) {
+      case ETargetPath::ROTATION:
+        pose.rotations[nodeNum] = getResampledQuat(prevOffset, nextOffset, interpolatedTime);
+        pose.written[nodeNum] |= PoseBuffer::mRotationBit;
+        break;
+      case ETargetPath::TRANSLATION:
+        pose.translations[nodeNum] = getResampledVec3(prevOffset, nextOffset,
+          interpolatedTime);
+        pose.written[nodeNum] |= PoseBuffer::mTranslationBit;
+        break;
+      case ETargetPath::SCALE:
+        pose.scales[nodeNum] = getResampledVec3(prevOffset, nextOffset, interpolatedTime);
+        pose.written[nodeNum] |= PoseBuffer::mScaleBit;
+        break;
+    }
+  }
+}
+
+/* the cursor of a time track ends up on the last key with a time <= 'time' */
+void GltfAnimationClip::updateKeyCursors(float time, std::vector<unsigned int> &keyCursors) {
+  for (size_t i = 0; i < mTimeTracks.size(); ++i) {
+    const PackedTimeTrack &timeTrack = mTimeTracks.at(i);
+    unsigned int lastKeyIndex = timeTrack.keyCount - 1;
+    unsigned int keyIndex = keyCursors.at(i);
+
+    /* same or next key, like in GltfAnimationChannel::findKeyIndex() */
+    if (keyIndex < lastKeyIndex && time >= getKeyTime(timeTrack, keyIndex)) {
+      if (time < getKeyTime(timeTrack, keyIndex + 1)) {
+        continue;
+      }
+      if (keyIndex + 1 == lastKeyIndex || time < getKeyTime(timeTrack, keyIndex + 2)) {
+        keyCursors.at(i) = keyIndex + 1;
+        continue;
+      }
+    }
+
+    if (keyIndex == lastKeyIndex && time >= getKeyTime(timeTrack, lastKeyIndex)) {
+      continue;
+    }
+
+    keyCursors.at(i) = searchKeyIndex(timeTrack, time);
+  }
+}
+
+unsigned int GltfAnimationClip::searchKeyIndex(const PackedTimeTrack &timeTrack, float time) {
+  unsigned int lowIndex = 0;
+  unsigned int highIndex = timeTrack.keyCount - 1;
+  while (lowIndex < highIndex) {
+    unsigned int midIndex = (lowIndex + highIndex + 1) / 2;
+    if (getKeyTime(timeTrack, midIndex) <= time) {
+      lowIndex = midIndex;
+    } else {
+      highIndex = midIndex - 1;
+    }
+  }
+  return lowIndex;
+}
+
+/* all offsets are created in packChannels(), skip the range checks in the hot path */
+float GltfAnimationClip::getKeyTime(const PackedTimeTrack &timeTrack, unsigned int keyIndex) {
+  if (timeTrack.quantized) {
+    return timeTrack.startTime +
+      mQuantizedData[timeTrack.dataOffset + keyIndex] * timeTrack.timeScale;
+  }
+  return mPackedData[timeTrack.dataOffset + keyIndex];
+}
+
+glm::vec3 GltfAnimationClip::getVec3(const PackedTrack &track, unsigned int valueIndex) {
+  unsigned int offset = track.dataOffset + valueIndex * 3;
+  if (track.quantized) {
+    return track.rangeMin + track.rangeScale * glm::vec3(mQuantizedData[offset],
+      mQuantizedData[offset + 1], mQuantizedData[offset + 2]);
+  }
+  return glm::vec3(mPackedData[offset], mPackedData[offset + 1], mPackedData[offset + 2]);
+}
+
+glm::quat GltfAnimationClip::getQuat(const PackedTrack &track, unsigned int valueIndex) {
+  if (track.quantized) {
+    return decodeQuat(&mQuantizedData[track.dataOffset + valueIndex * 3]);
+  }
+  /* stored as x, y, z, w */
+  unsigned int offset = track.dataOffset + valueIndex * 4;
+  return glm::quat(mPackedData[offset + 3], mPackedData[offset], mPackedData[offset + 1],
+    mPackedData[offset + 2]);
+}
+
+glm::vec3 GltfAnimationClip::sampleVec3(const PackedTrack &track, unsigned int keyIndex,
+    float time) {
+  const PackedTimeTrack &timeTrack = mTimeTracks.at(track.timeTrack);
+  bool isCubicSpline = track.interType == EInterpolationType::CUBICSPLINE;
+
+  float prevTime = getKeyTime(timeTrack, keyIndex);
+  glm::vec3 prevValue = getVec3(track, isCubicSpline ? keyIndex * 3 + 1 : keyIndex);
+
+  /* before the first or after the last key, or exact hit */
+  if (keyIndex == timeTrack.keyCount - 1 || time <= prevTime) {
+    return prevValue;
+  }
+
+  float deltaTime = getKeyTime(timeTrack, keyIndex + 1) - prevTime;
+  float interpolatedTime = (time - prevTime) / deltaTime;
+  glm::vec3 nextValue = getVec3(track, isCubicSpline ? (keyIndex + 1) * 3 + 1 : keyIndex + 1);
+
+  glm::vec3 finalValue = prevValue;
+  switch(track.interType) {
+    case EInterpolationType::STEP:
+      break;
+    case EInterpolationType::LINEAR:
+      finalValue = prevValue + interpolatedTime * (nextValue - prevValue);
+      break;
+    case EInterpolationType::CUBICSPLINE:
+      {
+        /* scale tangents */
+        glm::vec3 prevTangent = deltaTime * getVec3(track, keyIndex * 3 + 2);
+        glm::vec3 nextTangent = deltaTime * getVec3(track, (keyIndex + 1) * 3);
+
+        float interpolatedTimeSq = interpolatedTime * interpolatedTime;
+        float interpolatedTimeCub = interpolatedTimeSq * interpolatedTime;
+
+        finalValue =
+          (2 * interpolatedTimeCub - 3 * interpolatedTimeSq + 1) * prevValue +
+          (interpolatedTimeCub - 2 * interpolatedTimeSq + interpolatedTime) * prevTangent +
+          (-2 * interpolatedTimeCub + 3 * interpolatedTimeSq) * nextValue +
+          (interpolatedTimeCub - interpolatedTimeSq) * nextTangent;
+      }
+      break;
+  }
+
+  return finalValue;
+}
+
+glm::quat GltfAnimationClip::sampleQuat(const PackedTrack &track, unsigned int keyIndex,
+    float time) {
+  const PackedTimeTrack &timeTrack = mTimeTracks.at(track.timeTrack);
+  bool isCubicSpline = track.interType == EInterpolationType::CUBICSPLINE;
+
+  float prevTime = getKeyTime(timeTrack, keyIndex);
+  glm::quat prevValue = getQuat(track, isCubicSpline ? keyIndex * 3 + 1 : keyIndex);
+
+  if (keyIndex == timeTrack.keyCount - 1 || time <= prevTime) {
+    return prevValue;
+  }
+
+  float deltaTime = getKeyTime(timeTrack, keyIndex + 1) - prevTime;
+  float interpolatedTime = (time - prevTime) / deltaTime;
+  glm::quat nextValue = getQuat(track, isCubicSpline ? (keyIndex + 1) * 3 + 1 : keyIndex + 1);
+
+  glm::quat finalValue = prevValue;
+  switch(track.interType) {
+    case EInterpolationType::STEP:
+      break;
+    case EInterpolationType::LINEAR:
+      finalValue = glm::slerp(prevValue, nextValue, interpolatedTime);
+      break;
+    case EInterpolationType::CUBICSPLINE:
+      {
+        /* scale tangents */
+        glm::quat prevTangent = deltaTime * getQuat(track, keyIndex * 3 + 2);
+        glm::quat nextTangent = deltaTime * getQuat(track, (keyIndex + 1) * 3);
+
+        float interpolatedTimeSq = interpolatedTime * interpolatedTime;
+        float interpolatedTimeCub = interpolatedTimeSq * interpolatedTime;
+
+        finalValue =
+          (2 * interpolatedTimeCub - 3 * interpolatedTimeSq + 1) * prevValue +
+          (interpolatedTimeCub - 2 * interpolatedTimeSq + interpolatedTime) * prevTangent +
+          (-2 * interpolatedTimeCub + 3 * interpolatedTimeSq) * nextValue +
+          (interpolatedTimeCub - interpolatedTimeSq) * nextTangent;
+        finalValue = glm::normalize(finalValue);
+      }
+      break;
+  }
+
+  return finalValue;
+}
+
+void GltfAnimationClip::sampleBatch(const std::vector<float> &times,
+    std::vector<std::vector<unsigned int> *> &keyCursors, int laneStride, int trackMask,
+    std::vector<float> &trackValues) {
+  int laneCount = times.size();
+  if (laneCount == 0) {
+    return;
+  }
+  trackValues.resize(mTracks.size() * 4 * laneStride);
+
+  /* scratch memory of the calling thread, padding lanes repeat the last instance */
+  PoseArena &arena = PoseArena::getThreadArena();
+  size_t arenaMark = arena.getMark();
+  unsigned int *prevOffsets = arena.allocate<unsigned int>(laneStride);
+  unsigned int *nextOffsets = arena.allocate<unsigned int>(laneStride);
+  float *factors = arena.allocate<float>(laneStride);
+  float *prevValues = arena.allocate<float>(4 * laneStride);
+  float *nextValues = arena.allocate<float>(4 * laneStride);
+  std::fill(factors, factors + laneStride, 0.0f);
+
+  if (mResampled) {
+    for (int lane = 0; lane < laneStride; ++lane) {
+      getResampledFrames(times[std::min(lane, laneCount - 1)], prevOffsets[lane],
+        nextOffsets[lane], factors[lane]);
+    }
+  } else {
+    for (int lane = 0; lane < laneCount; ++lane) {
+      updateKeyCursors(times[lane], *keyCursors[lane]);
+    }
+  }
+
+  /* keys and factors are the same for all tracks sharing a time track */
+  unsigned int *laneKeys = arena.allocate<unsigned int>(mTimeTracks.size() * laneStride);
+  unsigned int *laneNextKeys = arena.allocate<unsigned int>(mTimeTracks.size() * laneStride);
+  float *laneFactors = arena.allocate<float>(mTimeTracks.size() * laneStride);
+  for (size_t i = 0; i < mTimeTracks.size(); ++i) {
+    const PackedTimeTrack &timeTrack = mTimeTracks.at(i);
+    for (int lane = 0; lane < laneStride; ++lane) {
+      int sourceLane = std::min(lane, laneCount - 1);
+      float time = times[sourceLane];
+      unsigned int keyIndex = keyCursors[sourceLane]->at(i);
+      unsigned int index = i * laneStride + lane;
+
+      /* exact hits and the end of the clip use the previous key only */
+      float prevTime = getKeyTime(timeTrack, keyIndex);
+      laneKeys[index] = keyIndex;
+      laneNextKeys[index] = keyIndex;
+      laneFactors[index] = 0.0f;
+      if (keyIndex < timeTrack.keyCount - 1 && time > prevTime) {
+        laneNextKeys[index] = keyIndex + 1;
+        laneFactors[index] = (time - prevTime) / (getKeyTime(timeTrack, keyIndex + 1) - prevTime);
+      }
+    }
+  }
+
+  for (const auto i : mTrackMasks.at(trackMask)) {
+    const PackedTrack &track = mTracks[i];
+    bool isRotation = track.targetPath == ETargetPath::ROTATION;
+    int componentCount = isRotation ? 4 : 3;
+    float *result = &trackValues[i * 4 * laneStride];
+
+    for (int lane = 0; lane < laneStride; ++lane) {
+      int sourceLane = std::min(lane, laneCount - 1);
+      if (mResampled) {
+        for (int c = 0; c < componentCount; ++c) {
+          prevValues[c * laneStride + lane] = mPackedData[prevOffsets[lane] + track.dataOffset + c];
+          nextValues[c * laneStride + lane] = mPackedData[nextOffsets[lane] + track.dataOffset + c];
+        }
+        continue;
+      }
+
+      unsigned int index = track.timeTrack * laneStride + lane;
+      unsigned int keyIndex = laneKeys[index];
+
+      /* no SIMD version of the cubic spline, store the final value */
+      if (track.interType == EInterpolationType::CUBICSPLINE) {
+        float time = times[sourceLane];
+        if (isRotation) {
+          glm::quat rotation = sampleQuat(track, keyIndex, time);
+          result[lane] = rotation.x;
+          result[laneStride + lane] = rotation.y;
+          result[2 * laneStride + lane] = rotation.z;
+          result[3 * laneStride + lane] = rotation.w;
+        } else {
+          glm::vec3 value = sampleVec3(track, keyIndex, time);
+          for (int c = 0; c < 3; ++c) {
+            result[c * laneStride + lane] = value[c];
+          }
+        }
+        continue;
+      }
+
+      /* STEP keeps the previous value until the next key */
+      bool isLinear = track.interType == EInterpolationType::LINEAR;
+      unsigned int nextKeyIndex = isLinear ? laneNextKeys[index] : keyIndex;
+      factors[lane] = isLinear ? laneFactors[index] : 0.0f;
+
+      if (isRotation) {
+        glm::quat prevValue = getQuat(track, keyIndex);
+        glm::quat nextValue = getQuat(track, nextKeyIndex);
+        prevValues[lane] = prevValue.x;
+        prevValues[laneStride + lane] = prevValue.y;
+        prevValues[2 * laneStride + lane] = prevValue.z;
+        prevValues[3 * laneStride + lane] = prevValue.w;
+        nextValues[lane] = nextValue.x;
+        nextValues[laneStride + lane] = nextValue.y;
+        nextValues[2 * laneStride + lane] = nextValue.z;
+        nextValues[3 * laneStride + lane] = nextValue.w;
+      } else {
+        glm::vec3 prevValue = getVec3(track, keyIndex);
+        glm::vec3 nextValue = getVec3(track, nextKeyIndex);
+        for (int c = 0; c < 3; ++c) {
+          prevValues[c * laneStride + lane] = prevValue[c];
+          nextValues[c * laneStride + lane] = nextValue[c];
+        }
+      }
+    }
+
+    if (track.interType == EInterpolationType::CUBICSPLINE) {
+      continue;
+    }
+
+    if (!isRotation) {
+      PoseKernels::lerpVec3(prevValues, nextValues, factors, result, laneStride);
+    } else if (mResampled) {
+      PoseKernels::nlerpQuat(prevValues, nextValues, factors, result, laneStride);
+    } else {
+      PoseKernels::slerpQuat(prevValues, nextValues, factors, result, laneStride);
+    }
+  }
+  arena.release(arenaMark);
+}
+
+std::vector<PackedTrack> GltfAnimationClip::getTracks() {
+  return mTracks;
+}
+
 float GltfAnimationClip::getClipEndTime() {
-  return mAnimationChannels.at(0)->getMaxTime();;
+  return mClipEndTime;
 }
 
 std::string GltfAnimationClip::getClipName() {
   return mClipName;
 }
+
+bool GltfAnimationClip::isResampled() {
+  return mResampled;
+}
+
+int GltfAnimationClip::getTimeTrackCount() {
+  return mTimeTracks.size();
+}
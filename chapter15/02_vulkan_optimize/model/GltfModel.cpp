@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <limits>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/dual_quaternion.hpp>
@@ -12,7 +13,7 @@
 #include "Logger.h"
 
 bool GltfModel::loadModel(VkRenderData &renderData, std::string modelFilename,
-    std::string textureFilename) {
+    std::string textureFilename, ModelLoadSettings loadSettings) {
   if (!Texture::loadTexture(renderData, mGltfRenderData.rdGltfModelTexture, textureFilename)) {
     Logger::log(1, "%s: texture loading failed\n", __FUNCTION__);
     return false;
@@ -58,8 +59,16 @@ bool GltfModel::loadModel(VkRenderData &renderData, std::string modelFilename,
 
   mNodeCount = mModel->nodes.size();
 
+  /* node hierarchy and bind pose, shared by all instances */
+  createSkeletonTopology();
+
   /* extract animation data */
-  getAnimations();
+  getAnimations(loadSettings);
+
+  /* joint sets for distant instances */
+  createSkeletonLods();
+
+  createMetadata();
 
   return true;
 }
@@ -72,23 +81,48 @@ int GltfModel::getNodeCount() {
   return mNodeCount;
 }
 
-GltfNodeData GltfModel::getGltfNodes() {
-  GltfNodeData nodeData{};
+GltfSkeleton GltfModel::getGltfSkeleton() {
+  return mBindPoseSkeleton;
+}
+
+const ModelMetadata &GltfModel::getMetadata() {
+  return mMetadata;
+}
+
+void GltfModel::createMetadata() {
+  mMetadata.mdSkelNodeNames.clear();
+  for (int i = 0; i < mBindPoseSkeleton.getNodeCount(); ++i) {
+    if (mBindPoseSkeleton.hasNode(i)) {
+      mMetadata.mdSkelNodeNames.push_back(mBindPoseSkeleton.getNodeName(i));
+    } else {
+      mMetadata.mdSkelNodeNames.push_back("(invalid)");
+    }
+  }
+
+  mMetadata.mdClipNames.clear();
+  for (const auto &clip : mAnimClips) {
+    mMetadata.mdClipNames.push_back(clip->getClipName());
+  }
+}
+
+void GltfModel::createSkeletonTopology() {
+  mSkeletonTopology = std::make_shared<GltfSkeletonTopology>();
 
   int rootNodeNum = mModel->scenes.at(0).nodes.at(0);
-  Logger::log(2, "%s: model has %i nodes, root node is %i\n", __FUNCTION__,
+  Logger::log(1, "%s: model has %i nodes, root node is %i\n", __FUNCTION__,
     mNodeCount, rootNodeNum);
 
-  nodeData.rootNode = GltfNode::createRoot(rootNodeNum);
+  mSkeletonTopology->setNodeCount(mNodeCount);
+  mSkeletonTopology->addNode(rootNodeNum, -1, mModel->nodes.at(rootNodeNum).name);
 
-  getNodeData(nodeData.rootNode);
-  getNodes(nodeData.rootNode);
+  getNodeData(rootNodeNum);
+  getNodes(rootNodeNum);
 
-  nodeData.nodeList.resize(mNodeCount);
-  nodeData.nodeList.at(rootNodeNum) = nodeData.rootNode;
-  getNodeList(nodeData.nodeList, rootNodeNum);
+  mSkeletonTopology->setJoints(mNodeToJoint, mInverseBindMatrices);
 
-  return nodeData;
+  /* copied for every new instance, saves the matrix update */
+  mBindPoseSkeleton.setTopology(mSkeletonTopology);
+  mBindPoseSkeleton.updateNodeMatrices();
 }
 
 void GltfModel::getJointData() {
@@ -108,7 +142,8 @@ void GltfModel::getJointData() {
   std::memcpy(mJointVec.data(), &buffer.data.at(0) + bufferView.byteOffset,
     bufferView.byteLength);
 
-  mNodeToJoint.resize(mModel->nodes.size());
+  /* -1 for nodes without a joint */
+  mNodeToJoint.assign(mModel->nodes.size(), -1);
 
   const tinygltf::Skin &skin = mModel->skins.at(0);
   for (int i = 0; i < skin.joints.size(); ++i) {
@@ -150,7 +185,7 @@ void GltfModel::getInvBindMatrices() {
     bufferView.byteLength);
 }
 
-void GltfModel::getAnimations() {
+void GltfModel::getAnimations(ModelLoadSettings loadSettings) {
   for (const auto &anim : mModel->animations) {
     Logger::log(1, "%s: loading animation '%s' with %i channels\n", __FUNCTION__,
       anim.name.c_str(), anim.channels.size());
@@ -158,74 +193,183 @@ void GltfModel::getAnimations() {
     for (const auto& channel : anim.channels) {
       clip->addChannel(mModel, anim, channel);
     }
+    if (loadSettings.mlsReduceKeyframes) {
+      clip->reduceKeyframes(loadSettings);
+    }
+    clip->packChannels(loadSettings);
     mAnimClips.push_back(clip);
   }
+  /* the first mask of the clips contains all tracks */
+  mTrackMaskNodes.assign(1, std::vector<bool>(mNodeCount, true));
 }
 
 std::vector<std::shared_ptr<GltfAnimationClip>> GltfModel::getAnimClips() {
   return mAnimClips;
 }
 
-void GltfModel::getNodes(std::shared_ptr<GltfNode> treeNode) {
-  int nodeNum = treeNode->getNodeNum();
-  std::vector<int> childNodes = mModel->nodes.at(nodeNum).children;
+std::vector<std::shared_ptr<GltfAnimationChannel>> GltfModel::loadAnimationChannels(
+    int clipNum) {
+  std::vector<std::shared_ptr<GltfAnimationChannel>> channels{};
+  const tinygltf::Animation &anim = mModel->animations.at(clipNum);
+  for (const auto &channel : anim.channels) {
+    std::shared_ptr<GltfAnimationChannel> chan = std::make_shared<GltfAnimationChannel>();
+    chan->loadChannelData(mModel, anim, channel);
+    channels.push_back(chan);
+  }
+  return channels;
+}
 
-  /* remove the child node with skin/mesh metadata */
-  auto removeIt = std::remove_if(childNodes.begin(), childNodes.end(),
-    [&](int num) { return mModel->nodes.at(num).skin != -1; }
-  );
-  childNodes.erase(removeIt, childNodes.end());
+void GltfModel::createSkeletonLods() {
+  /* minimal extent of a joint chain per level, relative to the skeleton size. removes the
+   * end joints first, then fingers and toes, then hands and feet */
+  const float lodExtents[mSkeletonLodCount] = { 0.0f, 0.01f, 0.06f, 0.1f };
+
+  const tinygltf::Skin &skin = mModel->skins.at(0);
+  std::vector<glm::vec3> jointPositions(mNodeCount, glm::vec3(0.0f));
+  std::vector<bool> isJoint(mNodeCount, false);
+
+  glm::vec3 minPos = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 maxPos = glm::vec3(std::numeric_limits<float>::lowest());
+  for (int i = 0; i < skin.joints.size(); ++i) {
+    int nodeNum = skin.joints.at(i);
+    jointPositions.at(nodeNum) = glm::vec3(glm::inverse(mInverseBindMatrices.at(i))[3]);
+    isJoint.at(nodeNum) = true;
+    minPos = glm::min(minPos, jointPositions.at(nodeNum));
+    maxPos = glm::max(maxPos, jointPositions.at(nodeNum));
+  }
+  mSkeletonSize = skin.joints.empty() ? 0.0f : glm::length(maxPos - minPos);
+
+  int rootNodeNum = mModel->scenes.at(0).nodes.at(0);
+  mSkeletonLodMasks.resize(mSkeletonLodCount);
+  mSkeletonLodSkippedChannels.resize(mSkeletonLodCount);
+  mSkeletonLodTrackMasks.resize(mSkeletonLodCount);
+  for (int level = 0; level < mSkeletonLodCount; ++level) {
+    std::vector<bool> &lodMask = mSkeletonLodMasks.at(level);
+    lodMask.assign(mNodeCount, true);
+    if (level > 0) {
+      pruneSkeletonLod(lodMask, rootNodeNum, lodExtents[level] * mSkeletonSize,
+        jointPositions, isJoint);
+    }
+
+    mSkeletonLodTrackMasks.at(level) = getTrackMask(lodMask);
 
-  treeNode->addChilds(childNodes);
+    std::vector<int> &skippedChannels = mSkeletonLodSkippedChannels.at(level);
+    skippedChannels.assign(mAnimClips.size(), 0);
+    for (int i = 0; i < mAnimClips.size(); ++i) {
+      for (const auto &track : mAnimClips.at(i)->getTracks()) {
+        if (!lodMask.at(track.targetNode)) {
+          ++skippedChannels.at(i);
+        }
+      }
+    }
 
-  for (auto &childNode : treeNode->getChilds()) {
-    getNodeData(childNode);
-    getNodes(childNode);
+    Logger::log(1, "%s: skeleton LOD level %i uses %i of %i nodes\n", __FUNCTION__, level,
+      std::count(lodMask.begin(), lodMask.end(), true), mNodeCount);
   }
 }
 
-void GltfModel::getNodeData(std::shared_ptr<GltfNode> treeNode) {
-  int nodeNum = treeNode->getNodeNum();
-  const tinygltf::Node& node = mModel->nodes.at(nodeNum);
-  treeNode->setNodeName(node.name);
+float GltfModel::getJointExtent(int nodeNum, glm::vec3 jointPos,
+    const std::vector<glm::vec3> &jointPositions, const std::vector<bool> &isJoint) {
+  float extent = 0.0f;
+  if (isJoint.at(nodeNum)) {
+    extent = glm::length(jointPositions.at(nodeNum) - jointPos);
+  }
 
-  if (node.translation.size()) {
-    treeNode->setTranslation(glm::make_vec3(node.translation.data()));
+  for (const auto childNodeNum : mModel->nodes.at(nodeNum).children) {
+    extent = std::max(extent, getJointExtent(childNodeNum, jointPos, jointPositions, isJoint));
   }
-  if (node.rotation.size()) {
-    treeNode->setRotation(glm::make_quat(node.rotation.data()));
+  return extent;
+}
+
+void GltfModel::pruneSkeletonLod(std::vector<bool> &lodMask, int nodeNum, float minExtent,
+    const std::vector<glm::vec3> &jointPositions, const std::vector<bool> &isJoint) {
+  /* small joint chains are removed as a whole. the pruned joints take the skinning
+   * transform of the parent joint, a chain must start below another joint */
+  int parentNodeNum = mSkeletonTopology->getParentNodeNum(nodeNum);
+  if (isJoint.at(nodeNum) && parentNodeNum >= 0 && isJoint.at(parentNodeNum) &&
+      getJointExtent(nodeNum, jointPositions.at(nodeNum), jointPositions, isJoint) < minExtent) {
+    std::vector<int> prunedNodes = { nodeNum };
+    while (!prunedNodes.empty()) {
+      int prunedNodeNum = prunedNodes.back();
+      prunedNodes.pop_back();
+      lodMask.at(prunedNodeNum) = false;
+      const std::vector<int> &childNodes = mModel->nodes.at(prunedNodeNum).children;
+      prunedNodes.insert(prunedNodes.end(), childNodes.begin(), childNodes.end());
+    }
+    return;
   }
-  if (node.scale.size()) {
-    treeNode->setScale(glm::make_vec3(node.scale.data()));
+
+  for (const auto childNodeNum : mModel->nodes.at(nodeNum).children) {
+    pruneSkeletonLod(lodMask, childNodeNum, minExtent, jointPositions, isJoint);
   }
+}
 
-  treeNode->calculateNodeMatrix();
+std::vector<bool> GltfModel::getSkeletonLodMask(int level) {
+  return mSkeletonLodMasks.at(level);
 }
 
-void GltfModel::resetNodeData(std::shared_ptr<GltfNode> treeNode) {
-  getNodeData(treeNode);
+int GltfModel::getSkeletonLodSkippedChannels(int level, int clipNum) {
+  return mSkeletonLodSkippedChannels.at(level).at(clipNum);
+}
 
-  for (auto &childNode : treeNode->getChilds()) {
-    resetNodeData(childNode);
-  }
+int GltfModel::getSkeletonLodTrackMask(int level) {
+  return mSkeletonLodTrackMasks.at(level);
 }
 
-std::vector<std::shared_ptr<GltfNode>> GltfModel::getNodeList(
-    std::vector<std::shared_ptr<GltfNode>> &nodeList, int nodeNum) {
-  for (auto &childNode : nodeList.at(nodeNum)->getChilds()) {
-    int childNodeNum = childNode->getNodeNum();
-    nodeList.at(childNodeNum) = childNode;
-    getNodeList(nodeList, childNodeNum);
+int GltfModel::getTrackMask(const std::vector<bool> &nodeMask) {
+  auto iter = std::find(mTrackMaskNodes.begin(), mTrackMaskNodes.end(), nodeMask);
+  if (iter != mTrackMaskNodes.end()) {
+    return std::distance(mTrackMaskNodes.begin(), iter);
+  }
+
+  /* all clips got the same masks in the same order */
+  int trackMask = mTrackMaskNodes.size();
+  for (const auto &clip : mAnimClips) {
+    clip->addTrackMask(nodeMask);
   }
-  return nodeList;
+  mTrackMaskNodes.emplace_back(nodeMask);
+  return trackMask;
 }
 
-std::vector<glm::mat4> GltfModel::getInverseBindMatrices() {
-  return mInverseBindMatrices;
+float GltfModel::getSkeletonSize() {
+  return mSkeletonSize;
 }
 
-std::vector<int> GltfModel::getNodeToJoint() {
-  return mNodeToJoint;
+void GltfModel::getNodes(int nodeNum) {
+  std::vector<int> childNodes = mModel->nodes.at(nodeNum).children;
+
+  /* remove the child node with skin/mesh metadata */
+  auto removeIt = std::remove_if(childNodes.begin(), childNodes.end(),
+    [&](int num) { return mModel->nodes.at(num).skin != -1; }
+  );
+  childNodes.erase(removeIt, childNodes.end());
+
+  for (const auto childNodeNum : childNodes) {
+    mSkeletonTopology->addNode(childNodeNum, nodeNum, mModel->nodes.at(childNodeNum).name);
+    getNodeData(childNodeNum);
+    getNodes(childNodeNum);
+  }
+}
+
+void GltfModel::getNodeData(int nodeNum) {
+  const tinygltf::Node &node = mModel->nodes.at(nodeNum);
+
+  glm::vec3 translation = glm::vec3(0.0f);
+  if (node.translation.size()) {
+    translation = glm::make_vec3(node.translation.data());
+  }
+
+  glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  if (node.rotation.size()) {
+    rotation = glm::make_quat(node.rotation.data());
+  }
+
+  glm::vec3 scale = glm::vec3(1.0f);
+  if (node.scale.size()) {
+    scale = glm::make_vec3(node.scale.data());
+  }
+
+  mSkeletonTopology->setBindPose(nodeNum, translation, rotation, scale);
 }
 
 void GltfModel::createVertexBuffers(VkRenderData &renderData) {
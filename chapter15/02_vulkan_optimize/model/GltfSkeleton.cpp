@@ -0,0 +1,492 @@
+#include <cmath>
+#include <algorithm>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include "GltfSkeleton.h"
+#include "Logger.h"
+
+bool GltfSkeleton::mDecomposeValidation = false;
+
+void GltfSkeleton::setTopology(std::shared_ptr<GltfSkeletonTopology> topology) {
+  mTopology = topology;
+
+  int nodeCount = mTopology->getNodeCount();
+  mLocalMatrixNeedsUpdate.assign(nodeCount, true);
+  mNodeMatrixNeedsUpdate.assign(nodeCount, true);
+  mLocalMatrices.assign(nodeCount, glm::mat4x3(1.0f));
+  mNodeMatrices.assign(nodeCount, glm::mat4x3(1.0f));
+  mNodeMatrixUpdates.assign(nodeCount, 0);
+  mGlobalRotations.assign(nodeCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  mGlobalRotationUpdates.assign(nodeCount, 0);
+
+  resetPose();
+}
+
+std::shared_ptr<GltfSkeletonTopology> GltfSkeleton::getTopology() {
+  return mTopology;
+}
+
+void GltfSkeleton::resetPose() {
+  mTranslations = mTopology->getBindTranslations();
+  mRotations = mTopology->getBindRotations();
+  mScales = mTopology->getBindScales();
+
+  mBlendTranslations = mTranslations;
+  mBlendRotations = mRotations;
+  mBlendScales = mScales;
+
+  std::fill(mLocalMatrixNeedsUpdate.begin(), mLocalMatrixNeedsUpdate.end(), true);
+  std::fill(mNodeMatrixNeedsUpdate.begin(), mNodeMatrixNeedsUpdate.end(), true);
+}
+
+int GltfSkeleton::getNodeCount() {
+  return mTopology->getNodeCount();
+}
+
+bool GltfSkeleton::hasNode(int nodeNum) {
+  return mTopology->hasNode(nodeNum);
+}
+
+int GltfSkeleton::getRootNodeNum() {
+  return mTopology->getRootNodeNum();
+}
+
+int GltfSkeleton::getParentNodeNum(int nodeNum) {
+  return mTopology->getParentNodeNum(nodeNum);
+}
+
+std::vector<int> GltfSkeleton::getChildNodeNums(int nodeNum) {
+  return mTopology->getChildNodeNums(nodeNum);
+}
+
+std::string GltfSkeleton::getNodeName(int nodeNum) {
+  return mTopology->getNodeName(nodeNum);
+}
+
+const std::vector<int> &GltfSkeleton::getNodeOrder() {
+  return mTopology->getNodeOrder();
+}
+
+int GltfSkeleton::getOrderIndex(int nodeNum) {
+  return mTopology->getOrderIndex(nodeNum);
+}
+
+int GltfSkeleton::getSubtreeSize(int nodeNum) {
+  return mTopology->getSubtreeSize(nodeNum);
+}
+
+int GltfSkeleton::getJointCount() {
+  return mTopology->getJointCount();
+}
+
+const std::vector<int> &GltfSkeleton::getNodeToJoint() {
+  return mTopology->getNodeToJoint();
+}
+
+const std::vector<glm::mat4x3> &GltfSkeleton::getInverseBindMatrices() {
+  return mTopology->getInverseBindMatrices();
+}
+
+const std::vector<glm::quat> &GltfSkeleton::getInverseBindRotations() {
+  return mTopology->getInverseBindRotations();
+}
+
+const std::vector<glm::vec3> &GltfSkeleton::getInverseBindTranslations() {
+  return mTopology->getInverseBindTranslations();
+}
+
+void GltfSkeleton::setTranslation(int nodeNum, glm::vec3 translation) {
+  mTranslations[nodeNum] = translation;
+  if (mBlendTranslations[nodeNum] != translation) {
+    mBlendTranslations[nodeNum] = translation;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::setRotation(int nodeNum, glm::quat rotation) {
+  mRotations[nodeNum] = rotation;
+  if (mBlendRotations[nodeNum] != rotation) {
+    mBlendRotations[nodeNum] = rotation;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::setScale(int nodeNum, glm::vec3 scale) {
+  mScales[nodeNum] = scale;
+  if (mBlendScales[nodeNum] != scale) {
+    mBlendScales[nodeNum] = scale;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::blendTranslation(int nodeNum, glm::vec3 translation, float blendFactor) {
+  float factor = std::clamp(blendFactor, 0.0f, 1.0f);
+  glm::vec3 blendTranslation = translation * factor + mTranslations[nodeNum] * (1.0f - factor);
+  if (mBlendTranslations[nodeNum] != blendTranslation) {
+    mBlendTranslations[nodeNum] = blendTranslation;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::blendRotation(int nodeNum, glm::quat rotation, float blendFactor) {
+  float factor = std::clamp(blendFactor, 0.0f, 1.0f);
+  glm::quat blendRotation = glm::slerp(mRotations[nodeNum], rotation, factor);
+  if (mBlendRotations[nodeNum] != blendRotation) {
+    mBlendRotations[nodeNum] = blendRotation;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::blendScale(int nodeNum, glm::vec3 scale, float blendFactor) {
+  float factor = std::clamp(blendFactor, 0.0f, 1.0f);
+  glm::vec3 blendScale = scale * factor + mScales[nodeNum] * (1.0f - factor);
+  if (mBlendScales[nodeNum] != blendScale) {
+    mBlendScales[nodeNum] = blendScale;
+    markLocalMatrix(nodeNum);
+  }
+}
+
+void GltfSkeleton::getBasePose(PoseBuffer &pose) {
+  std::copy(mTranslations.begin(), mTranslations.end(), pose.translations);
+  std::copy(mRotations.begin(), mRotations.end(), pose.rotations);
+  std::copy(mScales.begin(), mScales.end(), pose.scales);
+  std::fill(pose.written, pose.written + pose.nodeCount, 0);
+}
+
+void GltfSkeleton::applyPose(const PoseBuffer &pose) {
+  for (int i = 0; i < pose.nodeCount; ++i) {
+    unsigned char written = pose.written[i];
+    if (!written) {
+      continue;
+    }
+    bool changed = false;
+    if ((written & PoseBuffer::mTranslationBit) &&
+        mBlendTranslations[i] != pose.translations[i]) {
+      mBlendTranslations[i] = pose.translations[i];
+      changed = true;
+    }
+    if ((written & PoseBuffer::mRotationBit) && mBlendRotations[i] != pose.rotations[i]) {
+      mBlendRotations[i] = pose.rotations[i];
+      changed = true;
+    }
+    if ((written & PoseBuffer::mScaleBit) && mBlendScales[i] != pose.scales[i]) {
+      mBlendScales[i] = pose.scales[i];
+      changed = true;
+    }
+    if (changed) {
+      markLocalMatrix(i);
+    }
+  }
+}
+
+void GltfSkeleton::setLocalTRS(int nodeNum, glm::vec3 translation, glm::quat rotation,
+    glm::vec3 scale, const glm::mat4x3 &trsMatrix) {
+  /* like a blend with factor 1.0, the base values stay for later blending */
+  mBlendTranslations[nodeNum] = translation;
+  mBlendRotations[nodeNum] = rotation;
+  mBlendScales[nodeNum] = scale;
+
+  glm::mat4x3 localMatrix = trsMatrix;
+  if (mTopology->getParentNodeNum(nodeNum) < 0) {
+    localMatrix = AffineTransform::multiply(mWorldTransform, trsMatrix);
+  }
+
+  if (mLocalMatrixNeedsUpdate[nodeNum] || mLocalMatrices[nodeNum] != localMatrix) {
+    mLocalMatrices[nodeNum] = localMatrix;
+    mLocalMatrixNeedsUpdate[nodeNum] = false;
+    mNodeMatrixNeedsUpdate[nodeNum] = true;
+  }
+}
+
+void GltfSkeleton::markLocalMatrix(int nodeNum) {
+  mLocalMatrixNeedsUpdate[nodeNum] = true;
+  mNodeMatrixNeedsUpdate[nodeNum] = true;
+}
+
+glm::vec3 GltfSkeleton::getLocalTranslation(int nodeNum) {
+  return mBlendTranslations.at(nodeNum);
+}
+
+glm::quat GltfSkeleton::getLocalRotation(int nodeNum) {
+  return mBlendRotations.at(nodeNum);
+}
+
+glm::vec3 GltfSkeleton::getLocalScale(int nodeNum) {
+  return mBlendScales.at(nodeNum);
+}
+
+void GltfSkeleton::setWorldPosition(glm::vec3 worldPos) {
+  mWorldPosition = worldPos;
+  mWorldTranslationMatrix = glm::translate(glm::mat4(1.0f), mWorldPosition);
+  mWorldTRMatrix = mWorldTranslationMatrix * mWorldRotationMatrix;
+  mWorldTransform = glm::mat4x3(mWorldTRMatrix);
+  const std::vector<int> &parentNodes = mTopology->getParentNodes();
+  for (const auto nodeNum : mTopology->getNodeOrder()) {
+    if (parentNodes[nodeNum] < 0) {
+      markLocalMatrix(nodeNum);
+    }
+  }
+}
+
+void GltfSkeleton::setWorldRotation(glm::vec3 worldRot) {
+  mWorldRotation = worldRot;
+  mWorldRotationQuat = glm::quat(glm::vec3(
+    glm::radians(mWorldRotation.x),
+    glm::radians(mWorldRotation.y),
+    glm::radians(mWorldRotation.z)
+  ));
+  mWorldRotationMatrix = glm::mat4_cast(mWorldRotationQuat);
+  mWorldTRMatrix = mWorldTranslationMatrix * mWorldRotationMatrix;
+  mWorldTransform = glm::mat4x3(mWorldTRMatrix);
+  const std::vector<int> &parentNodes = mTopology->getParentNodes();
+  for (const auto nodeNum : mTopology->getNodeOrder()) {
+    if (parentNodes[nodeNum] < 0) {
+      markLocalMatrix(nodeNum);
+    }
+  }
+}
+
+glm::mat4 GltfSkeleton::getWorldTRMatrix() {
+  return mWorldTRMatrix;
+}
+
+void GltfSkeleton::updateLocalMatrix(int nodeNum, int parentNodeNum) {
+  glm::mat4x3 trsMatrix = AffineTransform::fromTRS(mBlendTranslations[nodeNum],
+    mBlendRotations[nodeNum], mBlendScales[nodeNum]);
+
+  if (parentNodeNum < 0) {
+    mLocalMatrices[nodeNum] = AffineTransform::multiply(mWorldTransform, trsMatrix);
+  } else {
+    mLocalMatrices[nodeNum] = trsMatrix;
+  }
+  mLocalMatrixNeedsUpdate[nodeNum] = false;
+}
+
+void GltfSkeleton::updateNodeMatrix(int nodeNum, int parentNodeNum) {
+  /* the parent is always updated before the node */
+  if (!mNodeMatrixNeedsUpdate[nodeNum] &&
+      (parentNodeNum < 0 || mNodeMatrixUpdates[parentNodeNum] != mUpdateNumber)) {
+    return;
+  }
+
+  if (mLocalMatrixNeedsUpdate[nodeNum]) {
+    updateLocalMatrix(nodeNum, parentNodeNum);
+  }
+
+  if (parentNodeNum < 0) {
+    mNodeMatrices[nodeNum] = mLocalMatrices[nodeNum];
+  } else {
+    mNodeMatrices[nodeNum] = AffineTransform::multiply(mNodeMatrices[parentNodeNum],
+      mLocalMatrices[nodeNum]);
+  }
+  if (mDualQuatTransforms) {
+    updateNodeTransform(nodeNum, parentNodeNum);
+  }
+  mNodeMatrixNeedsUpdate[nodeNum] = false;
+  mNodeMatrixUpdates[nodeNum] = mUpdateNumber;
+  ++mUpdatedNodeCount;
+}
+
+void GltfSkeleton::updateNodeTransform(int nodeNum, int parentNodeNum) {
+  glm::quat rotation = mBlendRotations[nodeNum];
+  glm::vec3 translation = mBlendTranslations[nodeNum];
+  glm::vec3 scale = mBlendScales[nodeNum];
+
+  /* the world transform has no scale */
+  glm::quat parentRotation = mWorldRotationQuat;
+  glm::vec3 parentTranslation = mWorldPosition;
+  float parentScale = 1.0f;
+  if (parentNodeNum >= 0) {
+    parentRotation = mNodeRotations[parentNodeNum];
+    parentTranslation = mNodeTranslations[parentNodeNum];
+    parentScale = mNodeScales[parentNodeNum];
+  }
+
+  mNodeRotations[nodeNum] = parentRotation * rotation;
+  mNodeTranslations[nodeNum] = parentTranslation + parentScale * (parentRotation * translation);
+  mNodeScales[nodeNum] = parentScale * (scale.x + scale.y + scale.z) / 3.0f;
+}
+
+void GltfSkeleton::updateNodeMatrices() {
+  ++mUpdateNumber;
+  const std::vector<int> &parentNodes = mTopology->getParentNodes();
+  for (const auto nodeNum : mTopology->getNodeOrder()) {
+    updateNodeMatrix(nodeNum, parentNodes[nodeNum]);
+  }
+}
+
+void GltfSkeleton::updateNodeMatrices(const std::vector<bool> &nodeMask) {
+  ++mUpdateNumber;
+  const std::vector<int> &parentNodes = mTopology->getParentNodes();
+  for (const auto nodeNum : mTopology->getNodeOrder()) {
+    int parentNodeNum = parentNodes[nodeNum];
+    if (nodeMask[nodeNum]) {
+      updateNodeMatrix(nodeNum, parentNodeNum);
+    } else if (parentNodeNum >= 0 && mNodeMatrixUpdates[parentNodeNum] == mUpdateNumber) {
+      /* the matrix keeps the old value, but the joints of the node must follow the parent */
+      mNodeMatrixUpdates[nodeNum] = mUpdateNumber;
+    }
+  }
+}
+
+void GltfSkeleton::updateSubtreeMatrices(int nodeNum) {
+  ++mUpdateNumber;
+  const std::vector<int> &nodeOrder = mTopology->getNodeOrder();
+  const std::vector<int> &parentNodes = mTopology->getParentNodes();
+  int first = mTopology->getOrderIndex(nodeNum);
+  int last = first + mTopology->getSubtreeSize(nodeNum);
+  for (int i = first; i < last; ++i) {
+    updateNodeMatrix(nodeOrder[i], parentNodes[nodeOrder[i]]);
+  }
+}
+
+void GltfSkeleton::setDualQuatTransforms(bool enabled) {
+  if (enabled == mDualQuatTransforms) {
+    return;
+  }
+  mDualQuatTransforms = enabled;
+
+  /* the transforms of all nodes are missing or outdated */
+  if (mDualQuatTransforms) {
+    int nodeCount = mTopology->getNodeCount();
+    mNodeRotations.resize(nodeCount);
+    mNodeTranslations.resize(nodeCount);
+    mNodeScales.resize(nodeCount);
+    invalidateNodeMatrices();
+  }
+}
+
+const std::vector<glm::quat> &GltfSkeleton::getNodeRotations() {
+  return mNodeRotations;
+}
+
+const std::vector<glm::vec3> &GltfSkeleton::getNodeTranslations() {
+  return mNodeTranslations;
+}
+
+const std::vector<float> &GltfSkeleton::getNodeScales() {
+  return mNodeScales;
+}
+
+void GltfSkeleton::invalidateNodeMatrices() {
+  std::fill(mNodeMatrixNeedsUpdate.begin(), mNodeMatrixNeedsUpdate.end(), true);
+}
+
+unsigned int GltfSkeleton::getUpdateNumber() {
+  return mUpdateNumber;
+}
+
+const std::vector<unsigned int> &GltfSkeleton::getNodeMatrixUpdates() {
+  return mNodeMatrixUpdates;
+}
+
+int GltfSkeleton::getUpdatedNodeCount() {
+  return mUpdatedNodeCount;
+}
+
+void GltfSkeleton::resetUpdatedNodeCount() {
+  mUpdatedNodeCount = 0;
+}
+
+glm::mat4 GltfSkeleton::getNodeMatrix(int nodeNum) {
+  return glm::mat4(mNodeMatrices.at(nodeNum));
+}
+
+const std::vector<glm::mat4x3> &GltfSkeleton::getNodeMatrices() {
+  return mNodeMatrices;
+}
+
+glm::quat GltfSkeleton::getGlobalRotation(int nodeNum) {
+  if (mGlobalRotationUpdates.at(nodeNum) != mNodeMatrixUpdates.at(nodeNum)) {
+    /* orthonormalized columns like glm::decompose(), without the scale, skew and
+     * perspective results. inverted like the result of the decompose path */
+    const glm::mat4x3 &nodeMatrix = mNodeMatrices.at(nodeNum);
+    glm::vec3 xAxis = glm::normalize(nodeMatrix[0]);
+    glm::vec3 yAxis = glm::normalize(nodeMatrix[1] - xAxis * glm::dot(xAxis, nodeMatrix[1]));
+    glm::vec3 zAxis = nodeMatrix[2] - xAxis * glm::dot(xAxis, nodeMatrix[2]);
+    zAxis = glm::normalize(zAxis - yAxis * glm::dot(yAxis, zAxis));
+    mGlobalRotations.at(nodeNum) = glm::conjugate(glm::quat_cast(glm::mat3(xAxis, yAxis,
+      zAxis)));
+    mGlobalRotationUpdates.at(nodeNum) = mNodeMatrixUpdates.at(nodeNum);
+  }
+
+  if (!mDecomposeValidation) {
+    return mGlobalRotations.at(nodeNum);
+  }
+
+  glm::vec3 translation;
+  glm::quat rotation;
+  if (!decomposeNodeMatrix(nodeNum, translation, rotation)) {
+    return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  }
+
+  glm::quat diff = glm::conjugate(mGlobalRotations.at(nodeNum)) * rotation;
+  float angle = 2.0f * std::atan2(glm::length(glm::vec3(diff.x, diff.y, diff.z)),
+    std::fabs(diff.w));
+  if (angle > mValidationThreshold) {
+    Logger::log(1, "%s error: rotation of node %i differs by %f from decompose\n",
+      __FUNCTION__, nodeNum, angle);
+  }
+  return rotation;
+}
+
+glm::vec3 GltfSkeleton::getGlobalPosition(int nodeNum) {
+  if (!mDecomposeValidation) {
+    return mNodeMatrices.at(nodeNum)[3];
+  }
+
+  glm::vec3 translation;
+  glm::quat rotation;
+  if (!decomposeNodeMatrix(nodeNum, translation, rotation)) {
+    return glm::vec3(0.0f, 0.0f, 0.0f);
+  }
+
+  float distance = glm::length(translation - mNodeMatrices.at(nodeNum)[3]);
+  if (distance > mValidationThreshold) {
+    Logger::log(1, "%s error: position of node %i differs by %f from decompose\n",
+      __FUNCTION__, nodeNum, distance);
+  }
+  return translation;
+}
+
+bool GltfSkeleton::decomposeNodeMatrix(int nodeNum, glm::vec3 &translation,
+    glm::quat &rotation) {
+  glm::quat orientation;
+  glm::vec3 scale;
+  glm::vec3 skew;
+  glm::vec4 perspective;
+
+  if (!glm::decompose(getNodeMatrix(nodeNum), scale, orientation, translation, skew,
+      perspective)) {
+    Logger::log(1, "%s error: could not decompose matrix for node %i\n", __FUNCTION__,
+      nodeNum);
+    return false;
+  }
+
+  rotation = glm::inverse(orientation);
+  return true;
+}
+
+void GltfSkeleton::setDecomposeValidation(bool enabled) {
+  mDecomposeValidation = enabled;
+}
+
+bool GltfSkeleton::getDecomposeValidation() {
+  return mDecomposeValidation;
+}
+
+void GltfSkeleton::printTree() {
+  Logger::log(1, "%s: ---- tree ----\n", __FUNCTION__);
+  for (const auto nodeNum : mTopology->getNodeOrder()) {
+    int depth = 0;
+    for (int parent = mTopology->getParentNodeNum(nodeNum); parent >= 0;
+        parent = mTopology->getParentNodeNum(parent)) {
+      ++depth;
+    }
+    std::string indentString(depth, ' ');
+    Logger::log(1, "%s: %s- node : %i (%s)\n", __FUNCTION__, indentString.c_str(), nodeNum,
+      mTopology->getNodeName(nodeNum).c_str());
+  }
+  Logger::log(1, "%s: -- end tree --\n", __FUNCTION__);
+}
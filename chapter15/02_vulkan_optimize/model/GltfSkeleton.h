@@ -0,0 +1,153 @@
+/* pose of a flat glTF node hierarchy, all arrays are indexed by the glTF node number */
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "GltfSkeletonTopology.h"
+#include "AffineTransform.h"
+#include "PoseBuffer.h"
+
+class GltfSkeleton {
+  public:
+    /* sets all nodes to the bind pose */
+    void setTopology(std::shared_ptr<GltfSkeletonTopology> topology);
+    std::shared_ptr<GltfSkeletonTopology> getTopology();
+    void resetPose();
+
+    int getNodeCount();
+    bool hasNode(int nodeNum);
+    int getRootNodeNum();
+    int getParentNodeNum(int nodeNum);
+    std::vector<int> getChildNodeNums(int nodeNum);
+    std::string getNodeName(int nodeNum);
+
+    /* the nodes of a subtree are stored in a row, starting with the subtree root */
+    const std::vector<int> &getNodeOrder();
+    int getOrderIndex(int nodeNum);
+    int getSubtreeSize(int nodeNum);
+
+    int getJointCount();
+    const std::vector<int> &getNodeToJoint();
+    const std::vector<glm::mat4x3> &getInverseBindMatrices();
+    const std::vector<glm::quat> &getInverseBindRotations();
+    const std::vector<glm::vec3> &getInverseBindTranslations();
+
+    /* the set values are also the start values of blending. nodes are only marked for the
+     * next matrix update if the resulting value changes */
+    void setTranslation(int nodeNum, glm::vec3 translation);
+    void setRotation(int nodeNum, glm::quat rotation);
+    void setScale(int nodeNum, glm::vec3 scale);
+
+    void blendTranslation(int nodeNum, glm::vec3 translation, float blendFactor);
+    void blendRotation(int nodeNum, glm::quat rotation, float blendFactor);
+    void blendScale(int nodeNum, glm::vec3 scale, float blendFactor);
+
+    /* start values of blending for all nodes, nothing is marked as written */
+    void getBasePose(PoseBuffer &pose);
+    /* the written properties are the new local transforms, the start values are kept */
+    void applyPose(const PoseBuffer &pose);
+
+    /* batch evaluation, trsMatrix is T * R * S without the world transform */
+    void setLocalTRS(int nodeNum, glm::vec3 translation, glm::quat rotation, glm::vec3 scale,
+      const glm::mat4x3 &trsMatrix);
+
+    glm::vec3 getLocalTranslation(int nodeNum);
+    glm::quat getLocalRotation(int nodeNum);
+    glm::vec3 getLocalScale(int nodeNum);
+
+    /* transform of the root node, used by the next update of the node matrices */
+    void setWorldPosition(glm::vec3 worldPos);
+    void setWorldRotation(glm::vec3 worldRot);
+    glm::mat4 getWorldTRMatrix();
+
+    /* single run over the node order, only nodes with a changed local matrix or parent are
+     * recomputed. nodes outside of nodeMask keep their matrices */
+    void updateNodeMatrices();
+    void updateNodeMatrices(const std::vector<bool> &nodeMask);
+    /* the node and all nodes below */
+    void updateSubtreeMatrices(int nodeNum);
+    /* recompute all nodes on the next update */
+    void invalidateNodeMatrices();
+
+    /* every update run gets a new number, a node stores the number of the last run that
+     * changed its matrix */
+    unsigned int getUpdateNumber();
+    const std::vector<unsigned int> &getNodeMatrixUpdates();
+    /* nodes recomputed since the last reset */
+    int getUpdatedNodeCount();
+    void resetUpdatedNodeCount();
+
+    /* global rotation, translation and uniform scale of the nodes, composed like the node
+     * matrices for dual quaternion skinning. only calculated while enabled, non-uniform
+     * scales are reduced to their mean */
+    void setDualQuatTransforms(bool enabled);
+    const std::vector<glm::quat> &getNodeRotations();
+    const std::vector<glm::vec3> &getNodeTranslations();
+    const std::vector<float> &getNodeScales();
+
+    glm::mat4 getNodeMatrix(int nodeNum);
+    /* affine, see AffineTransform */
+    const std::vector<glm::mat4x3> &getNodeMatrices();
+    /* read from the node matrix, the rotation is extracted once per change of the matrix.
+     * the node matrices must not contain skew */
+    glm::vec3 getGlobalPosition(int nodeNum);
+    glm::quat getGlobalRotation(int nodeNum);
+
+    /* use glm::decompose() for the global position and rotation, and log the differences to
+     * the values read from the node matrix */
+    static void setDecomposeValidation(bool enabled);
+    static bool getDecomposeValidation();
+
+    void printTree();
+
+  private:
+    void markLocalMatrix(int nodeNum);
+    void updateLocalMatrix(int nodeNum, int parentNodeNum);
+    void updateNodeMatrix(int nodeNum, int parentNodeNum);
+    void updateNodeTransform(int nodeNum, int parentNodeNum);
+    bool decomposeNodeMatrix(int nodeNum, glm::vec3 &translation, glm::quat &rotation);
+
+    /* hierarchy, names and bind pose, shared by all instances of the model */
+    std::shared_ptr<GltfSkeletonTopology> mTopology = nullptr;
+
+    std::vector<glm::vec3> mTranslations{};
+    std::vector<glm::quat> mRotations{};
+    std::vector<glm::vec3> mScales{};
+
+    std::vector<glm::vec3> mBlendTranslations{};
+    std::vector<glm::quat> mBlendRotations{};
+    std::vector<glm::vec3> mBlendScales{};
+
+    std::vector<bool> mLocalMatrixNeedsUpdate{};
+    std::vector<bool> mNodeMatrixNeedsUpdate{};
+    /* the root node contains the world transform */
+    std::vector<glm::mat4x3> mLocalMatrices{};
+    std::vector<glm::mat4x3> mNodeMatrices{};
+
+    unsigned int mUpdateNumber = 0;
+    std::vector<unsigned int> mNodeMatrixUpdates{};
+    int mUpdatedNodeCount = 0;
+
+    bool mDualQuatTransforms = false;
+    std::vector<glm::quat> mNodeRotations{};
+    std::vector<glm::vec3> mNodeTranslations{};
+    std::vector<float> mNodeScales{};
+
+    /* valid while the update number of the node matrix is the same */
+    std::vector<glm::quat> mGlobalRotations{};
+    std::vector<unsigned int> mGlobalRotationUpdates{};
+
+    static bool mDecomposeValidation;
+    static constexpr float mValidationThreshold = 0.001f;
+
+    glm::vec3 mWorldPosition = glm::vec3(0.0f);
+    glm::vec3 mWorldRotation = glm::vec3(0.0f);
+    glm::mat4 mWorldTranslationMatrix = glm::mat4(1.0f);
+    glm::mat4 mWorldRotationMatrix = glm::mat4(1.0f);
+    glm::mat4 mWorldTRMatrix = glm::mat4(1.0f);
+    glm::mat4x3 mWorldTransform = glm::mat4x3(1.0f);
+    glm::quat mWorldRotationQuat = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
@@ -0,0 +1,60 @@
+/* immutable part of a glTF skeleton, created once per model and shared by all instances.
+ * all arrays are indexed by the glTF node number */
+#pragma once
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+class GltfSkeletonTopology {
+  public:
+    void setNodeCount(int nodeCount);
+    /* nodes must be added depth first, parents before their children. -1 for a root node */
+    void addNode(int nodeNum, int parentNodeNum, std::string nodeName);
+    /* defaults to the identity transform */
+    void setBindPose(int nodeNum, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+    /* -1 in nodeToJoint for nodes without a joint */
+    void setJoints(std::vector<int> nodeToJoint, std::vector<glm::mat4> inverseBindMatrices);
+
+    int getNodeCount();
+    bool hasNode(int nodeNum);
+    int getRootNodeNum();
+    int getParentNodeNum(int nodeNum);
+    std::vector<int> getChildNodeNums(int nodeNum);
+    std::string getNodeName(int nodeNum);
+
+    /* the nodes of a subtree are stored in a row, starting with the subtree root */
+    const std::vector<int> &getNodeOrder();
+    const std::vector<int> &getParentNodes();
+    int getOrderIndex(int nodeNum);
+    int getSubtreeSize(int nodeNum);
+
+    const std::vector<glm::vec3> &getBindTranslations();
+    const std::vector<glm::quat> &getBindRotations();
+    const std::vector<glm::vec3> &getBindScales();
+
+    int getJointCount();
+    const std::vector<int> &getNodeToJoint();
+    /* affine, see AffineTransform */
+    const std::vector<glm::mat4x3> &getInverseBindMatrices();
+    /* rotation and translation of the inverse bind matrices, for dual quaternion skinning */
+    const std::vector<glm::quat> &getInverseBindRotations();
+    const std::vector<glm::vec3> &getInverseBindTranslations();
+
+  private:
+    std::vector<int> mParentNodes{};
+    std::vector<int> mNodeOrder{};
+    std::vector<int> mOrderIndices{};
+    /* number of nodes in the subtree, including the node itself */
+    std::vector<int> mSubtreeSizes{};
+    std::vector<std::string> mNodeNames{};
+
+    std::vector<glm::vec3> mBindTranslations{};
+    std::vector<glm::quat> mBindRotations{};
+    std::vector<glm::vec3> mBindScales{};
+
+    std::vector<int> mNodeToJoint{};
+    std::vector<glm::mat4x3> mInverseBindMatrices{};
+    std::vector<glm::quat> mInverseBindRotations{};
+    std::vector<glm::vec3> mInverseBindTranslations{};
+};
@@ -11,37 +11,35 @@ void IKSolver::setNumIterations(unsigned int iterations) {
   mIterations = iterations;
 }
 
-void IKSolver::setNodes(std::vector<std::shared_ptr<GltfNode>> nodes) {
+void IKSolver::setNodes(GltfSkeleton &skeleton, std::vector<int> nodes) {
   mNodes = nodes;
-  for (const auto &node : mNodes) {
-    if (node) {
-      Logger::log(2, "%s: added node %s to IK solver\n", __FUNCTION__,
-        node->getNodeName().c_str());
-    }
+  for (const auto node : mNodes) {
+    Logger::log(2, "%s: added node %s to IK solver\n", __FUNCTION__,
+      skeleton.getNodeName(node).c_str());
   }
-  calculateBoneLengths();
+  calculateBoneLengths(skeleton);
   mFABRIKNodePositions.resize(mNodes.size());
 }
 
-void IKSolver::calculateBoneLengths() {
+void IKSolver::calculateBoneLengths(GltfSkeleton &skeleton) {
   mBoneLengths.resize(mNodes.size() - 1);
   for (int i = 0; i < mNodes.size() - 1; ++i) {
-    std::shared_ptr<GltfNode> startNode = mNodes.at(i);
-    std::shared_ptr<GltfNode> endNode = mNodes.at(i + 1);
+    int startNode = mNodes.at(i);
+    int endNode = mNodes.at(i + 1);
 
-    glm::vec3 startNodePos = startNode->getGlobalPosition();
-    glm::vec3 endNodePos = endNode->getGlobalPosition();
+    glm::vec3 startNodePos = skeleton.getGlobalPosition(startNode);
+    glm::vec3 endNodePos = skeleton.getGlobalPosition(endNode);
 
     mBoneLengths.at(i) = glm::length(endNodePos - startNodePos);
     Logger::log(2, "%s: bone %i has length %f\n", __FUNCTION__, i, mBoneLengths.at(i));
   }
 }
 
-std::shared_ptr<GltfNode> IKSolver::getIkChainRootNode() {
+int IKSolver::getIkChainRootNode() {
   return mNodes.at(mNodes.size() - 1);
 }
 
-bool IKSolver::solveCCD(const glm::vec3 target) {
+bool IKSolver::solveCCD(GltfSkeleton &skeleton, const glm::vec3 target) {
   /* no nodes, no solving possible */
   if (!mNodes.size()) {
     return false;
@@ -49,22 +47,22 @@ bool IKSolver::solveCCD(const glm::vec3 target) {
 
   for (unsigned int i = 0; i < mIterations; ++i) {
     /* we are really close to the target, stop iterations */
-    glm::vec3 effector = mNodes.at(0)->getGlobalPosition();
+    glm::vec3 effector = skeleton.getGlobalPosition(mNodes.at(0));
     if (glm::length(target - effector) < mThreshold) {
       return true;
     }
 
     /* iterate the IK chain from node after effector to the root node */
     for (size_t j = 1; j < mNodes.size(); ++j) {
-      std::shared_ptr<GltfNode> node = mNodes.at(j);
-      if (!node) {
+      int node = mNodes.at(j);
+      if (!skeleton.hasNode(node)) {
         Logger::log(1, "%s error: node at pos %i is invalid, skipping\n", __FUNCTION__, j);
         continue;
       }
 
       /* get the global position and rotation of the node, NOT the local */
-      glm::vec3 position = node->getGlobalPosition();
-      glm::quat rotation = node->getGlobalRotation();
+      glm::vec3 position = skeleton.getGlobalPosition(node);
+      glm::quat rotation = skeleton.getGlobalRotation(node);
 
       /* create normalized vec3 from current world position to:
        * - effector
@@ -79,15 +77,15 @@ bool IKSolver::solveCCD(const glm::vec3 target) {
       glm::quat localRotation = rotation * effectorToTarget * glm::conjugate(rotation);
 
       /* rotate the node LOCALLY around the old plus the new rotation */
-      glm::quat currentRotation = node->getLocalRotation();
-      node->blendRotation(currentRotation * localRotation, 1.0f);
+      glm::quat currentRotation = skeleton.getLocalRotation(node);
+      skeleton.blendRotation(node, currentRotation * localRotation, 1.0f);
 
       /* update the node matrices, current node to effector
          to reflect the local changes down the chain */
-      node->updateNodeAndChildMatrices();
+      skeleton.updateSubtreeMatrices(node);
 
       /* evaluate effector at the end of every iteration again */
-      effector = mNodes.at(0)->getGlobalPosition();
+      effector = skeleton.getGlobalPosition(mNodes.at(0));
       if (glm::length(target - effector) < mThreshold) {
         return true;
       }
@@ -126,17 +124,17 @@ void IKSolver::solveFABRIKBackward(glm::vec3 base) {
 }
 
 /* we need to ROTATE the bones, starting with the root node */
-void IKSolver::adjustFABRIKNodes() {
+void IKSolver::adjustFABRIKNodes(GltfSkeleton &skeleton) {
   for (size_t i = mFABRIKNodePositions.size() - 1; i > 0; --i) {
-    std::shared_ptr<GltfNode> node = mNodes.at(i);
-    std::shared_ptr<GltfNode> nextNode = mNodes.at(i - 1);
+    int node = mNodes.at(i);
+    int nextNode = mNodes.at(i - 1);
 
     /* get the global position and rotation of the original nodes */
-    glm::vec3 position = node->getGlobalPosition();
-    glm::quat rotation = node->getGlobalRotation();
+    glm::vec3 position = skeleton.getGlobalPosition(node);
+    glm::quat rotation = skeleton.getGlobalRotation(node);
 
     /* calculate the vector of the original node direction */
-    glm::vec3 nextPosition = nextNode->getGlobalPosition();
+    glm::vec3 nextPosition = skeleton.getGlobalPosition(nextNode);
     glm::vec3 toNext = glm::normalize(nextPosition - position);
 
     /* calculate the vector of the changed node direction */
@@ -150,16 +148,16 @@ void IKSolver::adjustFABRIKNodes() {
     glm::quat localRotation = rotation * nodeRotation * glm::conjugate(rotation);
 
     /* rotate the node around the old plus the new rotation */
-    glm::quat currentRotation = node->getLocalRotation();
-    node->blendRotation(currentRotation * localRotation, 1.0f);
+    glm::quat currentRotation = skeleton.getLocalRotation(node);
+    skeleton.blendRotation(node, currentRotation * localRotation, 1.0f);
 
     /* update the node matrices, current node to effector
        to reflect the local changes down the chain */
-    node->updateNodeAndChildMatrices();
+    skeleton.updateSubtreeMatrices(node);
   }
 }
 
-bool IKSolver::solveFABRIK(glm::vec3 target) {
+bool IKSolver::solveFABRIK(GltfSkeleton &skeleton, glm::vec3 target) {
   /* no nodes, no solving possible */
   if (!mNodes.size()) {
     return false;
@@ -167,18 +165,17 @@ bool IKSolver::solveFABRIK(glm::vec3 target) {
 
   /* copy node positions, we will work on the copy */
   for (size_t i = 0; i < mNodes.size(); ++i) {
-    std::shared_ptr<GltfNode> node = mNodes.at(i);
-    mFABRIKNodePositions.at(i) = node->getGlobalPosition();
+    mFABRIKNodePositions.at(i) = skeleton.getGlobalPosition(mNodes.at(i));
   }
 
   /* get original root node position before altering the bones */
-  glm::vec3 base = getIkChainRootNode()->getGlobalPosition();
+  glm::vec3 base = skeleton.getGlobalPosition(getIkChainRootNode());
 
   for (unsigned int i = 0; i < mIterations; ++i) {
     /* we are really close to the target, stop iterations */
     glm::vec3 effector = mFABRIKNodePositions.at(0);
     if (glm::length(target - effector) < mThreshold) {
-      adjustFABRIKNodes();
+      adjustFABRIKNodes(skeleton);
       return true;
     }
 
@@ -187,10 +184,10 @@ bool IKSolver::solveFABRIK(glm::vec3 target) {
     solveFABRIKBackward(base);
   }
 
-  adjustFABRIKNodes();
+  adjustFABRIKNodes(skeleton);
 
   /* return true if we are close to the target */
-  glm::vec3 effector = mNodes.at(0)->getGlobalPosition();
+  glm::vec3 effector = skeleton.getGlobalPosition(mNodes.at(0));
   if (glm::length(target - effector) < mThreshold) {
     return true;
   }
@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "LayeredBlend.h"
+#include "PoseArena.h"
+
+void LayeredBlend::evaluate(const std::vector<AnimationLayer> &layers,
+    const PoseBuffer &basePose, const std::vector<bool> &nodeMask, PoseBuffer &result) {
+  int layerCount = layers.size();
+  PoseArena &arena = PoseArena::getThreadArena();
+  size_t arenaMark = arena.getMark();
+
+  /* one run over the tracks of every clip */
+  PoseBuffer *layerPoses = arena.allocate<PoseBuffer>(layerCount);
+  for (int i = 0; i < layerCount; ++i) {
+    const AnimationLayer &layer = layers[i];
+    layerPoses[i] = arena.allocatePose(result.nodeCount);
+    layer.clip->samplePose(layerPoses[i], layer.trackMask, layer.time, *layer.keyCursors);
+  }
+
+  /* and one run over the nodes for all layers */
+  for (int node = 0; node < result.nodeCount; ++node) {
+    if (!nodeMask[node]) {
+      result.written[node] = 0;
+      continue;
+    }
+    glm::vec3 translation = basePose.translations[node];
+    glm::quat rotation = basePose.rotations[node];
+    glm::vec3 scale = basePose.scales[node];
+    unsigned char written = 0;
+
+    for (int i = 0; i < layerCount; ++i) {
+      const AnimationLayer &layer = layers[i];
+      const PoseBuffer &layerPose = layerPoses[i];
+      unsigned char layerWritten = layerPose.written[node];
+      written |= layerWritten;
+
+      float weight = layer.weight;
+      if (layer.nodeWeights) {
+        weight *= (*layer.nodeWeights)[node];
+      }
+      weight = std::clamp(weight, 0.0f, 1.0f);
+
+      if (layer.mode == layerMode::override) {
+        /* same calculations as the blend functions of GltfSkeleton */
+        if (layerWritten & PoseBuffer::mTranslationBit) {
+          translation = layerPose.translations[node] * weight + translation * (1.0f - weight);
+        }
+        if (layerWritten & PoseBuffer::mRotationBit) {
+          rotation = glm::slerp(rotation, layerPose.rotations[node], weight);
+        }
+        if (layerWritten & PoseBuffer::mScaleBit) {
+          scale = layerPose.scales[node] * weight + scale * (1.0f - weight);
+        }
+        continue;
+      }
+
+      if (layerWritten & PoseBuffer::mTranslationBit) {
+        translation += (layerPose.translations[node] - basePose.translations[node]) * weight;
+      }
+      if (layerWritten & PoseBuffer::mRotationBit) {
+        glm::quat delta = glm::inverse(basePose.rotations[node]) * layerPose.rotations[node];
+        rotation = rotation * glm::slerp(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), delta, weight);
+      }
+      if (layerWritten & PoseBuffer::mScaleBit) {
+        scale = scale * glm::mix(glm::vec3(1.0f),
+          layerPose.scales[node] / basePose.scales[node], weight);
+      }
+    }
+
+    result.translations[node] = translation;
+    result.rotations[node] = rotation;
+    result.scales[node] = scale;
+    result.written[node] = written;
+  }
+
+  arena.release(arenaMark);
+}
@@ -0,0 +1,22 @@
+/* settings applied while loading a glTF model */
+#pragma once
+struct ModelLoadSettings {
+  /* remove LINEAR keys the remaining keys can interpolate within the tolerance */
+  bool mlsReduceKeyframes = false;
+  /* radians, model units, and the scale factor without a unit */
+  float mlsReduceAngleTolerance = 0.001f;
+  float mlsReducePositionTolerance = 0.001f;
+  float mlsReduceScaleTolerance = 0.001f;
+
+  /* sample all clips at a fixed rate, replaces the key search by an index calculation */
+  bool mlsResampleAnimations = false;
+  float mlsResampleRate = 30.0f;
+
+  /* store key times and values as 16 bit integers, tracks over the error budget stay float */
+  bool mlsCompressAnimations = false;
+  /* maximum error at the keys, in seconds, radians, and model units */
+  float mlsMaxTimeError = 0.00001f;
+  float mlsMaxRotationError = 0.001f;
+  float mlsMaxTranslationError = 0.001f;
+  float mlsMaxScaleError = 0.001f;
+};
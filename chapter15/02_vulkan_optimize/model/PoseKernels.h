@@ -0,0 +1,41 @@
+/* SIMD kernels for the batch pose evaluation, one lane per instance */
+#pragma once
+#include <string>
+
+enum class ESimdLevel {
+  SCALAR = 0,
+  SSE,
+  AVX2
+};
+
+/* all values are stored as structure of arrays, with 'stride' floats per component:
+ * x of all lanes, then y of all lanes, and so on. quaternions use the glTF order x, y, z, w.
+ * the stride must be a multiple of mLaneAlignment, the padding lanes are calculated too */
+class PoseKernels {
+  public:
+    static ESimdLevel getSupportedLevel();
+    static ESimdLevel getSimdLevel();
+    /* clamped to the supported level, SCALAR is always possible */
+    static void setSimdLevel(ESimdLevel level);
+    static std::string getSimdLevelName(ESimdLevel level);
+
+    static int getPaddedLaneCount(int laneCount);
+
+    static void lerpVec3(const float *prev, const float *next, const float *factor,
+      float *result, int stride);
+    static void nlerpQuat(const float *prev, const float *next, const float *factor,
+      float *result, int stride);
+    /* polynomial slerp, see comment in the implementation */
+    static void slerpQuat(const float *prev, const float *next, const float *factor,
+      float *result, int stride);
+
+    /* T * R * S as column major matrix, 12 components as the last row is always (0, 0, 0, 1) */
+    static void composeTRS(const float *translation, const float *rotation, const float *scale,
+      float *matrices, int stride);
+
+    static const int mLaneAlignment = 8;
+
+  private:
+    static ESimdLevel detectSimdLevel();
+    static ESimdLevel mSimdLevel;
+};
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadPool.h"
+#include "Logger.h"
+
+ThreadPool::ThreadPool() {
+  mQueues.emplace_back(std::make_unique<TaskQueue>());
+  mTaskTimes.assign(1, 0.0f);
+  setThreadCount(getMaxThreadCount());
+}
+
+ThreadPool::~ThreadPool() {
+  stopWorkers();
+}
+
+void ThreadPool::setThreadCount(int threadCount) {
+  threadCount = std::max(1, threadCount);
+  if (threadCount == getThreadCount()) {
+    return;
+  }
+
+  stopWorkers();
+  mQueues.resize(1);
+  for (int i = 1; i < threadCount; ++i) {
+    mQueues.emplace_back(std::make_unique<TaskQueue>());
+    mWorkers.emplace_back(&ThreadPool::workerLoop, this, i, mRunNumber);
+  }
+  resetUtilization();
+  Logger::log(1, "%s: using %i threads\n", __FUNCTION__, threadCount);
+}
+
+int ThreadPool::getThreadCount() {
+  return mWorkers.size() + 1;
+}
+
+int ThreadPool::getMaxThreadCount() {
+  /* may be 0 if unknown */
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::run(TaskGraph &graph) {
+  if (graph.getTaskCount() == 0) {
+    return;
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+  if (mWorkers.empty()) {
+    graph.runSerial();
+    float runTime = std::chrono::duration<float, std::milli>(
+      std::chrono::steady_clock::now() - startTime).count();
+    mTaskTimes.at(0) += runTime;
+    mRunTime += runTime;
+    return;
+  }
+
+  /* the tasks without dependencies are spread over all threads */
+  graph.prepare(mReadyTasks);
+  for (int i = 0; i < mReadyTasks.size(); ++i) {
+    mQueues.at(i % mQueues.size())->tasks.push_back(mReadyTasks.at(i));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mGraph = &graph;
+    mOpenTasks = graph.getTaskCount();
+    mBusyWorkers = mWorkers.size();
+    ++mRunNumber;
+  }
+  mWorkCondition.notify_all();
+
+  runTasks(0);
+
+  /* the graph must stay valid until all workers are done */
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDoneCondition.wait(lock, [this] { return mBusyWorkers == 0; });
+  mGraph = nullptr;
+
+  mRunTime += std::chrono::duration<float, std::milli>(
+    std::chrono::steady_clock::now() - startTime).count();
+}
+
+void ThreadPool::parallelFor(int count, std::function<void(int, int)> func) {
+  if (count <= 0) {
+    return;
+  }
+  if (mWorkers.empty() || count == 1) {
+    func(0, count);
+    return;
+  }
+
+  int chunkCount = getThreadCount() * mChunksPerThread;
+  int chunkSize = std::max(1, (count + chunkCount - 1) / chunkCount);
+
+  mLoopGraph.clear();
+  for (int first = 0; first < count; first += chunkSize) {
+    int last = std::min(first + chunkSize, count);
+    mLoopGraph.addTask([&func, first, last]() { func(first, last); });
+  }
+  run(mLoopGraph);
+}
+
+std::vector<float> ThreadPool::getUtilization() {
+  std::vector<float> utilization(mTaskTimes.size(), 0.0f);
+  if (mRunTime > 0.0f) {
+    for (int i = 0; i < mTaskTimes.size(); ++i) {
+      utilization.at(i) = std::min(mTaskTimes.at(i) / mRunTime * 100.0f, 100.0f);
+    }
+  }
+  return utilization;
+}
+
+void ThreadPool::resetUtilization() {
+  mTaskTimes.assign(getThreadCount(), 0.0f);
+  mRunTime = 0.0f;
+}
+
+void ThreadPool::runTasks(int threadNum) {
+  float taskTime = 0.0f;
+  int taskNum = 0;
+  while (mOpenTasks > 0) {
+    if (!getTask(threadNum, taskNum)) {
+      /* the remaining tasks wait for dependencies or run on other threads */
+      std::this_thread::yield();
+      continue;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    mGraph->runTask(taskNum);
+    taskTime += std::chrono::duration<float, std::milli>(
+      std::chrono::steady_clock::now() - startTime).count();
+
+    /* dependent tasks stay on this thread, the data is still in the cache */
+    mGraph->releaseDependents(taskNum, [&](int readyTaskNum) {
+      pushTask(threadNum, readyTaskNum);
+    });
+    --mOpenTasks;
+  }
+  mTaskTimes.at(threadNum) += taskTime;
+}
+
+bool ThreadPool::getTask(int threadNum, int &taskNum) {
+  {
+    TaskQueue &queue = *mQueues[threadNum];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.front < queue.tasks.size()) {
+      taskNum = queue.tasks.back();
+      queue.tasks.pop_back();
+      if (queue.front == queue.tasks.size()) {
+        queue.tasks.clear();
+        queue.front = 0;
+      }
+      return true;
+    }
+  }
+
+  for (int i = 1; i < mQueues.size(); ++i) {
+    TaskQueue &queue = *mQueues[(threadNum + i) % mQueues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.front < queue.tasks.size()) {
+      taskNum = queue.tasks[queue.front++];
+      if (queue.front == queue.tasks.size()) {
+        queue.tasks.clear();
+        queue.front = 0;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::pushTask(int threadNum, int taskNum) {
+  TaskQueue &queue = *mQueues[threadNum];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.tasks.push_back(taskNum);
+}
+
+void ThreadPool::workerLoop(int threadNum, unsigned int lastRunNumber) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWorkCondition.wait(lock, [&] {
+        return mStopWorkers || mRunNumber != lastRunNumber;
+      });
+      if (mStopWorkers) {
+        return;
+      }
+      lastRunNumber = mRunNumber;
+    }
+
+    runTasks(threadNum);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      --mBusyWorkers;
+    }
+    mDoneCondition.notify_one();
+  }
+}
+
+void ThreadPool::stopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopWorkers = true;
+  }
+  mWorkCondition.notify_all();
+
+  for (auto &worker : mWorkers) {
+    worker.join();
+  }
+  mWorkers.clear();
+  mStopWorkers = false;
+}
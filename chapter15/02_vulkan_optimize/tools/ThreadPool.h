@@ -0,0 +1,74 @@
+/* fixed pool of worker threads running task graphs, idle threads steal the tasks of others */
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+#include "TaskGraph.h"
+
+class ThreadPool {
+  public:
+    ThreadPool();
+    ~ThreadPool();
+
+    /* the calling thread works too, a count of 1 runs all tasks on the calling thread.
+     * starts with getMaxThreadCount() threads */
+    void setThreadCount(int threadCount);
+    int getThreadCount();
+    static int getMaxThreadCount();
+
+    /* runs all tasks of the graph and returns after the last one is done */
+    void run(TaskGraph &graph);
+
+    /* calls func(first, last) for consecutive ranges of 0 to count - 1 and returns after
+     * all ranges are done. the ranges must not depend on each other */
+    void parallelFor(int count, std::function<void(int, int)> func);
+
+    /* time spent in tasks per thread in percent of the run() time since the last reset,
+     * the calling thread is the first one */
+    std::vector<float> getUtilization();
+    void resetUtilization();
+
+  private:
+    /* a thread takes new tasks from the back, other threads steal from the front. the
+     * vector is cleared when empty and keeps its memory, unlike a deque */
+    struct TaskQueue {
+      std::mutex mutex{};
+      std::vector<int> tasks{};
+      size_t front = 0;
+    };
+
+    /* a new worker waits for the next run after lastRunNumber */
+    void workerLoop(int threadNum, unsigned int lastRunNumber);
+    void runTasks(int threadNum);
+    bool getTask(int threadNum, int &taskNum);
+    void pushTask(int threadNum, int taskNum);
+    void stopWorkers();
+
+    std::vector<std::thread> mWorkers{};
+    /* one queue per thread, including the calling thread */
+    std::vector<std::unique_ptr<TaskQueue>> mQueues{};
+    std::mutex mMutex{};
+    std::condition_variable mWorkCondition{};
+    std::condition_variable mDoneCondition{};
+    bool mStopWorkers = false;
+
+    /* counted up for every run, wakes the workers */
+    unsigned int mRunNumber = 0;
+    int mBusyWorkers = 0;
+
+    TaskGraph *mGraph = nullptr;
+    std::atomic<int> mOpenTasks = 0;
+    std::vector<int> mReadyTasks{};
+
+    std::vector<float> mTaskTimes{};
+    float mRunTime = 0.0f;
+
+    TaskGraph mLoopGraph{};
+    /* more chunks than threads to balance instances with different costs */
+    static const int mChunksPerThread = 4;
+};
@@ -1,10 +1,11 @@
 #include "ShaderStorageBuffer.h"
 #include "Logger.h"
 
+#include <algorithm>
 #include <VkBootstrap.h>
 
 bool ShaderStorageBuffer::init(VkRenderData& renderData, VkShaderStorageBufferData &SSBOData,
-    size_t bufferSize) {
+    size_t bufferSize, bool persistentMap) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = bufferSize;
@@ -12,12 +13,17 @@ bool ShaderStorageBuffer::init(VkRenderData& renderData, VkShaderStorageBufferDa
 
   VmaAllocationCreateInfo vmaAllocInfo{};
   vmaAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+  if (persistentMap) {
+    vmaAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  }
 
+  VmaAllocationInfo allocInfo{};
   if (vmaCreateBuffer(renderData.rdAllocator, &bufferInfo, &vmaAllocInfo,
-    &SSBOData.rdSsboBuffer, &SSBOData.rdSsboBufferAlloc, nullptr) != VK_SUCCESS) {
+    &SSBOData.rdSsboBuffer, &SSBOData.rdSsboBufferAlloc, &allocInfo) != VK_SUCCESS) {
     Logger::log(1, "%s error: could not allocate shader storage buffer via VMA\n", __FUNCTION__);
     return false;
   }
+  SSBOData.rdSsboMappedData = persistentMap ? allocInfo.pMappedData : nullptr;
 
   VkDescriptorSetLayoutBinding ssboBind{};
   ssboBind.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -86,29 +92,60 @@ bool ShaderStorageBuffer::init(VkRenderData& renderData, VkShaderStorageBufferDa
 }
 
 void ShaderStorageBuffer::uploadData(VkRenderData &renderData,
-    VkShaderStorageBufferData &SSBOData, std::vector<glm::mat4> matricesToUpload) {
+    VkShaderStorageBufferData &SSBOData, const std::vector<glm::mat4> &matricesToUpload) {
   if (matricesToUpload.size() == 0) {
     return;
   }
 
+  size_t uploadSize = std::min(SSBOData.rdSsboBufferSize,
+    matricesToUpload.size() * sizeof(glm::mat4));
+
   void* data;
   vmaMapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc, &data);
-  std::memcpy(data, matricesToUpload.data(), SSBOData.rdSsboBufferSize);
+  std::memcpy(data, matricesToUpload.data(), uploadSize);
   vmaUnmapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc);
 }
 
 void ShaderStorageBuffer::uploadData(VkRenderData &renderData,
-    VkShaderStorageBufferData &SSBOData, std::vector<glm::mat2x4> matricesToUpload) {
+    VkShaderStorageBufferData &SSBOData, const std::vector<glm::mat2x4> &matricesToUpload) {
   if (matricesToUpload.size() == 0) {
     return;
   }
 
+  size_t uploadSize = std::min(SSBOData.rdSsboBufferSize,
+    matricesToUpload.size() * sizeof(glm::mat2x4));
+
   void* data;
   vmaMapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc, &data);
-  std::memcpy(data, matricesToUpload.data(), SSBOData.rdSsboBufferSize);
+  std::memcpy(data, matricesToUpload.data(), uploadSize);
   vmaUnmapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc);
 }
 
+void ShaderStorageBuffer::uploadData(VkRenderData &renderData,
+    VkShaderStorageBufferData &SSBOData, const std::vector<BakedInstanceData> &instancesToUpload) {
+  if (instancesToUpload.size() == 0) {
+    return;
+  }
+
+  /* the number of baked instances changes, copy only the valid part */
+  size_t uploadSize = std::min(SSBOData.rdSsboBufferSize,
+    instancesToUpload.size() * sizeof(BakedInstanceData));
+
+  void* data;
+  vmaMapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc, &data);
+  std::memcpy(data, instancesToUpload.data(), uploadSize);
+  vmaUnmapMemory(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc);
+}
+
+void ShaderStorageBuffer::flushMappedData(VkRenderData &renderData,
+    VkShaderStorageBufferData &SSBOData, size_t dataSize) {
+  if (dataSize == 0) {
+    return;
+  }
+  vmaFlushAllocation(renderData.rdAllocator, SSBOData.rdSsboBufferAlloc, 0,
+    std::min(dataSize, SSBOData.rdSsboBufferSize));
+}
+
 void ShaderStorageBuffer::cleanup(VkRenderData& renderData, VkShaderStorageBufferData &SSBOData) {
   vkDestroyDescriptorPool(renderData.rdVkbDevice.device, SSBOData.rdSSBODescriptorPool,
     nullptr);
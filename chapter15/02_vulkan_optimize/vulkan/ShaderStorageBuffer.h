@@ -9,11 +9,17 @@
 
 class ShaderStorageBuffer {
   public:
+    /* a persistently mapped buffer is written via rdSsboMappedData and flushMappedData() */
     static bool init(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData,
-      size_t bufferSize);
+      size_t bufferSize, bool persistentMap = false);
     static void uploadData(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData,
-      std::vector<glm::mat4> matricesToUpload);
+      const std::vector<glm::mat4> &matricesToUpload);
     static void uploadData(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData,
-      std::vector<glm::mat2x4> matricesToUpload);
+      const std::vector<glm::mat2x4> &matricesToUpload);
+    static void uploadData(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData,
+      const std::vector<BakedInstanceData> &instancesToUpload);
+    /* makes the first dataSize bytes visible to the GPU, no-op on coherent memory */
+    static void flushMappedData(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData,
+      size_t dataSize);
     static void cleanup(VkRenderData &renderData, VkShaderStorageBufferData &SSBOData);
 };
@@ -4,11 +4,13 @@
 
 #include "VkRenderData.h"
 #include "ModelSettings.h"
+#include "ModelMetadata.h"
 
 class UserInterface {
   public:
     bool init(VkRenderData& renderData);
-    void createFrame(VkRenderData& renderData, ModelSettings &settings);
+    void createFrame(VkRenderData& renderData, ModelSettings &settings,
+      const ModelMetadata &metadata);
     void render(VkRenderData& renderData);
     void cleanup(VkRenderData& renderData);
 
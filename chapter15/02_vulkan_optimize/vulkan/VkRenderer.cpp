@@ -11,6 +11,8 @@
 #include "VkRenderer.h"
 #include "ModelSettings.h"
 #include "Logger.h"
+#include "AnimationBenchmark.h"
+#include "PoseArena.h"
 
 VkRenderer::VkRenderer(GLFWwindow *window) {
   mRenderData.rdWindow = window;
@@ -80,6 +82,10 @@ bool VkRenderer::init(unsigned int width, unsigned int height) {
     return false;
   }
 
+  if (!createBakedSSBOs()) {
+    return false;
+  }
+
   if (!createVBO()) {
     return false;
   }
@@ -108,6 +114,14 @@ bool VkRenderer::init(unsigned int width, unsigned int height) {
       return false;
   }
 
+  if (!createGltfGPUBakedPipeline()) {
+      return false;
+  }
+
+  if (!createGltfGPUBakedDQPipeline()) {
+      return false;
+  }
+
   if (!createFramebuffer()) {
     return false;
   }
@@ -317,10 +331,11 @@ bool VkRenderer::createUBO() {
 
 bool VkRenderer::createMatrixSSBO() {
   size_t modelJointMatrixBufferSize =
-    mRenderData.rdNumberOfInstances * mGltfInstances.at(0)->getJointMatrixSize() *
+    mRenderData.rdNumberOfInstances * mInstanceManager.getInstance(0)->getJointMatrixSize() *
     sizeof(glm::mat4);
 
-  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdJointMatrixSSBO, modelJointMatrixBufferSize)) {
+  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdJointMatrixSSBO, modelJointMatrixBufferSize,
+      true)) {
     Logger::log(1, "%s error: could not create shader storage buffers\n", __FUNCTION__);
     return false;
   }
@@ -329,10 +344,11 @@ bool VkRenderer::createMatrixSSBO() {
 
 bool VkRenderer::createDQSSBO() {
   size_t modelJointDualQuatBufferSize =
-    mRenderData.rdNumberOfInstances * mGltfInstances.at(0)->getJointDualQuatsSize() *
+    mRenderData.rdNumberOfInstances * mInstanceManager.getInstance(0)->getJointDualQuatsSize() *
     sizeof(glm::mat2x4);
 
-  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdJointDualQuatSSBO, modelJointDualQuatBufferSize)) {
+  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdJointDualQuatSSBO, modelJointDualQuatBufferSize,
+      true)) {
     Logger::log(1, "%s error: could not create shader storage buffers\n", __FUNCTION__);
     return false;
   }
@@ -340,6 +356,42 @@ bool VkRenderer::createDQSSBO() {
   return true;
 }
 
+bool VkRenderer::createBakedSSBOs() {
+  /* all clips for the baked instances, uploaded only once */
+  if (!mBakedAnimations.bake(mGltfModel, 30.0f)) {
+    Logger::log(1, "%s error: could not bake the animation clips\n", __FUNCTION__);
+    return false;
+  }
+
+  std::vector<glm::mat4> bakedJointMatrices = mBakedAnimations.getJointMatrices();
+  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdBakedJointMatrixSSBO,
+      bakedJointMatrices.size() * sizeof(glm::mat4))) {
+    Logger::log(1, "%s error: could not create baked shader storage buffers\n", __FUNCTION__);
+    return false;
+  }
+  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdBakedJointMatrixSSBO,
+    bakedJointMatrices);
+
+  std::vector<glm::mat2x4> bakedJointDualQuats = mBakedAnimations.getJointDualQuats();
+  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdBakedJointDualQuatSSBO,
+      bakedJointDualQuats.size() * sizeof(glm::mat2x4))) {
+    Logger::log(1, "%s error: could not create baked shader storage buffers\n", __FUNCTION__);
+    return false;
+  }
+  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdBakedJointDualQuatSSBO,
+    bakedJointDualQuats);
+
+  size_t bakedInstanceBufferSize = mRenderData.rdNumberOfInstances * sizeof(BakedInstanceData);
+  if (!ShaderStorageBuffer::init(mRenderData, mRenderData.rdBakedMatrixInstanceSSBO,
+      bakedInstanceBufferSize) ||
+      !ShaderStorageBuffer::init(mRenderData, mRenderData.rdBakedDualQuatInstanceSSBO,
+      bakedInstanceBufferSize)) {
+    Logger::log(1, "%s error: could not create baked shader storage buffers\n", __FUNCTION__);
+    return false;
+  }
+  return true;
+}
+
 bool VkRenderer::createRenderPass() {
   if (!Renderpass::init(mRenderData)) {
     Logger::log(1, "%s error: could not init renderpass\n", __FUNCTION__);
@@ -403,6 +455,31 @@ bool VkRenderer::createGltfGPUDQPipeline() {
   return true;
 }
 
+bool VkRenderer::createGltfGPUBakedPipeline() {
+  std::string vertexShaderFile = "shader/gltf_gpu_baked.vert.spv";
+  std::string fragmentShaderFile = "shader/gltf_gpu.frag.spv";
+  if (!GltfGPUPipeline::init(mRenderData, mRenderData.rdGltfPipelineLayout,
+      mRenderData.rdGltfGPUBakedPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+      vertexShaderFile, fragmentShaderFile)) {
+    Logger::log(1, "%s error: could not init gltf GPU baked shader pipeline\n", __FUNCTION__);
+    return false;
+  }
+  return true;
+}
+
+bool VkRenderer::createGltfGPUBakedDQPipeline() {
+  std::string vertexShaderFile = "shader/gltf_gpu_dquat_baked.vert.spv";
+  std::string fragmentShaderFile = "shader/gltf_gpu_dquat.frag.spv";
+  if (!GltfGPUPipeline::init(mRenderData, mRenderData.rdGltfPipelineLayout,
+      mRenderData.rdGltfGPUBakedDQPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+      vertexShaderFile, fragmentShaderFile)) {
+    Logger::log(1, "%s error: could not init gltf GPU baked dual quat shader pipeline\n",
+      __FUNCTION__);
+    return false;
+  }
+  return true;
+}
+
 bool VkRenderer::createFramebuffer() {
   if (!Framebuffer::init(mRenderData)) {
     Logger::log(1, "%s error: could not init framebuffer\n", __FUNCTION__);
@@ -459,7 +536,14 @@ bool VkRenderer::loadGltfModel() {
   mGltfModel = std::make_shared<GltfModel>();
   std::string modelFilename = "assets/Woman.gltf";
   std::string modelTexFilename = "textures/Woman.png";
-  if (!mGltfModel->loadModel(mRenderData, modelFilename, modelTexFilename)) {
+
+  /* optional animation clip processing, see ModelLoadSettings.h */
+  ModelLoadSettings loadSettings{};
+  loadSettings.mlsReduceKeyframes = false;
+  loadSettings.mlsResampleAnimations = false;
+  loadSettings.mlsCompressAnimations = false;
+
+  if (!mGltfModel->loadModel(mRenderData, modelFilename, modelTexFilename, loadSettings)) {
     Logger::log(1, "%s: loading glTF model '%s' failed\n", __FUNCTION__, modelFilename.c_str());
     return false;
   }
@@ -469,19 +553,26 @@ bool VkRenderer::loadGltfModel() {
 bool VkRenderer::createInstances() {
   int numTriangles = 0;
 
-  /* create glTF instances from the model */
-  for (int i = 0; i < 1000; ++i) {
+  /* create glTF instances from the model, in a single block of memory */
+  int instanceCount = 1000;
+  mInstanceManager.init(mGltfModel, instanceCount);
+  for (int i = 0; i < instanceCount; ++i) {
     int xPos = std::rand() % 150 - 75;
     int zPos = std::rand() % 150 - 75;
-    mGltfInstances.emplace_back(std::make_shared<GltfInstance>(mGltfModel,
-      glm::vec2(static_cast<float>(xPos), static_cast<float>(zPos)), true));
+    mInstanceManager.addInstance(glm::vec2(static_cast<float>(xPos),
+      static_cast<float>(zPos)), true);
     numTriangles += mGltfModel->getTriangleCount();
   }
 
   mRenderData.rdTriangleCount = numTriangles;
-  mRenderData.rdNumberOfInstances = mGltfInstances.size();
+  mRenderData.rdNumberOfInstances = mInstanceManager.getInstanceCount();
+
+  /* instances are animated in parallel, starts with one thread per core */
+  mAnimationBatch.setThreadPool(&mThreadPool);
+  mPoseCache.setThreadPool(&mThreadPool);
+  mRenderData.rdAnimationThreads = mThreadPool.getThreadCount();
 
-  if (!mGltfInstances.size()) {
+  if (!mInstanceManager.getInstanceCount()) {
     Logger::log(1, "%s: glTF instance creation failed\n", __FUNCTION__);
     return false;
   }
@@ -489,6 +580,52 @@ bool VkRenderer::createInstances() {
   return true;
 }
 
+void VkRenderer::updateLineMesh(glm::vec2 modelWorldPos, glm::quat modelWorldRot,
+    const ModelSettings &ikSettings) {
+  mLineMesh->vertices.clear();
+
+  /* get gltTF skeleton */
+  mSkeletonLineIndexCount = 0;
+  for (const auto &instance : mSkeletonInstances) {
+    std::shared_ptr<VkMesh> mesh = instance->getSkeleton();
+    mSkeletonLineIndexCount += mesh->vertices.size();
+    mLineMesh->vertices.insert(mLineMesh->vertices.begin(),
+      mesh->vertices.begin(), mesh->vertices.end());
+  }
+
+  /* get coordinate arrows for the IK target of current instance only */
+  mCoordArrowsLineIndexCount = 0;
+  {
+    if (ikSettings.msIkMode == ikMode::ccd ||
+        ikSettings.msIkMode == ikMode::fabrik) {
+      mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
+      mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
+      std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
+        [=](auto &n){
+          n.color /= 2.0f;
+          n.position = modelWorldRot * n.position;
+          n.position += ikSettings.msIkTargetWorldPos;
+      });
+
+      mLineMesh->vertices.insert(mLineMesh->vertices.end(),
+        mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+    }
+  }
+
+  /* draw coordiante arrows*/
+  mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
+  mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
+  std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
+    [=](auto &n){
+      n.color /= 2.0f;
+      n.position = modelWorldRot * n.position;
+      n.position += glm::vec3(modelWorldPos.x, 0.0f, modelWorldPos.y);
+  });
+
+  mLineMesh->vertices.insert(mLineMesh->vertices.end(),
+    mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+}
+
 void VkRenderer::cleanup() {
   vkDeviceWaitIdle(mRenderData.rdVkbDevice.device);
 
@@ -501,6 +638,8 @@ void VkRenderer::cleanup() {
   CommandBuffer::cleanup(mRenderData, mRenderData.rdCommandBuffer);
   CommandPool::cleanup(mRenderData);
   Framebuffer::cleanup(mRenderData);
+  GltfGPUPipeline::cleanup(mRenderData, mRenderData.rdGltfGPUBakedDQPipeline);
+  GltfGPUPipeline::cleanup(mRenderData, mRenderData.rdGltfGPUBakedPipeline);
   GltfGPUPipeline::cleanup(mRenderData, mRenderData.rdGltfGPUDQPipeline);
   GltfGPUPipeline::cleanup(mRenderData, mRenderData.rdGltfGPUPipeline);
   GltfSkeletonPipeline::cleanup(mRenderData, mRenderData.rdGltfSkeletonPipeline);
@@ -510,6 +649,10 @@ void VkRenderer::cleanup() {
   UniformBuffer::cleanup(mRenderData, mRenderData.rdPerspViewMatrixUBO);
   ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdJointDualQuatSSBO);
   ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdJointMatrixSSBO);
+  ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdBakedDualQuatInstanceSSBO);
+  ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdBakedMatrixInstanceSSBO);
+  ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdBakedJointDualQuatSSBO);
+  ShaderStorageBuffer::cleanup(mRenderData, mRenderData.rdBakedJointMatrixSSBO);
   VertexBuffer::cleanup(mRenderData, mRenderData.rdVertexBufferData);
 
   vkDestroyImageView(mRenderData.rdVkbDevice.device, mRenderData.rdDepthImageView, nullptr);
@@ -713,6 +856,12 @@ bool VkRenderer::draw() {
   scissor.offset = { 0, 0 };
   scissor.extent = mRenderData.rdVkbSwapchain.extent;
 
+  /* run outside of the timers, takes some seconds */
+  if (mRenderData.rdRunAnimationBenchmarks) {
+    AnimationBenchmark::runAll(mGltfModel);
+    mRenderData.rdRunAnimationBenchmarks = false;
+  }
+
   mMatrixGenerateTimer.start();
 
   mPerspViewMatrices.at(0) = mCamera.getViewMatrix(mRenderData);
@@ -721,67 +870,227 @@ bool VkRenderer::draw() {
     static_cast<float>(mRenderData.rdVkbSwapchain.extent.width) /
     static_cast<float>(mRenderData.rdVkbSwapchain.extent.height), 0.01f, 500.0f);
 
-  /* animate and update inverse kinematics */
-  mRenderData.rdIKTime = 0.0f;
-  for (auto &instance : mGltfInstances) {
-    instance->updateAnimation();
+  if (mRenderData.rdBakeAllInstances || mRenderData.rdUnbakeAllInstances) {
+    for (int i = 0; i < mInstanceManager.getInstanceCount(); ++i) {
+      ModelSettings instanceSettings = mInstanceManager.getInstance(i)->getInstanceSettings();
+      instanceSettings.msBakedAnimation = mRenderData.rdBakeAllInstances;
+      mInstanceManager.setInstanceSettings(i, instanceSettings);
+    }
+    mRenderData.rdBakeAllInstances = false;
+    mRenderData.rdUnbakeAllInstances = false;
+  }
+
+  /* one time step for all instances, the system clock is not read per instance */
+  if (mRenderData.rdResetAnimationClock) {
+    mAnimationClock.reset();
+    mInstanceManager.resetAnimationTimes();
+    mRenderData.rdResetAnimationClock = false;
+  }
+  mAnimationClock.setPaused(mRenderData.rdAnimationPaused);
+  mAnimationClock.setTimeScale(mRenderData.rdAnimationTimeScale);
+  mAnimationClock.setFixedStep(mRenderData.rdAnimationFixedStep ?
+    mRenderData.rdAnimationFixedStepSize : 0.0f);
+  mAnimationClock.tick(mRenderData.rdTickDiff);
+  mInstanceManager.advanceAnimationTimes(mAnimationClock.getDeltaTime());
+  mRenderData.rdAnimationClockTime = mAnimationClock.getTime();
+
+  /* the loops over all instances read the flags array, not the instances */
+  const std::vector<InstanceFlags> &instanceFlags = mInstanceManager.getFlags();
+
+  /* baked instances are animated in the shaders */
+  mAnimatedInstances.clear();
+  for (int i = 0; i < mInstanceManager.getInstanceCount(); ++i) {
+    if (!instanceFlags[i].ifBakedAnimation) {
+      mAnimatedInstances.push_back(mInstanceManager.getInstance(i));
+    }
+  }
+  mRenderData.rdBakedInstances = mInstanceManager.getInstanceCount() - mAnimatedInstances.size();
 
-    mIKTimer.start();
-    instance->solveIK();
-    mRenderData.rdIKTime += mIKTimer.stop();
+  /* distant instances keep their last joint matrices between the updates */
+  if (mRenderData.rdAnimationLod) {
+    mAnimationLod.selectInstances(mInstanceManager, mAnimatedInstances,
+      mRenderData.rdCameraWorldPosition, mRenderData.rdAnimationLodDistances, mLodInstances);
+  }
+  for (int i = 0; i < AnimationLod::mBandCount; ++i) {
+    mRenderData.rdAnimationLodInstances[i] = mRenderData.rdAnimationLod ?
+      mAnimationLod.getBandInstanceCount(i) : 0;
   }
+  std::vector<GltfInstance*> &updateInstances =
+    mRenderData.rdAnimationLod ? mLodInstances : mAnimatedInstances;
 
-  /* save value to avoid changes during later calls */
-  int selectedInstance = mRenderData.rdCurrentSelectedInstance;
-  glm::vec2 modelWorldPos = mGltfInstances.at(selectedInstance)->getWorldPosition();
-  glm::quat modelWorldRot = mGltfInstances.at(selectedInstance)->getWorldRotation();
+  /* small instances skip the channels and nodes of fingers and toes */
+  if (mRenderData.rdSkeletonLod) {
+    mSkeletonLod.selectLevels(updateInstances, mRenderData.rdCameraWorldPosition,
+      mRenderData.rdFieldOfView, mRenderData.rdHeight, mRenderData.rdSkeletonLodScreenSizes);
+  } else {
+    mSkeletonLod.resetLevels(updateInstances);
+  }
+  for (int i = 0; i < GltfModel::mSkeletonLodCount; ++i) {
+    mRenderData.rdSkeletonLodInstances[i] = mSkeletonLod.getLevelInstanceCount(i);
+  }
+  mRenderData.rdSkeletonLodSkippedChannels = mSkeletonLod.getSkippedChannelCount();
+
+  /* animation, inverse kinematics, joint data packing and the line mesh run as one task
+   * graph. the tasks of an instance only wait for the earlier tasks of the same instance */
+  mThreadPool.setThreadCount(mRenderData.rdAnimationThreads);
+  mThreadPool.resetUtilization();
+  /* the temporary poses of the last frame are no longer used */
+  PoseArena::nextFrame();
+  mFrameGraph.clear();
+
+  mRenderData.rdBatchedInstances = 0;
+  mRenderData.rdPoseCacheHitRate = 0.0f;
+  if (mRenderData.rdPoseCache) {
+    mPoseCache.addTasks(mFrameGraph, updateInstances, mRenderData.rdPoseCacheTimeStep,
+      mRenderData.rdBatchAnimations ? &mAnimationBatch : nullptr, mPoseTasks);
+    mRenderData.rdPoseCacheHitRate = mPoseCache.getHitRate();
+  } else if (mRenderData.rdBatchAnimations) {
+    mAnimationBatch.addTasks(mFrameGraph, updateInstances, mPoseTasks);
+  } else {
+    mPoseTasks.resize(updateInstances.size());
+    for (int i = 0; i < updateInstances.size(); ++i) {
+      GltfInstance *instance = updateInstances.at(i);
+      mPoseTasks.at(i) = mFrameGraph.addTask([instance]() {
+        instance->updateAnimation();
+      });
+    }
+  }
+  if (mRenderData.rdBatchAnimations) {
+    mRenderData.rdBatchedInstances = mAnimationBatch.getBatchedInstanceCount();
+  }
 
-  mLineMesh->vertices.clear();
+  /* the last task changing the joints of an instance, by handle */
+  mInstanceTasks.assign(mInstanceManager.getInstanceCount(), -1);
+  for (int i = 0; i < updateInstances.size(); ++i) {
+    mInstanceTasks[mInstanceManager.getHandle(updateInstances[i])] = mPoseTasks.at(i);
+  }
 
-  /* get gltTF skeleton */
-  mSkeletonLineIndexCount = 0;
-  for (const auto &instance : mGltfInstances) {
-    ModelSettings settings = instance->getInstanceSettings();
-    if (settings.msDrawSkeleton) {
-      std::shared_ptr<VkMesh> mesh = instance->getSkeleton();
-      mSkeletonLineIndexCount += mesh->vertices.size();
-      mLineMesh->vertices.insert(mLineMesh->vertices.begin(),
-        mesh->vertices.begin(), mesh->vertices.end());
+  GltfSkeleton::setDecomposeValidation(mRenderData.rdIkDecomposeValidation);
+  mIKTimes.assign(updateInstances.size(), 0.0f);
+  for (int i = 0; i < updateInstances.size(); ++i) {
+    GltfInstance *instance = updateInstances.at(i);
+    int handle = mInstanceManager.getHandle(instance);
+    if (!instanceFlags[handle].ifInverseKinematics) {
+      continue;
     }
-  }
+    int ikTask = mFrameGraph.addTask([this, instance, i]() {
+      Timer ikTimer{};
+      ikTimer.start();
+      instance->solveIK();
+      mIKTimes[i] = ikTimer.stop();
+    });
+    mFrameGraph.addDependency(ikTask, mPoseTasks.at(i));
+    mInstanceTasks[handle] = ikTask;
+  }
+
+  /* every instance gets a fixed slot in the joint buffers, the slots are filled in parallel.
+   * the joints go directly into the mapped shader storage buffers, the GPU is done with the
+   * last frame after the fence */
+  glm::mat4 *jointMatrices =
+    static_cast<glm::mat4*>(mRenderData.rdJointMatrixSSBO.rdSsboMappedData);
+  glm::mat2x4 *jointDualQuats =
+    static_cast<glm::mat2x4*>(mRenderData.rdJointDualQuatSSBO.rdSsboMappedData);
+  mBakedMatrixInstances.clear();
+  mBakedDualQuatInstances.clear();
 
-  /* get coordinate arrows for the IK target of current instance only */
-  mCoordArrowsLineIndexCount = 0;
-  {
-    ModelSettings ikSettings = mGltfInstances.at(selectedInstance)->getInstanceSettings();
-    if (ikSettings.msIkMode == ikMode::ccd ||
-        ikSettings.msIkMode == ikMode::fabrik) {
-      mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
-      mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
-      std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
-        [=](auto &n){
-          n.color /= 2.0f;
-          n.position = modelWorldRot * n.position;
-          n.position += ikSettings.msIkTargetWorldPos;
+  unsigned int matrixInstances = 0;
+  unsigned int dualQuatInstances = 0;
+  unsigned int numTriangles = 0;
+  size_t jointMatrixCount = 0;
+  size_t jointDualQuatCount = 0;
+  /* identical for all instances of the model */
+  int jointMatrixSize = mInstanceManager.getInstance(0)->getJointMatrixSize();
+  int jointDualQuatsSize = mInstanceManager.getInstance(0)->getJointDualQuatsSize();
+
+  const std::vector<glm::mat4> &worldMatrices = mInstanceManager.getWorldMatrices();
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    const InstanceFlags &flags = instanceFlags[handle];
+    if (!flags.ifDrawModel) {
+      continue;
+    }
+
+    numTriangles += mGltfModel->getTriangleCount();
+
+    GltfInstance *packInstance = mInstanceManager.getInstance(handle);
+    if (flags.ifBakedAnimation) {
+      BakedInstanceData instanceData = mBakedAnimations.getInstanceData(
+        packInstance->getInstanceSettings(), worldMatrices[handle],
+        packInstance->getAnimationTime(), mAnimationClock.getTime());
+      if (flags.ifDualQuatSkinning) {
+        mBakedDualQuatInstances.push_back(instanceData);
+      } else {
+        mBakedMatrixInstances.push_back(instanceData);
+      }
+      continue;
+    }
+
+    int packTask = 0;
+    if (flags.ifDualQuatSkinning) {
+      glm::mat2x4 *slot = jointDualQuats + jointDualQuatCount;
+      packTask = mFrameGraph.addTask([packInstance, slot]() {
+        const std::vector<glm::mat2x4> &quats = packInstance->getJointDualQuats();
+        std::copy(quats.begin(), quats.end(), slot);
+      });
+      jointDualQuatCount += jointDualQuatsSize;
+      ++dualQuatInstances;
+    } else {
+      glm::mat4 *slot = jointMatrices + jointMatrixCount;
+      packTask = mFrameGraph.addTask([packInstance, slot]() {
+        const std::vector<glm::mat4> &mats = packInstance->getJointMatrices();
+        std::copy(mats.begin(), mats.end(), slot);
       });
+      jointMatrixCount += jointMatrixSize;
+      ++matrixInstances;
+    }
 
-      mLineMesh->vertices.insert(mLineMesh->vertices.end(),
-        mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+    /* instances skipped by the animation LOD keep the joints of the last update */
+    if (mInstanceTasks[handle] >= 0) {
+      mFrameGraph.addDependency(packTask, mInstanceTasks[handle]);
     }
   }
+  mRenderData.rdTriangleCount = numTriangles;
 
-  /* draw coordiante arrows*/
-  mCoordArrowsMesh = mCoordArrowsModel.getVertexData();
-  mCoordArrowsLineIndexCount += mCoordArrowsMesh.vertices.size();
-  std::for_each(mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end(),
-    [=](auto &n){
-      n.color /= 2.0f;
-      n.position = modelWorldRot * n.position;
-      n.position += glm::vec3(modelWorldPos.x, 0.0f, modelWorldPos.y);
+  /* save value to avoid changes during later calls */
+  int selectedInstance = mRenderData.rdCurrentSelectedInstance;
+  glm::vec2 modelWorldPos = mInstanceManager.getInstance(selectedInstance)->getWorldPosition();
+  glm::quat modelWorldRot = mInstanceManager.getInstance(selectedInstance)->getWorldRotation();
+  ModelSettings ikSettings = mInstanceManager.getInstance(selectedInstance)->getInstanceSettings();
+
+  /* the line mesh waits for all instances drawing the skeleton */
+  mSkeletonInstances.clear();
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    if (instanceFlags[handle].ifDrawSkeleton && !instanceFlags[handle].ifBakedAnimation) {
+      mSkeletonInstances.push_back(mInstanceManager.getInstance(handle));
+    }
+  }
+  int lineMeshTask = mFrameGraph.addTask([this, modelWorldPos, modelWorldRot, ikSettings]() {
+    updateLineMesh(modelWorldPos, modelWorldRot, ikSettings);
   });
+  for (const auto &instance : mSkeletonInstances) {
+    int instanceTask = mInstanceTasks[mInstanceManager.getHandle(instance)];
+    if (instanceTask >= 0) {
+      mFrameGraph.addDependency(lineMeshTask, instanceTask);
+    }
+  }
 
-  mLineMesh->vertices.insert(mLineMesh->vertices.end(),
-    mCoordArrowsMesh.vertices.begin(), mCoordArrowsMesh.vertices.end());
+  mThreadPool.run(mFrameGraph);
+  mRenderData.rdWorkerUtilization = mThreadPool.getUtilization();
+
+  /* sum of the solver times on all threads */
+  mRenderData.rdIKTime = 0.0f;
+  for (const auto ikTime : mIKTimes) {
+    mRenderData.rdIKTime += ikTime;
+  }
+
+  /* unchanged nodes and joints are skipped, also counts the changes made by the UI */
+  mRenderData.rdUpdatedNodes = 0;
+  mRenderData.rdUpdatedJoints = 0;
+  for (int handle = 0; handle < mInstanceManager.getInstanceCount(); ++handle) {
+    GltfInstance *instance = mInstanceManager.getInstance(handle);
+    mRenderData.rdUpdatedNodes += instance->getUpdatedNodeCount();
+    mRenderData.rdUpdatedJoints += instance->getUpdatedJointCount();
+    instance->resetUpdateCounters();
+  }
 
   mRenderData.rdMatrixGenerateTime = mMatrixGenerateTimer.stop();
 
@@ -816,36 +1125,6 @@ bool VkRenderer::draw() {
 
   mRenderData.rdUploadToVBOTime = mUploadToVBOTimer.stop();
 
-  /* prepare the vectors with matrix and dual quat data, update triangle count */
-  mModelJointMatrices.clear();
-  mModelJointDualQuats.clear();
-
-  unsigned int matrixInstances = 0;
-  unsigned int dualQuatInstances = 0;
-  unsigned int numTriangles = 0;
-
-  for (const auto &instance : mGltfInstances) {
-    ModelSettings settings = instance->getInstanceSettings();
-    if (!settings.msDrawModel) {
-      continue;
-    }
-
-    if (settings.msVertexSkinningMode == skinningMode::dualQuat) {
-      std::vector<glm::mat2x4> quats = instance->getJointDualQuats();
-      mModelJointDualQuats.insert(mModelJointDualQuats.end(),
-        quats.begin(), quats.end());
-      ++dualQuatInstances;
-    } else {
-      std::vector<glm::mat4> mats = instance->getJointMatrices();
-      mModelJointMatrices.insert(mModelJointMatrices.end(),
-        mats.begin(), mats.end());
-      ++matrixInstances;
-    }
-    numTriangles += mGltfModel->getTriangleCount();
-  }
-
-  mRenderData.rdTriangleCount = numTriangles;
-
   /* the rendering itself happens here */
   vkCmdBeginRenderPass(mRenderData.rdCommandBuffer, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -870,15 +1149,15 @@ bool VkRenderer::draw() {
     &mRenderData.rdVertexBufferData.rdVertexBuffer, &offset);
 
   /* draw the glTF models */
-  unsigned int jointMatrixSize = mGltfInstances.at(0)->getJointMatrixSize();
+  unsigned int jointMatrixSize = mInstanceManager.getInstance(0)->getJointMatrixSize();
   unsigned int matrixPos = 0;
 
-  VkPushConstants modelStride;
+  VkPushConstants modelStride{};
 
   vkCmdBindPipeline(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
    mRenderData.rdGltfGPUPipeline);
   /* set position inside the SSBO */
-  modelStride.pkModelStride = mGltfInstances.at(0)->getJointMatrixSize();
+  modelStride.pkModelStride = mInstanceManager.getInstance(0)->getJointMatrixSize();
   vkCmdPushConstants(mRenderData.rdCommandBuffer, mRenderData.rdGltfPipelineLayout,
     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkPushConstants), &modelStride);
   mGltfModel->drawInstanced(mRenderData, matrixInstances);
@@ -886,11 +1165,38 @@ bool VkRenderer::draw() {
 
   vkCmdBindPipeline(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
     mRenderData.rdGltfGPUDQPipeline);
-  modelStride.pkModelStride = mGltfInstances.at(0)->getJointDualQuatsSize();
+  modelStride.pkModelStride = mInstanceManager.getInstance(0)->getJointDualQuatsSize();
   vkCmdPushConstants(mRenderData.rdCommandBuffer, mRenderData.rdGltfPipelineLayout,
     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkPushConstants), &modelStride);
   mGltfModel->drawInstanced(mRenderData, dualQuatInstances);
 
+  /* baked instances, the shaders select the frame from the replay time */
+  modelStride.pkReplayTime = static_cast<float>(mAnimationClock.getTime());
+
+  vkCmdBindDescriptorSets(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfPipelineLayout, 2, 1,
+    &mRenderData.rdBakedJointMatrixSSBO.rdSSBODescriptorSet, 0, nullptr);
+  vkCmdBindDescriptorSets(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfPipelineLayout, 3, 1,
+    &mRenderData.rdBakedMatrixInstanceSSBO.rdSSBODescriptorSet, 0, nullptr);
+  vkCmdBindPipeline(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfGPUBakedPipeline);
+  vkCmdPushConstants(mRenderData.rdCommandBuffer, mRenderData.rdGltfPipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkPushConstants), &modelStride);
+  mGltfModel->drawInstanced(mRenderData, mBakedMatrixInstances.size());
+
+  vkCmdBindDescriptorSets(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfPipelineLayout, 2, 1,
+    &mRenderData.rdBakedJointDualQuatSSBO.rdSSBODescriptorSet, 0, nullptr);
+  vkCmdBindDescriptorSets(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfPipelineLayout, 3, 1,
+    &mRenderData.rdBakedDualQuatInstanceSSBO.rdSSBODescriptorSet, 0, nullptr);
+  vkCmdBindPipeline(mRenderData.rdCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    mRenderData.rdGltfGPUBakedDQPipeline);
+  vkCmdPushConstants(mRenderData.rdCommandBuffer, mRenderData.rdGltfPipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkPushConstants), &modelStride);
+  mGltfModel->drawInstanced(mRenderData, mBakedDualQuatInstances.size());
+
   if (mCoordArrowsLineIndexCount > 0 || mSkeletonLineIndexCount > 0) {
     vkCmdBindVertexBuffers(mRenderData.rdCommandBuffer, 0, 1,
       &mRenderData.rdVertexBufferData.rdVertexBuffer, &offset);
@@ -915,10 +1221,9 @@ bool VkRenderer::draw() {
   /* imgui overlay */
   mUIGenerateTimer.start();
 
-  ModelSettings settings = mGltfInstances.at(selectedInstance)->getInstanceSettings();
-  mUserInterface.createFrame(mRenderData, settings);
-  mGltfInstances.at(selectedInstance)->setInstanceSettings(settings);
-  mGltfInstances.at(selectedInstance)->checkForUpdates();
+  ModelSettings settings = mInstanceManager.getInstance(selectedInstance)->getInstanceSettings();
+  mUserInterface.createFrame(mRenderData, settings, mGltfModel->getMetadata());
+  mInstanceManager.setInstanceSettings(selectedInstance, settings);
 
   mRenderData.rdUIGenerateTime = mUIGenerateTimer.stop();
 
@@ -938,8 +1243,14 @@ bool VkRenderer::draw() {
 
   UniformBuffer::uploadData(mRenderData, mRenderData.rdPerspViewMatrixUBO, mPerspViewMatrices);
 
-  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdJointDualQuatSSBO, mModelJointDualQuats);
-  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdJointMatrixSSBO, mModelJointMatrices);
+  ShaderStorageBuffer::flushMappedData(mRenderData, mRenderData.rdJointDualQuatSSBO,
+    jointDualQuatCount * sizeof(glm::mat2x4));
+  ShaderStorageBuffer::flushMappedData(mRenderData, mRenderData.rdJointMatrixSSBO,
+    jointMatrixCount * sizeof(glm::mat4));
+  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdBakedMatrixInstanceSSBO,
+    mBakedMatrixInstances);
+  ShaderStorageBuffer::uploadData(mRenderData, mRenderData.rdBakedDualQuatInstanceSSBO,
+    mBakedDualQuatInstances);
 
   mRenderData.rdUploadToUBOTime = mUploadToUBOTimer.stop();
 
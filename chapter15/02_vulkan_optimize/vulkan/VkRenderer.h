@@ -13,6 +13,7 @@
 #include <vk_mem_alloc.h>
 
 #include "Timer.h"
+#include "ThreadPool.h"
 #include "Renderpass.h"
 #include "Pipeline.h"
 #include "GltfPipeline.h"
@@ -33,6 +34,13 @@
 #include "CoordArrowsModel.h"
 #include "GltfModel.h"
 #include "GltfInstance.h"
+#include "InstanceManager.h"
+#include "AnimationClock.h"
+#include "AnimationBatch.h"
+#include "PoseCache.h"
+#include "BakedAnimations.h"
+#include "AnimationLod.h"
+#include "SkeletonLod.h"
 
 #include "VkRenderData.h"
 
@@ -58,14 +66,31 @@ class VkRenderer {
     std::shared_ptr<GltfModel> mGltfModel = nullptr;
     bool mModelUploadRequired = true;
 
-    std::vector<std::shared_ptr<GltfInstance>> mGltfInstances{};
-
-    std::vector<glm::mat4> mModelJointMatrices{};
-    std::vector<glm::mat2x4> mModelJointDualQuats{};
+    InstanceManager mInstanceManager{};
+    AnimationClock mAnimationClock{};
+    ThreadPool mThreadPool{};
+    /* all per-frame work on the instances before the upload */
+    TaskGraph mFrameGraph{};
+    std::vector<int> mPoseTasks{};
+    /* by instance handle, -1 for instances without a task */
+    std::vector<int> mInstanceTasks{};
+    std::vector<float> mIKTimes{};
+    AnimationBatch mAnimationBatch{};
+    PoseCache mPoseCache{};
+    BakedAnimations mBakedAnimations{};
+    /* instances without a baked animation */
+    std::vector<GltfInstance*> mAnimatedInstances{};
+    AnimationLod mAnimationLod{};
+    std::vector<GltfInstance*> mLodInstances{};
+    SkeletonLod mSkeletonLod{};
+
+    std::vector<BakedInstanceData> mBakedMatrixInstances{};
+    std::vector<BakedInstanceData> mBakedDualQuatInstances{};
 
     CoordArrowsModel mCoordArrowsModel{};
     VkMesh mCoordArrowsMesh{};
     std::shared_ptr<VkMesh> mLineMesh = nullptr;
+    std::vector<GltfInstance*> mSkeletonInstances{};
     unsigned int mSkeletonLineIndexCount = 0;
     unsigned int mCoordArrowsLineIndexCount = 0;
 
@@ -76,13 +101,15 @@ class VkRenderer {
     double mLastTickTime = 0.0;
 
     void handleMovementKeys();
+    /* skeletons of mSkeletonInstances and the coordinate arrows of the selected instance */
+    void updateLineMesh(glm::vec2 modelWorldPos, glm::quat modelWorldRot,
+      const ModelSettings &ikSettings);
     int mCameraForward = 0;
     int mCameraStrafe = 0;
     int mCameraUpDown = 0;
 
     Timer mFrameTimer{};
     Timer mMatrixGenerateTimer{};
-    Timer mIKTimer{};
     Timer mUploadToVBOTimer{};
     Timer mUploadToUBOTimer{};
     Timer mUIGenerateTimer{};
@@ -101,6 +128,7 @@ class VkRenderer {
     bool createUBO();
     bool createMatrixSSBO();
     bool createDQSSBO();
+    bool createBakedSSBOs();
     bool createSwapchain();
     bool createRenderPass();
     bool createGltfPipelineLayout();
@@ -108,6 +136,8 @@ class VkRenderer {
     bool createGltfSkeletonPipeline();
     bool createGltfGPUPipeline();
     bool createGltfGPUDQPipeline();
+    bool createGltfGPUBakedPipeline();
+    bool createGltfGPUBakedDQPipeline();
     bool createFramebuffer();
     bool createCommandPool();
     bool createCommandBuffer();